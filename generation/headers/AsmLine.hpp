@@ -0,0 +1,55 @@
+#ifndef ASM_LINE_HPP
+#define ASM_LINE_HPP
+
+#include <string>
+#include <vector>
+
+namespace generation {
+
+/*
+ * Linha do assembly: rótulo, instrução ou outra coisa (diretiva,
+ * comentário, linha vazia). O gerador monta as instruções já separadas
+ * em código, condição e operandos; linhas lidas de um arquivo são
+ * separadas da mesma forma e, se não forem alteradas, escritas como
+ * foram lidas.
+ */
+class AsmLine {
+    public:
+        enum kind {
+            INSTRUCTION,
+            LABEL,
+            OTHER
+        };
+
+        AsmLine(const std::string& text);
+
+        AsmLine(enum AsmLine::kind kind, const std::string& text);
+
+        AsmLine(const std::string& opcode, const std::vector<std::string>& operands, const std::string& condition = ""):
+            kind(INSTRUCTION), opcode(opcode), condition(condition), operands(operands), modified(true)
+        {}
+
+        std::string text();
+        std::string directive();
+
+        // Instrução incondicional com esse código
+        bool is(const std::string& op) {
+            return kind == INSTRUCTION && opcode == op && condition.empty();
+        }
+
+        bool is_blank() {
+            return kind == OTHER && raw.find_first_not_of(" \t") == std::string::npos;
+        }
+
+        enum AsmLine::kind kind;
+        std::string raw;
+        std::string label;
+        std::string opcode;                 // Sem a condição: MOV, BL, MOVS
+        std::string condition;              // EQ, LT, ...; vazia se sempre executa
+        std::vector<std::string> operands;
+        bool modified = false;
+};
+
+} // namespace generation
+
+#endif // ASM_LINE_HPP
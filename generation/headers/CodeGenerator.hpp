@@ -1,48 +1,149 @@
 #ifndef CODE_GENERATOR_HPP
 #define CODE_GENERATOR_HPP
 
+#include <cstdint>
 #include <fstream>
+#include <map>
+#include <string>
 #include <vector>
-#include <utility>
+#include <unordered_map>
 
 #include "syntax.hpp"
 #include "semantic.hpp"
+#include "optimization.hpp"
+#include "IR.hpp"
+#include "RegisterAllocator.hpp"
+#include "AsmLine.hpp"
 
 namespace generation {
 
+// Maior deslocamento imediato de LDR e STR
+#define MAX_OFFSET 4095
+
+// Instruções entre um LDR de literal e a tabela em que ele fica; o
+// alcance é de MAX_OFFSET bytes, com folga para a própria tabela
+#define LITERAL_RANGE 900
+
+// No modo Thumb, LDR e STR aceitam deslocamentos até 124, em palavras, e
+// LDR de literal só alcança 1020 bytes adiante
+#define THUMB_MAX_OFFSET 124
+#define THUMB_LITERAL_RANGE 250
+
+/*
+ * Gera o assembly ARM a partir da representação intermediária, já fora
+ * da forma SSA. Os valores ficam nos registradores r3-r10 escolhidos
+ * pelo RegisterAllocator; os que ficam sem registrador têm uma posição
+ * própria na área temporaries, logo após as variáveis, e passam por
+ * r0-r2 ao serem usados ou calculados. Funções de usuário guardam em
+ * exe_stack os registradores r6-r10 que usam.
+ *
+ * Com -mthumb, o código é Thumb, de 16 bits: os valores ficam em r3-r6,
+ * as variáveis são endereçadas a partir de r7 e há uma só pilha, em sp,
+ * para lr, argumentos e os registradores r4-r6 das funções. O programa
+ * entra em ARM e passa ao Thumb por BX.
+ */
 class CodeGenerator {
     public:
-        CodeGenerator(std::string& input_file, std::string& output_file, semantic::SymbolTable& symb_table);
+        static bool encodable(uint32_t value);
+
+        CodeGenerator(std::string& input_file, std::string& output_file, semantic::SymbolTable& symb_table, optimization::Options& options);
         ~CodeGenerator();
 
-        void generate(syntax::Assign* assign, std::vector<syntax::Elem*> exp, int next_index);
-        void generate(syntax::Read* read, std::vector<std::pair<syntax::Var*, syntax::Num*>>& read_data, int next_index);
-        void generate(syntax::Data* data, std::vector<std::pair<syntax::Var*, syntax::Num*>>& read_data, int next_index);
-        void generate(syntax::Goto* go, int destination);
-        void generate(syntax::If* ift, std::vector<syntax::Elem*> left, std::vector<syntax::Elem*> right, int destination, int next_index);
-        void generate(syntax::For* loop, std::vector<syntax::Elem*> init, std::vector<syntax::Elem*> stop,
-                        std::vector<syntax::Elem*> step, int index_inside_loop, int index_outside_loop);
-        void generate(syntax::Next* next);
-        void generate(syntax::Def* def, std::vector<syntax::Elem*>& exp);
-        void generate(syntax::Gosub* gosub, int destination);
-        void generate(syntax::Return* ret);
-        void generate(syntax::End* end);
-
-        void generate_expression(std::vector<syntax::Elem*>& exp);
-        void generate_header(int first_index);
+        void generate(optimization::IR& ir);
+        void generate(optimization::IRFunction* function);
+        void generate(optimization::IRInstruction* instruction);
+
+        void generate_arithmetic(optimization::IRInstruction* instruction);
+        void generate_thumb_arithmetic(optimization::IRInstruction* instruction, bool add, optimization::IRValue* left, optimization::IRValue* right);
+        void generate_multiply(optimization::IRInstruction* instruction);
+        bool generate_multiply_accumulate(optimization::IRInstruction* mul, optimization::IRInstruction* add);
+        void generate_division(optimization::IRInstruction* instruction);
+        void generate_power(optimization::IRInstruction* instruction);
+        void generate_load(optimization::IRInstruction* load);
+        void generate_store(optimization::IRInstruction* store);
+        void generate_read(std::vector<optimization::IRInstruction*>& reads);
+        void generate_call(optimization::IRInstruction* call);
+        void generate_gosub(optimization::IRInstruction* gosub);
+
+        void generate_jump(optimization::IRBlock* destination);
+        void generate_branch(optimization::IRInstruction* branch);
+        void generate_bounds_check(optimization::IRInstruction* access, int index);
+        void generate_header();
+        void generate_data();
         void generate_variables();
 
         void install_predef();
         void install_sdiv();
         void install_pow();
+        void install_bounds_error();
+        void install_smulh();
 
     private:
-        std::ofstream output;
+        int operand(optimization::IRValue* value, int reg);
+        int destination(optimization::IRValue* value);
+        void result(optimization::IRValue* value, int reg);
+        void generate_restore();
+        void save_link();
+        void restore_link();
+        void call(const std::string& target);
+        void move(int reg, int source);
+
+        std::string slot(optimization::IRValue* value, int scratch);
+        std::string address(syntax::Var* var, int scratch);
+        std::string memory(int offset, int scratch);
+        std::string element(optimization::IRInstruction* access, int scratch);
+
+        void materialize(int reg, int value);
+        void add_constant(int reg, int base, int value);
+        bool multiply_constant(int reg, int x, int c);
+
+        void emit(const std::string& opcode, const std::vector<std::string>& operands, const std::string& condition = "");
+        void label(const std::string& name);
+        void directive(const std::string& text);
+        void blank();
+
+        void write();
+        void place_literal_pools(std::vector<AsmLine>& lines);
+        void remove_literal_pools(std::vector<AsmLine>& lines);
+        bool relax_branches(std::vector<AsmLine>& lines);
+        int layout(std::vector<AsmLine>& lines, std::vector<int>& addresses, std::map<std::string, int>& labels);
+
+        // Instruções geradas, revistas pela otimização peephole e
+        // escritas no arquivo de uma vez por write
+        std::vector<AsmLine> assembly;
+        std::ofstream file;
         std::string& input_file;
         semantic::SymbolTable& symb_table;
+        optimization::Options& options;
+
+        // Base das variáveis (r12, ou r7 no Thumb) e maior deslocamento
+        // imediato de LDR e STR a partir dela
+        int base_register;
+        int max_offset;
+
+        // Rótulos criados pelo gerador, numerados em sequência
+        int local_labels = 0;
+
+        optimization::IRFunction* main = nullptr;
+        optimization::IRBlock* block = nullptr;
+
+        // Bloco emitido logo após o atual
+        optimization::IRBlock* following = nullptr;
+
+        // Valores da tabela de DATA
+        std::vector<int> data;
+
+        // Posição na área de temporários de cada valor sem registrador
+        std::unordered_map<optimization::IRValue*, int> slots;
+
+        // Usos de cada valor na função atual
+        std::unordered_map<optimization::IRValue*, int> uses;
 
+        // Alocação da função atual e registradores que ela preserva
+        RegisterAllocator* allocator = nullptr;
+        std::string saved;
 };
 
 } // namespace generation
 
-#endif // CODE_GENERATOR_HPP
\ No newline at end of file
+#endif // CODE_GENERATOR_HPP
@@ -0,0 +1,111 @@
+#ifndef OBJECT_WRITER_HPP
+#define OBJECT_WRITER_HPP
+
+#include <cstdint>
+#include <map>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "AsmLine.hpp"
+
+namespace generation {
+
+// Palavra a corrigir pelo ligador com o endereço de uma seção ou símbolo
+class ObjectRelocation {
+    public:
+        uint32_t offset;
+        int symbol;                     // Índice na tabela de símbolos
+};
+
+class ObjectSection {
+    public:
+        ObjectSection(const std::string& name, uint32_t type, uint32_t flags):
+            name(name), type(type), flags(flags)
+        {}
+
+        std::string name;
+        uint32_t type;
+        uint32_t flags;
+        std::vector<uint8_t> bytes;     // Vazio em .bss, que só tem tamanho
+        uint32_t size = 0;
+        std::vector<ObjectRelocation> relocations;
+};
+
+class ObjectSymbol {
+    public:
+        std::string name;
+        int section;                    // -1 para indefinido
+        uint32_t value;
+        uint8_t info;                   // Ligação e tipo, como no ELF
+};
+
+// Valor de um LDR rX, =valor: constante, ou símbolo mais deslocamento
+class ObjectLiteral {
+    public:
+        std::string symbol;
+        int32_t value;
+
+        bool operator<(const ObjectLiteral& other) const {
+            return symbol != other.symbol ? symbol < other.symbol : value < other.value;
+        }
+};
+
+/*
+ * Monta as linhas geradas em um objeto ELF32 relocável para ARM, sem
+ * passar pelo montador externo. Reproduz o que o GNU as faria com o
+ * mesmo assembly: o código e as tabelas de literais em .text, os dados
+ * em .data, as variáveis e as pilhas em .bss, símbolos para os rótulos
+ * e os de mapeamento ($a e $d), e relocações R_ARM_ABS32 para os
+ * literais que guardam endereços. A primeira passagem fixa os endereços
+ * dos rótulos e das tabelas; a segunda codifica as instruções.
+ */
+class ObjectWriter {
+    public:
+        ObjectWriter(std::vector<AsmLine>& lines);
+
+        void write(std::ostream& out);
+
+    private:
+        void layout();
+        void encode();
+
+        uint32_t encode(int i, uint32_t address);
+        uint32_t encode_data_processing(AsmLine& line, int opcode, bool set_flags);
+        uint32_t encode_multiply(AsmLine& line, const std::string& opcode, bool set_flags);
+        uint32_t encode_transfer(int i, uint32_t address);
+        uint32_t encode_multiple(AsmLine& line);
+        uint32_t encode_branch(AsmLine& line, uint32_t address);
+
+        void switch_section(const std::string& name);
+        void emit_word(uint32_t word);
+        void emit_pool(std::vector<ObjectLiteral>& literals);
+        void mapping_symbol(char kind);
+
+        std::string serialize();
+
+        std::vector<AsmLine>& lines;
+
+        std::vector<ObjectSection> sections;
+        std::vector<ObjectSymbol> symbols;
+
+        // Seção e posição de cada rótulo
+        std::map<std::string, std::pair<int, uint32_t>> labels;
+        std::vector<std::string> globals;
+
+        // Tabelas de literais pela linha do .ltorg que as esvazia, ou
+        // pelo número de linhas mais a seção, para as que ficam no fim;
+        // e o endereço do literal de cada linha LDR rX, =valor
+        std::map<int, std::vector<ObjectLiteral>> pools;
+        std::map<int, uint32_t> literal_address;
+
+        // Estado da passagem atual: seção, posição em cada seção e se
+        // cada uma está em código ou em dados
+        int section = 0;
+        std::vector<uint32_t> offsets;
+        std::vector<char> mapping;
+};
+
+} // namespace generation
+
+#endif // OBJECT_WRITER_HPP
@@ -0,0 +1,60 @@
+#ifndef PEEPHOLE_HPP
+#define PEEPHOLE_HPP
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "optimization.hpp"
+#include "AsmLine.hpp"
+
+namespace generation {
+
+class Peephole;
+
+// Regra: examina a janela que começa na instrução i e a reescreve
+class PeepholeRule {
+    public:
+        const char* name;
+        bool (Peephole::*apply)(int i);
+};
+
+/*
+ * Otimização peephole sobre o assembly já gerado: cada regra da tabela
+ * examina uma janela de poucas instruções seguidas e a troca por uma
+ * equivalente mais curta. Linhas vazias não interrompem a janela;
+ * rótulos e diretivas sim, pois outro código pode desviar para eles. As
+ * regras são aplicadas até que nenhuma mude o código.
+ */
+class Peephole {
+    public:
+        Peephole(std::vector<AsmLine>& lines, optimization::Options& options);
+
+        void run();
+
+    private:
+        bool redundant_move(int i);
+        bool push_pop(int i);
+        bool pop_push_link(int i);
+        bool store_load(int i);
+        bool repeated_load(int i);
+        bool fold_move(int i);
+        bool dead_move(int i);
+        bool branch_to_next(int i);
+        bool unreachable(int i);
+
+        int next(int i);
+        void remove(int i);
+
+        static const PeepholeRule rules[];
+
+        std::vector<AsmLine>& lines;
+        optimization::Options& options;
+
+        // Aplicações de cada regra
+        std::map<std::string, int> applied;
+};
+
+} // namespace generation
+
+#endif // PEEPHOLE_HPP
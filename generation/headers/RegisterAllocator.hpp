@@ -0,0 +1,94 @@
+#ifndef REGISTER_ALLOCATOR_HPP
+#define REGISTER_ALLOCATOR_HPP
+
+#include <map>
+#include <set>
+#include <vector>
+#include <unordered_map>
+
+#include "IR.hpp"
+
+// Registradores alocados aos valores; r0-r2 ficam livres para operandos
+// vindos da memória, argumentos de sdiv e pow e cálculo de endereços
+#define FIRST_REGISTER 3
+// A partir daqui, preservados por sdiv, pow e pelas funções de usuário
+#define FIRST_SAVED_REGISTER 6
+#define LAST_REGISTER 10
+
+// No modo Thumb, a maioria das instruções só alcança r0-r7, e r7 é a base
+// das variáveis; sdiv e pow em Thumb usam só r0-r3
+#define THUMB_FIRST_SAVED_REGISTER 4
+#define THUMB_LAST_REGISTER 6
+
+// Maior expoente constante de uma potência calculada no próprio código
+#define MAX_INLINE_EXPONENT 64
+
+namespace generation {
+
+// Trecho do código, em posições da ordem de emissão, em que o valor vive
+class LiveInterval {
+    public:
+        LiveInterval(optimization::IRValue* value, int position):
+            value(value), start(position), end(position)
+        {}
+
+        optimization::IRValue* value;
+        int start;
+        int end;
+        bool crosses_call = false;      // Vivo durante sdiv, pow ou chamada
+        int reg = -1;                   // -1: fica na área de temporários
+};
+
+/*
+ * Alocação de registradores por varredura linear (linear scan) sobre uma
+ * função já fora da SSA. Os blocos são numerados na ordem de emissão e
+ * cada valor recebe o intervalo que cobre todas as posições em que está
+ * vivo. Valores vivos durante uma chamada de sdiv, pow ou de função só
+ * podem ocupar r6-r10, que a função chamada preserva; os demais preferem
+ * r3-r5. No modo Thumb, os registradores são r3-r6, e os preservados,
+ * r4-r6. Sem registrador livre, o valor de fim mais distante fica na
+ * memória.
+ */
+class RegisterAllocator {
+    public:
+        RegisterAllocator(optimization::IRFunction* function, bool thumb = false);
+
+        void run();
+
+        int reg(optimization::IRValue* value);
+        std::vector<int> saved_registers();
+
+        static bool calls(optimization::IRInstruction* instruction);
+
+    private:
+        void number();
+        void compute_liveness();
+        void build_intervals();
+        void scan();
+
+        LiveInterval& interval(optimization::IRValue* value, int position);
+        void extend(optimization::IRValue* value, int position);
+
+        optimization::IRFunction* function;
+
+        // Primeiro registrador preservado e último alocado, conforme o modo
+        int first_saved;
+        int last;
+
+        // Posições antes da primeira e depois da última instrução
+        std::map<optimization::IRBlock*, int> starts;
+        std::map<optimization::IRBlock*, int> ends;
+        std::unordered_map<optimization::IRInstruction*, int> positions;
+        std::vector<int> call_positions;
+
+        std::map<optimization::IRBlock*, std::set<optimization::IRValue*>> live_in;
+        std::map<optimization::IRBlock*, std::set<optimization::IRValue*>> live_out;
+
+        // Na ordem da primeira ocorrência, para uma alocação determinística
+        std::vector<LiveInterval> intervals;
+        std::unordered_map<optimization::IRValue*, int> index;
+};
+
+} // namespace generation
+
+#endif // REGISTER_ALLOCATOR_HPP
@@ -0,0 +1,117 @@
+#include <string>
+#include <vector>
+
+#include "AsmLine.hpp"
+
+using namespace std;
+using namespace generation;
+
+static string trim(const string& s) {
+    size_t begin = s.find_first_not_of(" \t");
+    if (begin == string::npos)
+        return "";
+    size_t end = s.find_last_not_of(" \t");
+    return s.substr(begin, end - begin + 1);
+}
+
+/*
+ * Separa a condição do código: BLS é B com LS, BLHS é BL com HS e MOVS
+ * não tem condição, pois MO não é um código
+ */
+static void split_mnemonic(const string& mnemonic, string& opcode, string& condition) {
+    static const vector<string> opcodes = {
+        "MOV", "MVN", "MOVS", "ADD", "SUB", "RSB", "MUL", "MLA", "SMULL", "UMULL",
+        "AND", "ORR", "EOR", "BIC", "CMP", "CMN", "TST", "TEQ",
+        "LDR", "STR", "LDMFD", "STMFD", "B", "BL", "BX"
+    };
+    static const vector<string> conditions = {
+        "EQ", "NE", "CS", "CC", "HS", "LO", "MI", "PL", "VS", "VC",
+        "HI", "LS", "GE", "LT", "GT", "LE", "AL"
+    };
+
+    opcode = mnemonic;
+    condition.clear();
+    if (mnemonic.size() < 3)
+        return;
+
+    string base = mnemonic.substr(0, mnemonic.size() - 2);
+    string suffix = mnemonic.substr(mnemonic.size() - 2);
+    for (auto& c : conditions) {
+        if (suffix != c)
+            continue;
+        for (auto& o : opcodes) {
+            if (base == o) {
+                opcode = base;
+                condition = suffix;
+            }
+        }
+    }
+}
+
+AsmLine::AsmLine(const string& text):
+    kind(OTHER), raw(text)
+{
+    string line = trim(text);
+    if (line.empty() || line[0] == '.' || line[0] == '/')
+        return;
+
+    // Rótulo sozinho na linha, como o gerador os escreve
+    if (line.back() == ':' && line.find_first_of(" \t") == string::npos) {
+        kind = LABEL;
+        label = line.substr(0, line.size() - 1);
+        return;
+    }
+
+    size_t space = line.find_first_of(" \t");
+    kind = INSTRUCTION;
+    split_mnemonic(line.substr(0, space), opcode, condition);
+    if (space == string::npos)
+        return;
+
+    // Vírgulas dentro de [] e {} não separam operandos
+    string rest = line.substr(space);
+    string operand;
+    int depth = 0;
+    for (char c : rest) {
+        if (c == '[' || c == '{')
+            depth++;
+        else if (c == ']' || c == '}')
+            depth--;
+
+        if (c == ',' && depth == 0) {
+            operands.push_back(trim(operand));
+            operand.clear();
+        }
+        else {
+            operand += c;
+        }
+    }
+    if (!trim(operand).empty())
+        operands.push_back(trim(operand));
+}
+
+// Rótulo ou linha escrita como está
+AsmLine::AsmLine(enum AsmLine::kind kind, const string& text):
+    kind(kind), raw(kind == LABEL ? text + ":" : text), label(kind == LABEL ? text : "")
+{}
+
+// Nome da diretiva, como .word, ou vazio se a linha não é uma
+string AsmLine::directive() {
+    string line = trim(raw);
+    if (kind != OTHER || line.empty() || line[0] != '.')
+        return "";
+    return line.substr(0, line.find_first_of(" \t"));
+}
+
+string AsmLine::text() {
+    if (!modified)
+        return raw;
+
+    string mnemonic = opcode + condition;
+    string text = "\t" + mnemonic;
+    if (!operands.empty())
+        text += string(mnemonic.size() < 9 ? 9 - mnemonic.size() : 1, ' ');
+    for (int i = 0; i < operands.size(); i++)
+        text += (i > 0 ? ", " : "") + operands[i];
+    return text;
+}
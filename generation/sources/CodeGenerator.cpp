@@ -1,281 +1,1485 @@
 #include <iostream>
+#include <cstdio>
+#include <map>
+#include <set>
+#include <algorithm>
 
 #include "syntax.hpp"
 #include "generation.hpp"
 
+#include "Peephole.hpp"
+#include "ObjectWriter.hpp"
 #include "CodeGenerator.hpp"
 
 #define STACK_SIZE 256
 
 using namespace std;
 using namespace generation;
+using namespace optimization;
 
 bool found_div = false;
 bool found_pow = false;
+bool found_bounds = false;
+bool found_smulh = false;
 
-CodeGenerator::CodeGenerator(string& input_file, string& output_file, semantic::SymbolTable& symb_table):
-    input_file(input_file), symb_table(symb_table)
+static string immediate(uint32_t value);
+
+static string reg_name(int reg) {
+    return "r" + to_string(reg);
+}
+
+CodeGenerator::CodeGenerator(string& input_file, string& output_file, semantic::SymbolTable& symb_table, optimization::Options& options):
+    input_file(input_file), symb_table(symb_table), options(options),
+    base_register(options.thumb ? 7 : 12), max_offset(options.thumb ? THUMB_MAX_OFFSET : MAX_OFFSET)
 {
-    output.open(output_file);
-    if (!output.is_open())
+    file.open(output_file, options.emit_obj ? ios::out | ios::binary : ios::out);
+    if (!file.is_open())
         throw generation_exception("Não foi possível abrir o arquivo '" + output_file + "' para saída");
 }
 
 CodeGenerator::~CodeGenerator() {
-    output.close();
+    file.close();
 }
 
-void CodeGenerator::generate_header(int first_index) {
-    output << "/* BASIC COMPILER */" << endl;
-    output << "/* source: " << input_file << " */" << endl;
-    output << ".global main" << endl;
-    output << endl;
+void CodeGenerator::generate(IR& ir) {
+    ir.leave_ssa();
 
-    output << "main: " << endl;
-    output << "\tLDR      r12, =variables" << endl;
-    output << "\tLDR      r11, =exe_stack" << endl;
-    output << "\tLDR      sp,  =exp_stack" << endl;
-    output << "\tB        L" << first_index << endl;
-    output << endl;
-}
+    main = ir.main;
+    data = ir.data;
 
-void CodeGenerator::generate_variables() {
+    vector<IRFunction*> functions = ir.functions;
+    functions.insert(functions.begin(), ir.main);
+
+    generate_header();
+
+    // Funções de usuário ficam fora do fluxo do programa principal
+    for (auto function : functions)
+        generate(function);
     install_predef();
-    output << "variables: " << endl;
-    output << "\t.space " << symb_table.total_variable_size() << endl;
-    output << endl;
-    // Espaço para a pilha
-    output << "\t.space " << STACK_SIZE << endl;
-    output << "exe_stack: " << endl;
-    output << "\t.space " << STACK_SIZE << endl;
-    output << "exp_stack: " << endl;
-    output << endl;
+
+    generate_data();
+    generate_variables();
+
+    write();
+}
+
+void CodeGenerator::emit(const string& opcode, const vector<string>& operands, const string& condition) {
+    assembly.push_back(AsmLine(opcode, operands, condition));
 }
 
-void CodeGenerator::generate(syntax::Assign* assign, vector<syntax::Elem*> exp, int next_index) {
-    output << "L" << assign->get_index() << ":" << endl;
-    generate_expression(exp);
-    output << "\tSTR      r0, [r12, #" << 4 * symb_table.select_variable(assign->get_variable()) << "]" << endl;
-    output << "\tB        L" << next_index << endl;
-    output << endl;
+void CodeGenerator::label(const string& name) {
+    assembly.push_back(AsmLine(AsmLine::LABEL, name));
 }
 
-void CodeGenerator::generate(syntax::Read* read, std::vector<pair<syntax::Var*, syntax::Num*>>& read_data, int next_index) {
-    output << "L" << read->get_index() << ":" << endl;
-    for (auto pair : read_data) {
-        syntax::Var* var = get<0>(pair);
-        syntax::Num* val = get<1>(pair);
+void CodeGenerator::directive(const string& text) {
+    assembly.push_back(AsmLine(AsmLine::OTHER, text));
+}
 
-        if (var->is_array()) {
-            syntax::ArrayAccess* access = dynamic_cast<syntax::ArrayAccess*>(var);
-            vector<syntax::Elem*> access_expression = access->get_processed_access_exps();
+void CodeGenerator::blank() {
+    directive("");
+}
 
-            generate_expression(access_expression);
+/*
+ * Passos finais sobre as instruções já geradas e escrita do arquivo de
+ * uma só vez, como texto ou, com --emit-obj, como objeto ELF
+ */
+void CodeGenerator::write() {
+    if (options.optimize) {
+        Peephole peephole(assembly, options);
+        peephole.run();
+    }
+    place_literal_pools(assembly);
 
-            output << "\tMOV      r1, r0, LSL #2" << endl;
-            output << "\tADD      r1, r1, #" << 4 * symb_table.select_variable(var) << endl;
-            output << "\tMOV      r0, #" << val->get_value() << endl;
-            output << "\tSTR      r0, [r12, r1]" << endl;
-        }
-        else {
-            output << "\tMOV      r0, #" << val->get_value() << endl;
-            output << "\tSTR      r0, [r12, #" << 4 * symb_table.select_variable(var) << "]" << endl;
+    // No Thumb, os desvios fora de alcance são trocados por sequências
+    // mais longas, e as tabelas de literais refeitas em volta delas
+    while (options.thumb && relax_branches(assembly)) {
+        remove_literal_pools(assembly);
+        place_literal_pools(assembly);
+    }
+
+    if (options.report) {
+        vector<int> addresses;
+        map<string, int> labels;
+        cout << "Tamanho do código: " << layout(assembly, addresses, labels) << " bytes" << endl;
+    }
+
+    if (options.emit_obj) {
+        ObjectWriter object(assembly);
+        object.write(file);
+    }
+    else {
+        string buffer;
+        for (auto& line : assembly) {
+            buffer += line.text();
+            buffer += '\n';
         }
+        file.write(buffer.data(), buffer.size());
     }
-    output << "\tB        L" << next_index << endl;
-    output << endl;
+    assembly.clear();
 }
 
-void CodeGenerator::generate(syntax::Data* data, std::vector<pair<syntax::Var*, syntax::Num*>>& read_data, int next_index) {
-    output << "L" << data->get_index() << ":" << endl;
-    for (auto pair : read_data) {
-        syntax::Var* var = get<0>(pair);
-        syntax::Num* val = get<1>(pair);
+/*
+ * Tabelas de literais (.ltorg) ao alcance dos LDR rX, =valor. Sem elas,
+ * o montador põe os literais no fim da seção, depois das variáveis e
+ * das pilhas. Uma tabela fica de preferência após um desvio
+ * incondicional ou retorno, quando a anterior já está a meio caminho;
+ * perto do limite, é pulada com um desvio. As tabelas são sempre
+ * esvaziadas antes de trocar de seção, pois ficam junto do código, e
+ * antes do .align da rotina em ARM do modo Thumb, que segue um retorno.
+ */
+void CodeGenerator::place_literal_pools(vector<AsmLine>& lines) {
+    vector<AsmLine> placed;
+    set<string> literals;
+    int distance = 0;
+    int pools = 0;
+    int range = options.thumb ? THUMB_LITERAL_RANGE : LITERAL_RANGE;
+
+    auto flush = [&](bool jump) {
+        if (literals.empty())
+            return;
+        string label = "pool." + to_string(pools++);
+        if (jump)
+            placed.push_back(AsmLine("B", { label }));
+        placed.push_back(AsmLine(AsmLine::OTHER, "\t.ltorg"));
+        if (jump)
+            placed.push_back(AsmLine(AsmLine::LABEL, label));
+        literals.clear();
+        distance = 0;
+    };
+
+    for (auto& line : lines) {
+        if (line.directive() == ".data" || line.directive() == ".bss" || line.directive() == ".align")
+            flush(false);
+
+        if (line.kind == AsmLine::INSTRUCTION && distance + literals.size() >= range)
+            flush(true);
+
+        placed.push_back(line);
+        if (line.kind != AsmLine::INSTRUCTION)
+            continue;
+
+        if (!literals.empty())
+            distance++;
+        if (line.operands.size() == 2 && line.operands[1][0] == '=')
+            literals.insert(line.operands[1]);
+
+        bool jump = line.is("B") || (line.is("MOV") && line.operands.size() == 2 && line.operands[0] == "pc")
+            || (line.is("BX") && line.operands[0] == "lr");
+        if (jump && distance + literals.size() >= range / 2)
+            flush(false);
+    }
+
+    lines.swap(placed);
+}
+
+// Desfaz place_literal_pools: tabelas, seus rótulos e os desvios que as pulam
+void CodeGenerator::remove_literal_pools(vector<AsmLine>& lines) {
+    auto pool = [](AsmLine& line) {
+        if (line.kind == AsmLine::LABEL)
+            return line.label.compare(0, 5, "pool.") == 0;
+        if (line.is("B"))
+            return line.operands[0].compare(0, 5, "pool.") == 0;
+        return line.directive() == ".ltorg";
+    };
+    lines.erase(remove_if(lines.begin(), lines.end(), pool), lines.end());
+}
+
+/*
+ * Endereço de cada linha e de cada rótulo de .text, com as tabelas de
+ * literais como o montador as monta; devolve o tamanho do código. No
+ * Thumb as instruções têm 2 bytes, menos BL, que tem 4, como as de ARM.
+ */
+int CodeGenerator::layout(vector<AsmLine>& lines, vector<int>& addresses, map<string, int>& labels) {
+    set<string> literals;
+    bool thumb = false;
+    int address = 0;
+
+    auto flush = [&]() {
+        if (literals.empty())
+            return;
+        address = (address + 3) & ~3;
+        address += 4 * literals.size();
+        literals.clear();
+    };
+
+    addresses.assign(lines.size(), 0);
+    for (int i = 0; i < lines.size(); i++) {
+        AsmLine& line = lines[i];
+        string directive = line.directive();
+        if (directive == ".data" || directive == ".bss")
+            break;
+
+        if (directive == ".arm" || directive == ".thumb")
+            thumb = directive == ".thumb";
+        else if (directive == ".align")
+            address = (address + 3) & ~3;
+        else if (directive == ".ltorg")
+            flush();
 
-        if (var->is_array()) {
-            syntax::ArrayAccess* access = dynamic_cast<syntax::ArrayAccess*>(var);
-            vector<syntax::Elem*> access_expression = access->get_processed_access_exps();
+        addresses[i] = address;
+        if (line.kind == AsmLine::LABEL)
+            labels[line.label] = address;
+        if (line.kind != AsmLine::INSTRUCTION)
+            continue;
 
-            generate_expression(access_expression);
+        if (line.operands.size() == 2 && line.operands[1][0] == '=')
+            literals.insert(line.operands[1]);
+        address += thumb && line.opcode != "BL" ? 2 : 4;
+    }
+    flush();
+    return address;
+}
 
-            output << "\tMOV      r1, r0, LSL #2" << endl;
-            output << "\tADD      r1, r1, #" << 4 * symb_table.select_variable(var) << endl;
-            output << "\tMOV      r0, #" << val->get_value() << endl;
-            output << "\tSTR      r0, [r12, r1]" << endl;
+/*
+ * Desvios do Thumb fora de alcance: Bcc chega a 256 bytes e B a 2 KB.
+ * Bcc vira o desvio na condição oposta sobre um B; B vira um salto por
+ * BX com o endereço em r1, livre no fim dos blocos. Falso se nenhum
+ * desvio muda.
+ */
+bool CodeGenerator::relax_branches(vector<AsmLine>& lines) {
+    static const map<string, string> opposites = {
+        { "EQ", "NE" }, { "NE", "EQ" }, { "GT", "LE" }, { "LE", "GT" }, { "LT", "GE" }, { "GE", "LT" },
+        { "HS", "LO" }, { "LO", "HS" }, { "CS", "CC" }, { "CC", "CS" }, { "HI", "LS" }, { "LS", "HI" },
+        { "MI", "PL" }, { "PL", "MI" }
+    };
+
+    vector<int> addresses;
+    map<string, int> labels;
+    layout(lines, addresses, labels);
+
+    vector<AsmLine> relaxed;
+    bool changed = false;
+    for (int i = 0; i < lines.size(); i++) {
+        AsmLine& line = lines[i];
+        if (line.kind != AsmLine::INSTRUCTION || line.opcode != "B" || !labels.count(line.operands[0])) {
+            relaxed.push_back(line);
+            continue;
+        }
+
+        string target = line.operands[0];
+        int distance = labels[target] - (addresses[i] + 4);
+        if (!line.condition.empty() && (distance < -256 || distance > 254)) {
+            string skip = "far." + to_string(local_labels++);
+            relaxed.push_back(AsmLine("B", { skip }, opposites.at(line.condition)));
+            relaxed.push_back(AsmLine("B", { target }));
+            relaxed.push_back(AsmLine(AsmLine::LABEL, skip));
+            changed = true;
+        }
+        else if (line.condition.empty() && (distance < -2048 || distance > 2046)) {
+            relaxed.push_back(AsmLine("LDR", { "r1", "=" + target + " + 1" }));
+            relaxed.push_back(AsmLine("BX", { "r1" }));
+            changed = true;
         }
         else {
-            output << "\tMOV      r0, #" << val->get_value() << endl;
-            output << "\tSTR      r0, [r12, #" << 4 * symb_table.select_variable(var) << "]" << endl;
+            relaxed.push_back(line);
         }
     }
-    output << "\tB        L" << next_index << endl;
-    output << endl;
+
+    lines.swap(relaxed);
+    return changed;
 }
 
-void CodeGenerator::generate(syntax::Goto* go, int destination) {
-    output << "L" << go->get_index() << ":" << endl;
-    output << "\tB        L" << destination << endl;
-    output << endl;
+void CodeGenerator::generate(IRFunction* function) {
+    RegisterAllocator allocation(function, options.thumb);
+    allocation.run();
+    allocator = &allocation;
+
+    // O programa principal não retorna e não precisa preservar nada
+    saved.clear();
+    if (function != main) {
+        for (auto reg : allocation.saved_registers())
+            saved += (saved.empty() ? "r" : ", r") + to_string(reg);
+    }
+
+    uses.clear();
+    for (auto b : function->blocks) {
+        for (auto instruction : b->instructions) {
+            for (auto value : instruction->operands)
+                uses[value]++;
+        }
+    }
+
+    for (int i = 0; i < function->blocks.size(); i++) {
+        block = function->blocks[i];
+        following = (i + 1 < function->blocks.size()) ? function->blocks[i + 1] : nullptr;
+
+        // A entrada do programa principal é o próprio cabeçalho
+        if (function != main || i > 0)
+            label(block->label);
+
+        if (function != main && i == 0 && !saved.empty() && !options.thumb)
+            emit("STMFD", { "r11!", "{" + saved + "}" });
+
+        // Parâmetros empilhados pelo chamador, do último para o primeiro
+        if (function != main && i == 0) {
+            for (int p = function->parameters.size() - 1; p >= 0; p--) {
+                if (options.thumb)
+                    emit("POP", { "{r1}" });
+                else
+                    emit("LDMFD", { "sp!", "{r1}" });
+                string location = address(function->parameters[p], 2);
+                emit("STR", { "r1", location });
+            }
+        }
+
+        // No Thumb, a pilha é a mesma dos parâmetros, que já saíram dela
+        if (function != main && i == 0 && !saved.empty() && options.thumb)
+            emit("PUSH", { "{" + saved + "}" });
+
+        auto& instructions = block->instructions;
+        for (int j = 0; j < instructions.size(); j++) {
+            if (instructions[j]->op == IRInstruction::MUL && j + 1 < instructions.size()
+                && instructions[j + 1]->op == IRInstruction::ADD
+                && generate_multiply_accumulate(instructions[j], instructions[j + 1])) {
+                j++;
+                continue;
+            }
+
+            if (instructions[j]->op != IRInstruction::READ) {
+                generate(instructions[j]);
+                continue;
+            }
+
+            // Leituras de posições seguidas da tabela, a partir de um só endereço
+            vector<IRInstruction*> reads(1, instructions[j]);
+            while (j + 1 < instructions.size()
+                && instructions[j + 1]->op == IRInstruction::READ
+                && instructions[j + 1]->data == reads.back()->data + 1
+                && 4 * reads.size() <= max_offset)
+                reads.push_back(instructions[++j]);
+            generate_read(reads);
+        }
+        blank();
+    }
+
+    allocator = nullptr;
 }
 
-void CodeGenerator::generate(syntax::If* ift, std::vector<syntax::Elem*> left, std::vector<syntax::Elem*> right, int destination, int next_index) {
-    output << "L" << ift->get_index() << ":" << endl;
-    generate_expression(left);
-    output << "\tSTMFD    sp!, {r0}" << endl;
-    generate_expression(right);
-    output << "\tLDMFD    sp!, {r1}" << endl;
-    output << "\tCMP      r1, r0" << endl;
-    switch (ift->get_op()) {
-        case syntax::If::EQL:
-            output << "\tBEQ      " << "L" << destination << endl;
+void CodeGenerator::generate(IRInstruction* instruction) {
+    switch (instruction->op) {
+        case IRInstruction::ADD:
+        case IRInstruction::SUB:
+        case IRInstruction::MUL:
+        case IRInstruction::DIV:
+        case IRInstruction::POW:
+            generate_arithmetic(instruction);
+            break;
+        case IRInstruction::COPY: {
+            int reg = destination(instruction->result);
+            int source = operand(instruction->operands[0], reg);
+            if (allocator->reg(instruction->result) < 0)
+                reg = source;
+            else if (source != reg)
+                move(reg, source);
+            result(instruction->result, reg);
+            break;
+        }
+        case IRInstruction::GET: {
+            int reg = destination(instruction->result);
+            string location = address(instruction->variable, reg);
+            emit("LDR", { reg_name(reg), location });
+            result(instruction->result, reg);
+            break;
+        }
+        case IRInstruction::PUT: {
+            int reg = operand(instruction->operands[0], 0);
+            string location = address(instruction->variable, reg == 1 ? 2 : 1);
+            emit("STR", { reg_name(reg), location });
+            break;
+        }
+        case IRInstruction::LOAD:
+            generate_load(instruction);
+            break;
+        case IRInstruction::STORE:
+            generate_store(instruction);
+            break;
+        case IRInstruction::CALL:
+            generate_call(instruction);
+            break;
+        case IRInstruction::PRINT:
+            // PRINT não gera código
             break;
-        case syntax::If::NEQ:
-            output << "\tBNE      " << "L" << destination << endl;
+        case IRInstruction::JUMP:
+            generate_jump(instruction->blocks[0]);
             break;
-        case syntax::If::GTN:
-            output << "\tBGT      " << "L" << destination << endl;
+        case IRInstruction::BRANCH:
+            generate_branch(instruction);
             break;
-        case syntax::If::LTN:
-            output << "\tBLT      " << "L" << destination << endl;
+        case IRInstruction::GOSUB:
+            generate_gosub(instruction);
             break;
-        case syntax::If::GEQ:
-            output << "\tBGE      " << "L" << destination << endl;
+        case IRInstruction::RETURN:
+            if (options.thumb)
+                emit("BX", { "lr" });
+            else
+                emit("MOV", { "pc", "lr" });
             break;
-        case syntax::If::LEQ:
-            output << "\tBLE      " << "L" << destination << endl;
+        case IRInstruction::HALT: {
+            // O laço final desvia para si mesmo, sem repetir as escritas
+            // do estado final que o precedem no bloco
+            string name = instruction->label;
+            if (name == block->label && block->instructions.front() != instruction)
+                name += ".fim";
+            if (name != block->label)
+                label(name);
+            emit("B", { name });
+            break;
+        }
+        case IRInstruction::RET: {
+            int reg = operand(instruction->operands[0], 0);
+            if (reg != 0)
+                move(0, reg);
+            generate_restore();
+            if (options.thumb)
+                emit("BX", { "lr" });
+            else
+                emit("MOV", { "pc", "lr" });
+            break;
+        }
+        case IRInstruction::PHI:
+        case IRInstruction::READ:
             break;
     }
-    output << "\tB        L" << next_index << endl;
-    output << endl;
 }
 
-void CodeGenerator::generate(syntax::For* loop, vector<syntax::Elem*> init, vector<syntax::Elem*> stop,
-            vector<syntax::Elem*> step, int index_inside_loop, int index_outside_loop) {
-    output << "L" << loop->get_index() << ":" << endl;
+void CodeGenerator::generate_header() {
+    directive("/* BASIC COMPILER */");
+    directive("/* source: " + input_file + " */");
+    if (options.thumb)
+        directive(".syntax unified");
+    directive(".text");
+    directive(".global main");
+    blank();
 
-    // Inicialização do iterador
-    generate_expression(init);
-    output << "\tSTR      r0, [r12, #" << 4 * symb_table.select_variable(loop->get_iterator()) << "]" << endl;
-    output << "\tB        L" << loop->get_index() << ".COMP" << endl;
-    output << endl;
+    if (!options.thumb) {
+        label("main");
+        emit("LDR", { "r12", "=variables" });
+        emit("LDR", { "r11", "=exe_stack" });
+        emit("LDR", { "sp", "=exp_stack" });
+        return;
+    }
 
-    // Incremento do iterador
-    output << "L" << loop->get_index() << ".STEP:" << endl;
-    generate_expression(step);
-    output << "\tLDR      r1, [r12, #" << 4 * symb_table.select_variable(loop->get_iterator()) << "]" << endl;
-    output << "\tADD      r0, r1, r0" << endl;
-    output << "\tSTR      r0, [r12, #" << 4 * symb_table.select_variable(loop->get_iterator()) << "]" << endl;
-    output << endl;
+    // A entrada é em ARM, que passa ao Thumb na instrução após o BX: pc
+    // é lido 8 bytes adiante, e o bit 0 do endereço pede o Thumb
+    directive(".arm");
+    label("main");
+    emit("ADD", { "r0", "pc", "#1" });
+    emit("BX", { "r0" });
+    directive(".thumb");
+    emit("LDR", { "r7", "=variables" });
+    emit("LDR", { "r0", "=exp_stack" });
+    emit("MOV", { "sp", "r0" });
+}
 
-    // Comparação com a condição de parada
-    output << "L" << loop->get_index() << ".COMP:" << endl;
-    generate_expression(stop);
-    output << "\tLDR      r1, [r12, #" << 4 * symb_table.select_variable(loop->get_iterator()) << "]" << endl;
-    output << "\tCMP      r1, r0" << endl;
-    output << "\tBGE      L" << index_outside_loop << endl;
-    output << "\tB        L" << index_inside_loop << endl;
-    output << endl;
+void CodeGenerator::generate_data() {
+    if (data.empty())
+        return;
+
+    directive(".data");
+    label("data");
+    for (int i = 0; i < data.size(); i += 8) {
+        string words;
+        for (int j = i; j < i + 8 && j < data.size(); j++)
+            words += (j > i ? ", " : "") + to_string(data[j]);
+        directive("\t.word    " + words);
+    }
+    blank();
 }
 
-void CodeGenerator::generate(syntax::Next* next) {
-    output << "L" << next->get_index() << ":" << endl;
-    output << "\tB        L" << next->get_loop()->get_index() << ".STEP" << endl;
-    output << endl;
+void CodeGenerator::generate_variables() {
+    directive(".bss");
+    label("variables");
+    directive("\t.space " + to_string(symb_table.total_variable_size()));
+    if (!slots.empty()) {
+        label("temporaries");
+        directive("\t.space " + to_string(4 * slots.size()));
+    }
+    blank();
+    // Espaço para a pilha
+    if (options.thumb) {
+        // Uma só pilha, com o espaço das duas
+        directive("\t.space " + to_string(2 * STACK_SIZE));
+        label("exp_stack");
+        blank();
+        return;
+    }
+    directive("\t.space " + to_string(STACK_SIZE));
+    label("exe_stack");
+    directive("\t.space " + to_string(STACK_SIZE));
+    label("exp_stack");
+    blank();
 }
 
-void CodeGenerator::generate(syntax::Def* def, std::vector<syntax::Elem*>& exp) {
-    output << def->get_identifier() << ":" << endl;
+void CodeGenerator::generate_arithmetic(IRInstruction* instruction) {
+    IRValue* left = instruction->operands[0];
+    IRValue* right = instruction->operands[1];
+
+    if (instruction->op == IRInstruction::DIV && !RegisterAllocator::calls(instruction)) {
+        generate_division(instruction);
+        return;
+    }
+    if (instruction->op == IRInstruction::POW && !RegisterAllocator::calls(instruction)) {
+        generate_power(instruction);
+        return;
+    }
+
+    // sdiv e pow recebem os operandos em r1 e r2 e usam r0-r5 (r0-r3 no Thumb)
+    if (instruction->op == IRInstruction::DIV || instruction->op == IRInstruction::POW) {
+        bool div = instruction->op == IRInstruction::DIV;
+        (div ? found_div : found_pow) = true;
+
+        int l = operand(left, 1);
+        if (l != 1)
+            move(1, l);
+        int r = operand(right, 2);
+        if (r != 2)
+            move(2, r);
+
+        call(div ? "sdiv" : "pow");
+
+        int reg = destination(instruction->result);
+        if (reg != 0)
+            move(reg, 0);
+        result(instruction->result, reg);
+        return;
+    }
+
+    if (instruction->op == IRInstruction::MUL) {
+        generate_multiply(instruction);
+        return;
+    }
+
+    // Constante como operando imediato: soma de constante negativa vira
+    // subtração e vice-versa; constante à esquerda de SUB vira RSB
+    bool add = instruction->op == IRInstruction::ADD;
+    if (add && left->is_constant())
+        swap(left, right);
 
-    auto parameters = def->get_parameters();
-    while (!parameters.empty()) {
-        auto param = parameters.back();
-        output << "\tLDMFD    sp!, {r1}" << endl;
-        output << "\tSTR      r1, [r12, #"
-            << 4 * symb_table.select_variable(param) << "]" << endl;
-        parameters.pop_back();
+    if (options.thumb) {
+        generate_thumb_arithmetic(instruction, add, left, right);
+        return;
+    }
+
+    if (!add && left->is_constant() && !right->is_constant() && encodable(left->id)) {
+        int r = operand(right, 2);
+        int reg = destination(instruction->result);
+        emit("RSB", { reg_name(reg), reg_name(r), immediate(left->id) });
+        result(instruction->result, reg);
+        return;
+    }
+
+    if (right->is_constant() && (encodable(right->id) || encodable(-(uint32_t) right->id))) {
+        int l = operand(left, 1);
+        int reg = destination(instruction->result);
+        uint32_t value = right->id;
+        if (!encodable(value)) {
+            value = -value;
+            add = !add;
+        }
+        emit(add ? "ADD" : "SUB", { reg_name(reg), reg_name(l), immediate(value) });
+        result(instruction->result, reg);
+        return;
+    }
+
+    int l = operand(left, 1);
+    int r = operand(right, 2);
+    int reg = destination(instruction->result);
+    emit(add ? "ADD" : "SUB", { reg_name(reg), reg_name(l), reg_name(r) });
+    result(instruction->result, reg);
+}
+
+/*
+ * Soma e subtração no Thumb, em que o imediato tem 3 bits se o destino
+ * difere do operando e 8 bits se é o mesmo; 0 - x vira NEGS
+ */
+void CodeGenerator::generate_thumb_arithmetic(IRInstruction* instruction, bool add, IRValue* left, IRValue* right) {
+    if (!add && left->is_constant() && left->id == 0 && !right->is_constant()) {
+        int r = operand(right, 2);
+        int reg = destination(instruction->result);
+        emit("NEGS", { reg_name(reg), reg_name(r) });
+        result(instruction->result, reg);
+        return;
+    }
+
+    int l = operand(left, 1);
+    int reg = destination(instruction->result);
+
+    if (right->is_constant()) {
+        uint32_t value = right->id;
+        bool op = add;
+        if (value > 0xFF) {
+            value = -value;
+            op = !op;
+        }
+        if (value <= 7) {
+            emit(op ? "ADDS" : "SUBS", { reg_name(reg), reg_name(l), immediate(value) });
+            result(instruction->result, reg);
+            return;
+        }
+        if (value <= 0xFF && reg == l) {
+            emit(op ? "ADDS" : "SUBS", { reg_name(reg), immediate(value) });
+            result(instruction->result, reg);
+            return;
+        }
+    }
+
+    int r = operand(right, 2);
+    emit(add ? "ADDS" : "SUBS", { reg_name(reg), reg_name(l), reg_name(r) });
+    result(instruction->result, reg);
+}
+
+/*
+ * Multiplicação por constante com o deslocador: c = ±m * 2^s, com m
+ * igual a 1, 2^k + 1 (ADD x, x, LSL k) ou 2^k - 1 (RSB x, x, LSL k). Só
+ * vale a pena em até duas instruções; as demais usam MUL.
+ */
+bool CodeGenerator::multiply_constant(int reg, int x, int c) {
+    vector<AsmLine> code;
+    uint32_t m = c < 0 ? -(uint32_t) c : c;
+    bool negative = c < 0;
+    int shift = 0;
+
+    if (m == 0) {
+        materialize(reg, 0);
+        return true;
+    }
+    while (!(m & 1)) {
+        m >>= 1;
+        shift++;
+    }
+
+    string r = reg_name(reg), rx = reg_name(x);
+    auto power = [](uint32_t v) { return v && !(v & (v - 1)); };
+    auto log2 = [](uint32_t v) { int k = 0; while (v >>= 1) k++; return k; };
+
+    // No Thumb não há operando deslocado: 2^k ± 1 passa por r2
+    if (options.thumb) {
+        if (m == 1 && shift > 0)
+            code.push_back(AsmLine("LSLS", { r, rx, "#" + to_string(shift) }));
+        else if (m == 1)
+            code.push_back(negative ? AsmLine("NEGS", { r, rx }) : AsmLine("MOVS", { r, rx }));
+        else if (shift == 0 && !negative && (power(m - 1) || power(m + 1))) {
+            code.push_back(AsmLine("LSLS", { "r2", rx, "#" + to_string(log2(power(m - 1) ? m - 1 : m + 1)) }));
+            code.push_back(AsmLine(power(m - 1) ? "ADDS" : "SUBS", { r, "r2", rx }));
+        }
+        else
+            return false;
+        if (m == 1 && shift > 0 && negative)
+            code.push_back(AsmLine("NEGS", { r, r }));
+
+        assembly.insert(assembly.end(), code.begin(), code.end());
+        return true;
+    }
+
+    if (m == 1) {
+        if (shift > 0) {
+            code.push_back(AsmLine("MOV", { r, rx, "LSL #" + to_string(shift) }));
+        }
+        else {
+            code.push_back(negative ? AsmLine("RSB", { r, rx, "#0" }) : AsmLine("MOV", { r, rx }));
+            negative = false;
+        }
+    }
+    else if (power(m - 1)) {
+        code.push_back(AsmLine("ADD", { r, rx, rx, "LSL #" + to_string(log2(m - 1)) }));
+    }
+    else if (power(m + 1)) {
+        // x - x * 2^k já é o produto negativo
+        bool direct = negative && shift == 0;
+        code.push_back(AsmLine(direct ? "SUB" : "RSB", { r, rx, rx, "LSL #" + to_string(log2(m + 1)) }));
+        negative = negative && !direct;
+    }
+    else {
+        return false;
     }
 
-    generate_expression(exp);
-    output << "\tMOV      pc, lr" << endl;
-    output << endl;
+    if (shift > 0 && m != 1)
+        code.push_back(AsmLine("MOV", { r, r, "LSL #" + to_string(shift) }));
+    if (negative)
+        code.push_back(AsmLine("RSB", { r, r, "#0" }));
+    if (code.size() > 2)
+        return false;
+
+    assembly.insert(assembly.end(), code.begin(), code.end());
+    return true;
 }
 
-void CodeGenerator::generate(syntax::Gosub* gosub, int destination) {
-    output << "L" << gosub->get_index() << ":" << endl;
-    output << "\tSTMFD    r11!, {lr}" << endl;
-    output << "\tBL       L" << destination << endl;
-    output << "\tLDMFD    r11!, {lr}" << endl;
-    output << endl;
+void CodeGenerator::generate_multiply(IRInstruction* instruction) {
+    IRValue* left = instruction->operands[0];
+    IRValue* right = instruction->operands[1];
+    if (left->is_constant())
+        swap(left, right);
+
+    if (right->is_constant()) {
+        int x = operand(left, 1);
+        int reg = destination(instruction->result);
+        if (multiply_constant(reg, x, right->id)) {
+            result(instruction->result, reg);
+            return;
+        }
+    }
+
+    int l = operand(left, 1);
+    int r = operand(right, 2);
+    int reg = destination(instruction->result);
+
+    // No ARMv4, MUL não aceita o destino igual ao primeiro operando
+    if (l == reg)
+        swap(l, r);
+    if (l == reg) {
+        move(1, l);
+        l = 1;
+    }
+
+    // MULS do Thumb tem o destino também como segundo operando
+    if (options.thumb) {
+        if (r != reg)
+            move(reg, r);
+        emit("MULS", { reg_name(reg), reg_name(l), reg_name(reg) });
+    }
+    else {
+        emit("MUL", { reg_name(reg), reg_name(l), reg_name(r) });
+    }
+    result(instruction->result, reg);
 }
 
-void CodeGenerator::generate(syntax::Return* ret) {
-    output << "L" << ret->get_index() << ":" << endl;
-    output << "\tMOV      pc, lr" << endl;
-    output << endl;
+/*
+ * a * b + c em uma instrução, quando o produto só é usado pela soma
+ * seguinte
+ */
+bool CodeGenerator::generate_multiply_accumulate(IRInstruction* mul, IRInstruction* add) {
+    IRValue* product = mul->result;
+
+    // O Thumb não tem MLA
+    if (options.thumb)
+        return false;
+    if (mul->operands[0]->is_constant() || mul->operands[1]->is_constant() || uses[product] != 1)
+        return false;
+    if (add->operands[0] != product && add->operands[1] != product)
+        return false;
+
+    IRValue* addend = add->operands[add->operands[0] == product ? 1 : 0];
+    int l = operand(mul->operands[0], 1);
+    int r = operand(mul->operands[1], 2);
+    int c = operand(addend, 0);
+    int reg = destination(add->result);
+
+    // Como em MUL, o destino não pode ser o primeiro operando
+    if (l == reg)
+        swap(l, r);
+    if (l == reg) {
+        emit("MOV", { "r1", reg_name(l) });
+        l = 1;
+    }
+    emit("MLA", { reg_name(reg), reg_name(l), reg_name(r), reg_name(c) });
+    result(add->result, reg);
+    return true;
 }
 
-void CodeGenerator::generate(syntax::End* end) {
-    output << "L" << end->get_index() << ":" << endl;
-    output << "\tB        L" << end->get_index() << endl;
-    output << endl;
+/*
+ * Multiplicador m e deslocamento s tais que n / d = (n * m) >> (32 + s)
+ * para todo n de 32 bits, truncado para zero (Hacker's Delight, 10-1);
+ * d >= 2 e não é potência de 2
+ */
+static void magic(uint32_t d, int32_t& multiplier, int& shift) {
+    const uint32_t two31 = 0x80000000;
+    uint32_t anc = two31 - 1 - two31 % d;
+    uint32_t q1 = two31 / anc, r1 = two31 - q1 * anc;
+    uint32_t q2 = two31 / d, r2 = two31 - q2 * d;
+    uint32_t delta;
+    int p = 31;
+
+    do {
+        p++;
+        q1 *= 2;
+        r1 *= 2;
+        if (r1 >= anc) {
+            q1++;
+            r1 -= anc;
+        }
+        q2 *= 2;
+        r2 *= 2;
+        if (r2 >= d) {
+            q2++;
+            r2 -= d;
+        }
+        delta = d - r2;
+    } while (q1 < delta || (q1 == delta && r1 == 0));
+
+    multiplier = q2 + 1;
+    shift = p - 32;
 }
 
-void CodeGenerator::generate_expression(vector<syntax::Elem*>& exp) {
-    for (auto e : exp) {
-        if (e->get_elem_type() == syntax::Elem::NUM) {
-            output << "\tMOV      r1, #" << dynamic_cast<syntax::Num*>(e)->get_value() << endl;
-            output << "\tSTMFD    sp!, {r1}" << endl;
+/*
+ * Divisão por constante sem chamar sdiv, com o mesmo truncamento para
+ * zero. Potências de 2 viram um deslocamento aritmético, somando antes
+ * d - 1 aos dividendos negativos; os demais divisores usam a parte alta
+ * de SMULL pelo recíproco, mais 1 se o dividendo é negativo. Divisor
+ * negativo troca o sinal do quociente. O Thumb não tem SMULL, que fica
+ * na rotina smulh, em ARM.
+ */
+void CodeGenerator::generate_division(IRInstruction* instruction) {
+    int n = operand(instruction->operands[0], 0);
+    int d = instruction->operands[1]->id;
+    uint32_t divisor = d < 0 ? -(uint32_t) d : d;
+    int reg = destination(instruction->result);
+
+    if (divisor == 1) {
+        move(reg, n);
+    }
+    else if (options.thumb && (divisor & (divisor - 1)) == 0) {
+        int k = 0;
+        while ((1u << k) != divisor)
+            k++;
+
+        if (k == 1) {
+            emit("LSRS", { "r1", reg_name(n), "#31" });
         }
-        else if (e->get_elem_type() == syntax::Elem::VAR) {
-            syntax::Var* var = dynamic_cast<syntax::Var*>(e);
+        else {
+            emit("ASRS", { "r1", reg_name(n), "#31" });
+            emit("LSRS", { "r1", "r1", "#" + to_string(32 - k) });
+        }
+        emit("ADDS", { "r1", "r1", reg_name(n) });
+        emit("ASRS", { reg_name(reg), "r1", "#" + to_string(k) });
+    }
+    else if (options.thumb) {
+        int32_t multiplier;
+        int shift;
+        magic(divisor, multiplier, shift);
 
-            if (var->is_array()) {
-                syntax::ArrayAccess* access = dynamic_cast<syntax::ArrayAccess*>(var);
-                output << "\tLDMFD    sp!, {r1}" << endl;
-                output << "\tMOV      r1, r1, LSL #2" << endl;
-                output << "\tADD      r1, r1, #" << 4 * symb_table.select_variable(var) << endl;
-                output << "\tLDR      r1, [r12, r1]" << endl;
-                output << "\tSTMFD    sp!, {r1}" << endl;
-            }
-            else {
-                output << "\tLDR      r1, [r12, #" << 4 * symb_table.select_variable(var) << "]" << endl;
-                output << "\tSTMFD    sp!, {r1}" << endl;
-            }
+        found_smulh = true;
+        materialize(2, multiplier);
+        move(1, n);
+        call("smulh");
+        if (multiplier < 0)
+            emit("ADDS", { "r2", "r2", reg_name(n) });
+        if (shift > 0)
+            emit("ASRS", { "r2", "r2", "#" + to_string(shift) });
+        emit("LSRS", { "r1", reg_name(n), "#31" });
+        emit("ADDS", { reg_name(reg), "r2", "r1" });
+    }
+    else if ((divisor & (divisor - 1)) == 0) {
+        int k = 0;
+        while ((1u << k) != divisor)
+            k++;
+
+        if (k == 1) {
+            emit("ADD", { "r1", reg_name(n), reg_name(n), "LSR #31" });
         }
-        else if (e->get_elem_type() == syntax::Elem::FUN) {
-            output << "\tSTMFD    r11!, {lr}" << endl;
-            output << "\tBL       " << dynamic_cast<syntax::Call*>(e)->get_identifier() << endl;
-            output << "\tLDMFD    r11!, {lr}" << endl;
-            output << "\tSTMFD    sp!, {r0}" << endl;
-        }
-        else if (e->is_operator()) {
-            output << "\tLDMFD    sp!, {r2}" << endl;
-            output << "\tLDMFD    sp!, {r1}" << endl;
-            if (e->get_elem_type() == syntax::Elem::ADD) {
-                output << "\tADD      r0, r1, r2" << endl;
-            }
-            else if (e->get_elem_type() == syntax::Elem::SUB) {
-                output << "\tSUB      r0, r1, r2" << endl;
-            }
-            else if (e->get_elem_type() == syntax::Elem::MUL) {
-                output << "\tMUL      r0, r1, r2" << endl;
-            }
-            else if (e->get_elem_type() == syntax::Elem::DIV) {
-                found_div = true;
-                output << "\tSTMFD    r11!, {lr}" << endl;
-                output << "\tBL       sdiv" << endl;
-                output << "\tLDMFD    r11!, {lr}" << endl;
-            }
-            else if (e->get_elem_type() == syntax::Elem::POW) {
-                found_pow = true;
-                output << "\tSTMFD    r11!, {lr}" << endl;
-                output << "\tBL       pow" << endl;
-                output << "\tLDMFD    r11!, {lr}" << endl;
+        else {
+            emit("MOV", { "r1", reg_name(n), "ASR #31" });
+            emit("ADD", { "r1", reg_name(n), "r1", "LSR #" + to_string(32 - k) });
+        }
+        emit("MOV", { reg_name(reg), "r1", "ASR #" + to_string(k) });
+    }
+    else {
+        int32_t multiplier;
+        int shift;
+        magic(divisor, multiplier, shift);
+
+        // No ARMv4, RdLo, RdHi e Rm de SMULL devem ser distintos; Rs não
+        materialize(2, multiplier);
+        emit("SMULL", { "r1", "r2", reg_name(n), "r2" });
+        if (multiplier < 0)
+            emit("ADD", { "r2", "r2", reg_name(n) });
+        if (shift > 0)
+            emit("MOV", { "r2", "r2", "ASR #" + to_string(shift) });
+        emit("ADD", { reg_name(reg), "r2", reg_name(n), "LSR #31" });
+    }
+
+    if (d < 0 && options.thumb)
+        emit("NEGS", { reg_name(reg), reg_name(reg) });
+    else if (d < 0)
+        emit("RSB", { reg_name(reg), reg_name(reg), "#0" });
+    result(instruction->result, reg);
+}
+
+// Passo de uma cadeia de adições: elemento = chain[first] + chain[second]
+typedef pair<int, int> ChainStep;
+
+// Busca em profundidade de uma cadeia com length passos até exponent
+static bool search(vector<int>& chain, vector<ChainStep>& steps, int exponent, int length) {
+    int last = chain.back();
+    if (last == exponent)
+        return true;
+    if (steps.size() == length)
+        return false;
+
+    // Nem dobrando o maior elemento a cada passo se chega ao expoente
+    long long bound = last;
+    for (int s = steps.size(); s < length; s++)
+        bound *= 2;
+    if (bound < exponent)
+        return false;
+
+    for (int i = chain.size() - 1; i >= 0; i--) {
+        for (int j = i; j >= 0; j--) {
+            int next = chain[i] + chain[j];
+            if (next <= last)
+                break;
+            if (next > exponent)
+                continue;
+
+            chain.push_back(next);
+            steps.push_back(ChainStep(i, j));
+            if (search(chain, steps, exponent, length))
+                return true;
+            chain.pop_back();
+            steps.pop_back();
+        }
+    }
+    return false;
+}
+
+// Cadeia de adições mais curta até exponent, por aprofundamento iterativo
+static vector<ChainStep> shortest_chain(int exponent) {
+    vector<int> chain(1, 1);
+    vector<ChainStep> steps;
+    for (int length = 0; !search(chain, steps, exponent, length); length++)
+        ;
+    return steps;
+}
+
+// Cadeia do método binário: dobra a cada bit e soma 1 nos bits 1
+static vector<ChainStep> binary_chain(int exponent) {
+    vector<ChainStep> steps;
+    int top = 31;
+    while (!(exponent >> top & 1))
+        top--;
+    for (int bit = top - 1; bit >= 0; bit--) {
+        int last = steps.size();
+        steps.push_back(ChainStep(last, last));
+        if (exponent >> bit & 1)
+            steps.push_back(ChainStep(last + 1, 0));
+    }
+    return steps;
+}
+
+/*
+ * Multiplicações da cadeia, com o elemento 1 (a base) em base e os
+ * demais em r0-r2; o último vai para reg. Falso se os elementos vivos
+ * não cabem nos registradores livres. No Thumb, MULS escreve no segundo
+ * operando, e o produto prefere o registrador de um fator que morre.
+ */
+static bool multiply_chain(vector<ChainStep>& steps, int base, int reg, vector<AsmLine>& code, bool thumb) {
+    int n = steps.size();
+    vector<int> regs(n + 1, -1), last_use(n + 1, 0);
+    regs[0] = base;
+    for (int i = 0; i < n; i++) {
+        last_use[steps[i].first] = i + 1;
+        last_use[steps[i].second] = i + 1;
+    }
+
+    set<int> available;
+    for (int r = 0; r <= 2; r++) {
+        if (r != base)
+            available.insert(r);
+    }
+
+    for (int i = 1; i <= n; i++) {
+        int a = regs[steps[i - 1].first];
+        int b = regs[steps[i - 1].second];
+        for (auto e : { steps[i - 1].first, steps[i - 1].second }) {
+            if (e > 0 && last_use[e] == i)
+                available.insert(regs[e]);
+        }
+
+        // No ARMv4, o destino de MUL não pode ser o primeiro operando,
+        // então um quadrado não pode ir para o registrador do operando
+        int target = -1;
+        if (i == n && !(a == reg && b == reg)) {
+            target = reg;
+        }
+        else if (thumb && a != b && (available.count(a) || available.count(b))) {
+            target = available.count(b) ? b : a;
+        }
+        else {
+            for (auto r : available) {
+                if (target < 0 || target == a || target == b) {
+                    if (r != a || a != b)
+                        target = r;
+                }
             }
-            output << "\tSTMFD    sp!, {r0}" << endl;
+            if (target < 0 || (target == a && a == b))
+                return false;
+        }
+        if (target == a)
+            swap(a, b);
+
+        available.erase(target);
+        regs[i] = target;
+        if (!thumb) {
+            code.push_back(AsmLine("MUL", { reg_name(target), reg_name(a), reg_name(b) }));
+            continue;
+        }
+        if (target != b)
+            code.push_back(AsmLine("MOVS", { reg_name(target), reg_name(b) }));
+        code.push_back(AsmLine("MULS", { reg_name(target), reg_name(a), reg_name(target) }));
+    }
+
+    if (regs[n] != reg)
+        code.push_back(AsmLine(thumb ? "MOVS" : "MOV", { reg_name(reg), reg_name(regs[n]) }));
+    return true;
+}
+
+/*
+ * Potência de expoente constante sem chamar pow: a base é multiplicada
+ * pela cadeia de adições mais curta até o expoente, ou pela do método
+ * binário se a mais curta precisa de mais registradores. Como em pow,
+ * a potência de base 0 ou de expoente negativo é 0.
+ */
+void CodeGenerator::generate_power(IRInstruction* instruction) {
+    int base = operand(instruction->operands[0], 2);
+    int exponent = instruction->operands[1]->id;
+    int reg = destination(instruction->result);
+
+    if (exponent < 0) {
+        materialize(reg, 0);
+    }
+    else if (exponent == 0 && options.thumb) {
+        // Sem execução condicional: o bit 31 de -x | x é 1 se x não é 0
+        emit("NEGS", { "r1", reg_name(base) });
+        emit("ORRS", { "r1", reg_name(base) });
+        emit("LSRS", { reg_name(reg), "r1", "#31" });
+    }
+    else if (exponent == 0) {
+        emit("CMP", { reg_name(base), "#0" });
+        emit("MOV", { reg_name(reg), "#1" }, "NE");
+        emit("MOV", { reg_name(reg), "#0" }, "EQ");
+    }
+    else if (exponent == 1) {
+        move(reg, base);
+    }
+    else {
+        vector<AsmLine> code;
+        vector<ChainStep> steps = shortest_chain(exponent);
+        if (!multiply_chain(steps, base, reg, code, options.thumb)) {
+            code.clear();
+            steps = binary_chain(exponent);
+            multiply_chain(steps, base, reg, code, options.thumb);
         }
+        assembly.insert(assembly.end(), code.begin(), code.end());
+    }
+    result(instruction->result, reg);
+}
+
+// Índice constante dentro do vetor, que dispensa a verificação
+static bool constant_index(IRInstruction* access) {
+    IRValue* index = access->operands[0];
+    return index->is_constant() && index->id >= 0 && index->id < access->variable->get_size() / 4;
+}
+
+/*
+ * Endereço do elemento: deslocamento fixo para índice constante; senão,
+ * o índice multiplicado por 4 pelo deslocador, somado ao início do vetor
+ * em r1. No Thumb, o deslocamento inteiro fica em r1, somado a r7.
+ */
+string CodeGenerator::element(IRInstruction* access, int scratch) {
+    int offset = 4 * symb_table.select_variable(access->variable);
+    if (constant_index(access))
+        return memory(offset + 4 * access->operands[0]->id, scratch);
+
+    int index = operand(access->operands[0], 2);
+    generate_bounds_check(access, index);
+
+    if (options.thumb) {
+        emit("LSLS", { "r1", reg_name(index), "#2" });
+        if (offset > 0 && offset <= 0xFF) {
+            emit("ADDS", { "r1", immediate(offset) });
+        }
+        else if (offset > 0xFF) {
+            // O valor de um STR só é carregado depois, em r0
+            int other = scratch == 1 ? 0 : scratch;
+            materialize(other, offset);
+            emit("ADDS", { "r1", "r1", reg_name(other) });
+        }
+        return "[r7, r1]";
+    }
+
+    if (offset == 0)
+        return "[r12, r" + to_string(index) + ", LSL #2]";
+    add_constant(1, 12, offset);
+    return "[r1, r" + to_string(index) + ", LSL #2]";
+}
+
+void CodeGenerator::generate_load(IRInstruction* load) {
+    int reg = destination(load->result);
+    string location = element(load, reg == 0 ? 1 : reg);
+    emit("LDR", { reg_name(reg), location });
+    result(load->result, reg);
+}
+
+void CodeGenerator::generate_store(IRInstruction* store) {
+    string location = element(store, 1);
+    int value = operand(store->operands[1], 0);
+    emit("STR", { reg_name(value), location });
+}
+
+/*
+ * Os valores lidos ficam na tabela de DATA; leituras de posições
+ * seguidas carregam cada valor direto no seu registrador, a partir do
+ * endereço da primeira
+ */
+void CodeGenerator::generate_read(vector<IRInstruction*>& reads) {
+    emit("LDR", { "r0", "=data + " + to_string(4 * reads[0]->data) });
+    for (int r = 0; r < reads.size(); r++) {
+        int reg = allocator->reg(reads[r]->result) < 0 ? 1 : destination(reads[r]->result);
+        if (r == 0)
+            emit("LDR", { reg_name(reg), "[r0]" });
+        else
+            emit("LDR", { reg_name(reg), "[r0, #" + to_string(4 * r) + "]" });
+        result(reads[r]->result, reg);
+    }
+}
+
+/*
+ * Argumentos empilhados em ordem; a função os desempilha. Os valores
+ * vivos após a chamada estão em r6-r10 (r4-r6 no Thumb), preservados
+ * pela função. No Thumb, lr vai para a pilha antes dos argumentos.
+ */
+void CodeGenerator::generate_call(IRInstruction* call) {
+    if (options.thumb)
+        save_link();
+
+    for (auto arg : call->operands) {
+        int reg = operand(arg, 1);
+        if (options.thumb)
+            emit("PUSH", { "{" + reg_name(reg) + "}" });
+        else
+            emit("STMFD", { "sp!", "{" + reg_name(reg) + "}" });
+    }
+
+    if (!options.thumb)
+        save_link();
+    emit("BL", { call->function });
+    restore_link();
+
+    int reg = destination(call->result);
+    if (reg != 0)
+        move(reg, 0);
+    result(call->result, reg);
+}
+
+void CodeGenerator::generate_gosub(IRInstruction* gosub) {
+    call(gosub->blocks[0]->label);
+    if (gosub->blocks[1])
+        generate_jump(gosub->blocks[1]);
+}
+
+// Registradores preservados guardados na entrada da função
+void CodeGenerator::generate_restore() {
+    if (!saved.empty() && options.thumb)
+        emit("POP", { "{" + saved + "}" });
+    else if (!saved.empty())
+        emit("LDMFD", { "r11!", "{" + saved + "}" });
+}
+
+// lr guardado em exe_stack ou, no Thumb, na pilha única
+void CodeGenerator::save_link() {
+    if (options.thumb)
+        emit("PUSH", { "{lr}" });
+    else
+        emit("STMFD", { "r11!", "{lr}" });
+}
+
+// POP do Thumb não escreve em lr, que volta por r1
+void CodeGenerator::restore_link() {
+    if (options.thumb) {
+        emit("POP", { "{r1}" });
+        emit("MOV", { "lr", "r1" });
+    }
+    else {
+        emit("LDMFD", { "r11!", "{lr}" });
+    }
+}
+
+// Chamada de uma rotina ou sub-rotina, que não toca a pilha
+void CodeGenerator::call(const string& target) {
+    save_link();
+    emit("BL", { target });
+    restore_link();
+}
+
+/*
+ * Cópia entre registradores; no Thumb, MOV entre r0-r7 só existe a
+ * partir do ARMv6, e MOVS serve
+ */
+void CodeGenerator::move(int reg, int source) {
+    emit(options.thumb ? "MOVS" : "MOV", { reg_name(reg), reg_name(source) });
+}
+
+// Desvio dispensado quando o destino é o bloco emitido em seguida
+void CodeGenerator::generate_jump(IRBlock* destination) {
+    if (destination != following)
+        emit("B", { destination->label });
+}
+
+/*
+ * Desvio para blocks[0] na condição e para blocks[1] nos demais casos.
+ * Se blocks[0] é o bloco emitido em seguida, desvia para blocks[1] na
+ * condição oposta e segue para blocks[0] sem desvio.
+ */
+void CodeGenerator::generate_branch(IRInstruction* branch) {
+    static const char* conditions[] = { "EQ", "NE", "GT", "LT", "GE", "LE" };
+    static const char* opposites[] = { "NE", "EQ", "LE", "GE", "LT", "GT" };
+
+    // Condição com os operandos trocados
+    static const syntax::If::cmp mirrored[] = {
+        syntax::If::EQL, syntax::If::NEQ, syntax::If::LTN, syntax::If::GTN, syntax::If::LEQ, syntax::If::GEQ
+    };
+
+    IRBlock* target = branch->blocks[0];
+    IRBlock* next = branch->blocks[1];
+    IRValue* left = branch->operands[0];
+    IRValue* right = branch->operands[1];
+    syntax::If::cmp condition = branch->condition;
+
+    // A constante fica à direita, como imediato de CMP ou, negada, de CMN
+    if (left->is_constant() && !right->is_constant()) {
+        swap(left, right);
+        condition = mirrored[condition];
+    }
+
+    // No Thumb, CMP tem imediatos de 8 bits, e CMN, só registradores
+    int l = operand(left, 1);
+    if (options.thumb && right->is_constant() && (uint32_t) right->id <= 0xFF) {
+        emit("CMP", { reg_name(l), immediate(right->id) });
+    }
+    else if (options.thumb && right->is_constant() && -(uint32_t) right->id <= 0xFF) {
+        materialize(2, -right->id);
+        emit("CMN", { reg_name(l), "r2" });
+    }
+    else if (right->is_constant() && !options.thumb && encodable(right->id)) {
+        emit("CMP", { reg_name(l), immediate(right->id) });
+    }
+    else if (right->is_constant() && !options.thumb && encodable(-(uint32_t) right->id)) {
+        emit("CMN", { reg_name(l), immediate(-(uint32_t) right->id) });
+    }
+    else {
+        int r = operand(right, 2);
+        emit("CMP", { reg_name(l), reg_name(r) });
+    }
+
+    if (target == next) {
+        generate_jump(next);
+    }
+    else if (target == following) {
+        emit("B", { next->label }, opposites[condition]);
+    }
+    else {
+        emit("B", { target->label }, conditions[condition]);
+        generate_jump(next);
+    }
+}
+
+/*
+ * Índice linearizado fora do vetor: a comparação sem sinal também
+ * rejeita índices negativos
+ */
+void CodeGenerator::generate_bounds_check(IRInstruction* access, int index) {
+    if (!access->checked)
+        return;
+
+    found_bounds = true;
+    int size = access->variable->get_size() / 4;
+    if (options.thumb ? size <= 0xFF : encodable(size)) {
+        emit("CMP", { reg_name(index), immediate(size) });
+    }
+    else {
+        materialize(0, size);
+        emit("CMP", { reg_name(index), "r0" });
+    }
+
+    // O Thumb não tem BL condicional
+    if (options.thumb) {
+        string next = "bounds." + to_string(local_labels++);
+        emit("B", { next }, "LO");
+        emit("BL", { "bounds_error" });
+        label(next);
+        return;
+    }
+    emit("BL", { "bounds_error" }, "HS");
+}
+
+/*
+ * Registrador com o valor: o alocado a ele ou reg, onde a constante ou
+ * o valor guardado na área de temporários é carregado
+ */
+int CodeGenerator::operand(IRValue* value, int reg) {
+    if (value->is_constant()) {
+        materialize(reg, value->id);
+        return reg;
+    }
+
+    int allocated = allocator->reg(value);
+    if (allocated >= 0)
+        return allocated;
+
+    string location = slot(value, reg);
+    emit("LDR", { reg_name(reg), location });
+    return reg;
+}
+
+// Registrador em que o resultado é calculado: o alocado ou r0
+int CodeGenerator::destination(IRValue* value) {
+    int allocated = allocator->reg(value);
+    return allocated >= 0 ? allocated : 0;
+}
+
+// Guarda reg na área de temporários se o resultado não tem registrador
+void CodeGenerator::result(IRValue* value, int reg) {
+    if (allocator->reg(value) < 0) {
+        string location = slot(value, reg == 2 ? 1 : 2);
+        emit("STR", { reg_name(reg), location });
+    }
+}
+
+// Posição do valor na área de temporários; scratch pode receber o endereço
+string CodeGenerator::slot(IRValue* value, int scratch) {
+    if (!slots.count(value)) {
+        int position = slots.size();
+        slots[value] = position;
+    }
+    return memory(symb_table.total_variable_size() + 4 * slots[value], scratch);
+}
+
+string CodeGenerator::address(syntax::Var* var, int scratch) {
+    return memory(4 * symb_table.select_variable(var), scratch);
+}
+
+/*
+ * Operando de memória a partir de r12. LDR e STR aceitam deslocamentos
+ * até 4095; acima disso, a parte alta é somada a r12 em scratch. No
+ * Thumb, a partir de r7, até 124; acima disso, o deslocamento todo vai
+ * para scratch.
+ */
+string CodeGenerator::memory(int offset, int scratch) {
+    if (options.thumb && offset <= THUMB_MAX_OFFSET)
+        return "[r7, #" + to_string(offset) + "]";
+    if (options.thumb) {
+        materialize(scratch, offset);
+        return "[r7, r" + to_string(scratch) + "]";
+    }
+
+    if (offset <= MAX_OFFSET)
+        return "[r12, #" + to_string(offset) + "]";
+
+    add_constant(scratch, 12, offset & ~MAX_OFFSET);
+    offset &= MAX_OFFSET;
+    return offset ? "[r" + to_string(scratch) + ", #" + to_string(offset) + "]" : "[r" + to_string(scratch) + "]";
+}
+
+/*
+ * Imediato de instrução de processamento de dados: 8 bits rotacionados
+ * à direita por um número par de posições
+ */
+bool CodeGenerator::encodable(uint32_t value) {
+    for (int rotation = 0; rotation < 32; rotation += 2) {
+        uint32_t rotated = (value << rotation) | (rotation ? value >> (32 - rotation) : 0);
+        if (rotated <= 0xFF)
+            return true;
+    }
+    return false;
+}
+
+// Formato do imediato: decimal se pequeno, hexadecimal nos demais casos
+static string immediate(uint32_t value) {
+    if (value < 256)
+        return "#" + to_string(value);
+
+    char text[16];
+    snprintf(text, sizeof(text), "#0x%X", value);
+    return text;
+}
+
+/*
+ * Divide o valor em duas partes de 8 bits rotacionados que não se
+ * sobrepõem; falso se não há divisão
+ */
+static bool split(uint32_t value, uint32_t& high, uint32_t& low) {
+    for (int rotation = 0; rotation < 32; rotation += 2) {
+        uint32_t mask = (0xFFu << rotation) | (rotation > 24 ? 0xFFu >> (32 - rotation) : 0);
+        low = value & mask;
+        high = value & ~mask;
+        if (low && CodeGenerator::encodable(low) && CodeGenerator::encodable(high))
+            return true;
+    }
+    return false;
+}
+
+/*
+ * Constante em reg pelo caminho de menos ciclos no ARM7TDMI: MOV ou MVN
+ * (1 ciclo), MOV e ORR ou MVN e BIC (2 ciclos) ou, por fim, LDR da
+ * tabela de literais (3 ciclos), que o montador compartilha entre as
+ * constantes iguais de um mesmo trecho. No Thumb, MOVS tem só 8 bits,
+ * seguido de MVNS ou de LSLS para os negativos pequenos e os deslocados.
+ */
+void CodeGenerator::materialize(int reg, int value) {
+    uint32_t bits = value;
+    uint32_t high, low;
+
+    if (options.thumb) {
+        int shift = 0;
+        while (bits && !(bits >> shift & 1))
+            shift++;
+
+        if (bits <= 0xFF) {
+            emit("MOVS", { reg_name(reg), immediate(bits) });
+        }
+        else if (~bits <= 0xFF) {
+            emit("MOVS", { reg_name(reg), immediate(~bits) });
+            emit("MVNS", { reg_name(reg), reg_name(reg) });
+        }
+        else if (bits >> shift <= 0xFF) {
+            emit("MOVS", { reg_name(reg), immediate(bits >> shift) });
+            emit("LSLS", { reg_name(reg), reg_name(reg), "#" + to_string(shift) });
+        }
+        else {
+            emit("LDR", { reg_name(reg), "=" + to_string(value) });
+        }
+        return;
+    }
+
+    if (encodable(bits)) {
+        emit("MOV", { reg_name(reg), immediate(bits) });
+    }
+    else if (encodable(~bits)) {
+        emit("MVN", { reg_name(reg), immediate(~bits) });
+    }
+    else if (split(bits, high, low)) {
+        emit("MOV", { reg_name(reg), immediate(high) });
+        emit("ORR", { reg_name(reg), reg_name(reg), immediate(low) });
+    }
+    else if (split(~bits, high, low)) {
+        emit("MVN", { reg_name(reg), immediate(high) });
+        emit("BIC", { reg_name(reg), reg_name(reg), immediate(low) });
+    }
+    else {
+        emit("LDR", { reg_name(reg), "=" + to_string(value) });
+    }
+}
+
+/*
+ * reg = base + value, com value não negativo. Até duas somas de
+ * imediatos; acima disso, o valor é carregado em reg, que não pode ser
+ * a base.
+ */
+void CodeGenerator::add_constant(int reg, int base, int value) {
+    uint32_t bits = value;
+    uint32_t high, low;
+
+    if (encodable(bits)) {
+        emit("ADD", { reg_name(reg), reg_name(base), immediate(bits) });
+    }
+    else if (split(bits, high, low)) {
+        emit("ADD", { reg_name(reg), reg_name(base), immediate(low) });
+        emit("ADD", { reg_name(reg), reg_name(reg), immediate(high) });
+    }
+    else {
+        int scratch = (reg == base) ? 2 : reg;
+        materialize(scratch, value);
+        emit("ADD", { reg_name(reg), reg_name(base), reg_name(scratch) });
     }
-    output << "\tLDMFD    sp!, {r0}" << endl;
 }
 
 void CodeGenerator::install_predef() {
@@ -283,6 +1487,10 @@ void CodeGenerator::install_predef() {
         install_sdiv();
     if (found_pow)
         install_pow();
+    if (found_bounds)
+        install_bounds_error();
+    if (found_smulh)
+        install_smulh();
 }
 
 /*
@@ -290,74 +1498,172 @@ void CodeGenerator::install_predef() {
  * r0 = r1 / r2
  * Divisão inteira
  * r0 = 0 se r1 = 0
+ * No Thumb, usa só r0-r3, com o sinal do quociente na pilha
  */
 void CodeGenerator::install_sdiv() {
-    output << "sdiv:" << endl;
-    output << "\tMOV      r4, #0" << endl;
-    output << "\tMOV      r5, #0" << endl;
-    output << endl;
-    output << "\tCMP      r2, #0" << endl;
-    output << "\tBEQ      sdiv.end" << endl;
-    output << "\tMOVLT    r4, #1" << endl;
-    output << "\tRSBLT    r2, r2, #0" << endl;
-    output << endl;
-    output << "\tCMP      r1, #0" << endl;
-    output << "\tMOVLT    r5, #1" << endl;
-    output << "\tRSBLT    r1, r1, #0" << endl;
-    output << "\tEOR      r4, r4, r5" << endl;
-    output << endl;
-    output << "\tMOV      r0, #0" << endl;
-    output << "\tMOV      r3, #1" << endl;
-    output << endl;
-    output << "sdiv.start:" << endl;
-    output << "\tCMP      r2, r1" << endl;
-    output << "\tMOVLS    r2, r2, LSL #1" << endl;
-    output << "\tMOVLS    r3, r3, LSL #1" << endl;
-    output << "\tBLS      sdiv.start" << endl;
-    output << endl;
-    output << "sdiv.next:" << endl;
-    output << "\tCMP       r1, r2" << endl;
-    output << "\tSUBCS     r1, r1, r2" << endl;
-    output << "\tADDCS     r0, r0, r3" << endl;
-    output << "\tMOVS      r3, r3, LSR #1" << endl;
-    output << "\tMOVCC     r2, r2, LSR #1" << endl;
-    output << "\tBCC       sdiv.next" << endl;
-    output << endl;
-    output << "sdiv.end:" << endl;
-    output << "\tCMP      r4, #1" << endl;
-    output << "\tRSBEQ    r0, r0, #0" << endl;
-    output << "\tMOV      pc, lr" << endl;
-    output << endl;
+    label("sdiv");
+    if (options.thumb) {
+        emit("MOVS", { "r0", "#0" });
+        emit("CMP", { "r2", "#0" });
+        emit("B", { "sdiv.end" }, "EQ");
+        emit("MOVS", { "r3", "r1" });
+        emit("EORS", { "r3", "r2" });
+        emit("PUSH", { "{r3}" });
+        blank();
+        // |x| = (x ^ s) - s, com s = x >> 31
+        emit("ASRS", { "r3", "r2", "#31" });
+        emit("EORS", { "r2", "r3" });
+        emit("SUBS", { "r2", "r2", "r3" });
+        emit("ASRS", { "r3", "r1", "#31" });
+        emit("EORS", { "r1", "r3" });
+        emit("SUBS", { "r1", "r1", "r3" });
+        emit("MOVS", { "r3", "#1" });
+        blank();
+        label("sdiv.start");
+        emit("CMP", { "r2", "r1" });
+        emit("B", { "sdiv.next" }, "HI");
+        emit("LSLS", { "r2", "r2", "#1" });
+        emit("LSLS", { "r3", "r3", "#1" });
+        emit("B", { "sdiv.start" });
+        blank();
+        label("sdiv.next");
+        emit("CMP", { "r1", "r2" });
+        emit("B", { "sdiv.shift" }, "CC");
+        emit("SUBS", { "r1", "r1", "r2" });
+        emit("ADDS", { "r0", "r0", "r3" });
+        label("sdiv.shift");
+        emit("LSRS", { "r2", "r2", "#1" });
+        emit("LSRS", { "r3", "r3", "#1" });
+        emit("B", { "sdiv.next" }, "NE");
+        blank();
+        emit("POP", { "{r3}" });
+        emit("CMP", { "r3", "#0" });
+        emit("B", { "sdiv.end" }, "GE");
+        emit("NEGS", { "r0", "r0" });
+        label("sdiv.end");
+        emit("BX", { "lr" });
+        blank();
+        return;
+    }
+
+    emit("MOV", { "r4", "#0" });
+    emit("MOV", { "r5", "#0" });
+    blank();
+    emit("CMP", { "r2", "#0" });
+    emit("B", { "sdiv.end" }, "EQ");
+    emit("MOV", { "r4", "#1" }, "LT");
+    emit("RSB", { "r2", "r2", "#0" }, "LT");
+    blank();
+    emit("CMP", { "r1", "#0" });
+    emit("MOV", { "r5", "#1" }, "LT");
+    emit("RSB", { "r1", "r1", "#0" }, "LT");
+    emit("EOR", { "r4", "r4", "r5" });
+    blank();
+    emit("MOV", { "r0", "#0" });
+    emit("MOV", { "r3", "#1" });
+    blank();
+    label("sdiv.start");
+    emit("CMP", { "r2", "r1" });
+    emit("MOV", { "r2", "r2", "LSL #1" }, "LS");
+    emit("MOV", { "r3", "r3", "LSL #1" }, "LS");
+    emit("B", { "sdiv.start" }, "LS");
+    blank();
+    label("sdiv.next");
+    emit("CMP", { "r1", "r2" });
+    emit("SUB", { "r1", "r1", "r2" }, "CS");
+    emit("ADD", { "r0", "r0", "r3" }, "CS");
+    emit("MOVS", { "r3", "r3", "LSR #1" });
+    emit("MOV", { "r2", "r2", "LSR #1" }, "CC");
+    emit("B", { "sdiv.next" }, "CC");
+    blank();
+    label("sdiv.end");
+    emit("CMP", { "r4", "#1" });
+    emit("RSB", { "r0", "r0", "#0" }, "EQ");
+    emit("MOV", { "pc", "lr" });
+    blank();
 }
 
 /*
  * POW r0, r1, r2
  * r0 = r1 ^ r2
- * Potenciação simples de inteiros
- * r0 = 0 se r2 < 0
+ * Potenciação de inteiros por quadrados sucessivos
+ * r0 = 0 se r1 = 0 ou r2 < 0
  */
 void CodeGenerator::install_pow() {
-    output << "pow:" << endl;
-    output << "\tCMP      r1, #0" << endl;
-    output << "\tMOVEQ    r0, #0" << endl;
-    output << "\tBEQ      pow.end" << endl;
-    output << "\t" << endl;
-    output << "\tCMP      r2, #0" << endl;
-    output << "\tMOVLT    r0, #0" << endl;
-    output << "\tBEQ      pow.end" << endl;
-    output << "\t" << endl;
-    output << "\tMOV      r0, #1" << endl;
-    output << "\tMOV      r3, r2" << endl;
-    output << endl;
-    output << "pow.loop:" << endl;
-    output << "\tCMP      r3, #0" << endl;
-    output << "\tBEQ      pow.end" << endl;
-    output << "\tMOV      r4, r0" << endl;
-    output << "\tMUL      r0, r4, r1" << endl;
-    output << "\tSUB      r3, r3, #1" << endl;
-    output << "\tB        pow.loop" << endl;
-    output << endl;
-    output << "pow.end:" << endl;
-    output << "\tMOV      pc, lr" << endl;
-    output << endl;
+    label("pow");
+    if (options.thumb) {
+        emit("MOVS", { "r0", "#0" });
+        emit("CMP", { "r1", "#0" });
+        emit("B", { "pow.end" }, "EQ");
+        emit("CMP", { "r2", "#0" });
+        emit("B", { "pow.end" }, "LT");
+        emit("MOVS", { "r0", "#1" });
+        blank();
+        label("pow.loop");
+        emit("LSRS", { "r2", "r2", "#1" });
+        emit("B", { "pow.square" }, "CC");
+        emit("MULS", { "r0", "r1", "r0" });
+        label("pow.square");
+        emit("CMP", { "r2", "#0" });
+        emit("B", { "pow.end" }, "EQ");
+        emit("MOVS", { "r3", "r1" });
+        emit("MULS", { "r1", "r3", "r1" });
+        emit("B", { "pow.loop" });
+        blank();
+        label("pow.end");
+        emit("BX", { "lr" });
+        blank();
+        return;
+    }
+
+    emit("CMP", { "r1", "#0" });
+    emit("MOV", { "r0", "#0" }, "EQ");
+    emit("B", { "pow.end" }, "EQ");
+    blank();
+    emit("CMP", { "r2", "#0" });
+    emit("MOV", { "r0", "#0" }, "LT");
+    emit("B", { "pow.end" }, "LT");
+    blank();
+    emit("MOV", { "r0", "#1" });
+    blank();
+    label("pow.loop");
+    emit("MOVS", { "r2", "r2", "LSR #1" });
+    emit("MUL", { "r3", "r0", "r1" }, "CS");
+    emit("MOV", { "r0", "r3" }, "CS");
+    emit("B", { "pow.end" }, "EQ");
+    emit("MUL", { "r3", "r1", "r1" });
+    emit("MOV", { "r1", "r3" });
+    emit("B", { "pow.loop" });
+    blank();
+    label("pow.end");
+    emit("MOV", { "pc", "lr" });
+    blank();
+}
+
+/*
+ * Acesso fora dos limites de um vetor no modo --bounds-check
+ * A execução para aqui, com lr logo após o acesso que falhou
+ */
+void CodeGenerator::install_bounds_error() {
+    label("bounds_error");
+    emit("B", { "bounds_error" });
+    blank();
+}
+
+/*
+ * SMULH r2, r1, r2 (só no Thumb)
+ * r2 = parte alta de r1 * r2, com sinal, para a divisão por constante
+ * O Thumb não tem SMULL: a rotina passa ao ARM por BX pc, que lê o
+ * endereço 4 bytes adiante, alinhado, e volta ao Thumb por BX lr
+ */
+void CodeGenerator::install_smulh() {
+    directive("\t.align 2");
+    label("smulh");
+    emit("BX", { "pc" });
+    emit("NOP", {});
+    directive(".arm");
+    emit("SMULL", { "r12", "r2", "r1", "r2" });
+    emit("BX", { "lr" });
+    directive(".thumb");
+    blank();
 }
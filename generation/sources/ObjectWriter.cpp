@@ -0,0 +1,714 @@
+#include <string>
+#include <vector>
+#include <map>
+#include <algorithm>
+
+#include "generation.hpp"
+
+#include "ObjectWriter.hpp"
+
+// Seções do programa, na ordem em que ficam no objeto
+#define TEXT 0
+#define DATA 1
+#define BSS 2
+
+#define EM_ARM 40
+#define EF_ARM_EABI_VER5 0x05000000
+
+#define SHT_PROGBITS 1
+#define SHT_SYMTAB 2
+#define SHT_STRTAB 3
+#define SHT_NOBITS 8
+#define SHT_REL 9
+
+#define SHF_WRITE 0x1
+#define SHF_ALLOC 0x2
+#define SHF_EXECINSTR 0x4
+#define SHF_INFO_LINK 0x40
+
+#define STB_LOCAL 0
+#define STB_GLOBAL 1
+#define STT_NOTYPE 0
+#define STT_SECTION 3
+
+#define R_ARM_ABS32 2
+
+// Maior deslocamento imediato de LDR e STR
+#define MAX_TRANSFER_OFFSET 4095
+
+#define ELF_HEADER_SIZE 52
+#define SECTION_HEADER_SIZE 40
+#define SYMBOL_SIZE 16
+#define RELOCATION_SIZE 8
+
+using namespace std;
+using namespace generation;
+
+static string trim(const string& s) {
+    size_t begin = s.find_first_not_of(" \t");
+    if (begin == string::npos)
+        return "";
+    size_t end = s.find_last_not_of(" \t");
+    return s.substr(begin, end - begin + 1);
+}
+
+// Separa por vírgulas fora de [] e {}
+static vector<string> split(const string& text) {
+    vector<string> parts;
+    string part;
+    int depth = 0;
+    for (char c : text) {
+        if (c == '[' || c == '{')
+            depth++;
+        else if (c == ']' || c == '}')
+            depth--;
+
+        if (c == ',' && depth == 0) {
+            parts.push_back(trim(part));
+            part.clear();
+        }
+        else {
+            part += c;
+        }
+    }
+    if (!trim(part).empty())
+        parts.push_back(trim(part));
+    return parts;
+}
+
+static bool parse_integer(const string& text, int64_t& value) {
+    string s = trim(text);
+    if (!s.empty() && s[0] == '#')
+        s = trim(s.substr(1));
+    if (s.empty())
+        return false;
+
+    size_t end;
+    try {
+        value = stoll(s, &end, 0);
+    }
+    catch (...) {
+        return false;
+    }
+    return end == s.size();
+}
+
+static int64_t integer(const string& text) {
+    int64_t value;
+    if (!parse_integer(text, value))
+        throw generation_exception("Número inválido no assembly: '" + text + "'");
+    return value;
+}
+
+static bool is_immediate(const string& operand) {
+    return !operand.empty() && operand[0] == '#';
+}
+
+static int register_number(const string& name) {
+    if (name == "sp")
+        return 13;
+    if (name == "lr")
+        return 14;
+    if (name == "pc")
+        return 15;
+
+    int64_t number;
+    if (name.size() < 2 || name[0] != 'r' || !parse_integer(name.substr(1), number) || number < 0 || number > 15)
+        throw generation_exception("Registrador inválido no assembly: '" + name + "'");
+    return number;
+}
+
+static uint32_t condition_code(const string& condition) {
+    static const map<string, uint32_t> codes = {
+        { "EQ", 0 }, { "NE", 1 }, { "CS", 2 }, { "HS", 2 }, { "CC", 3 }, { "LO", 3 },
+        { "MI", 4 }, { "PL", 5 }, { "VS", 6 }, { "VC", 7 }, { "HI", 8 }, { "LS", 9 },
+        { "GE", 10 }, { "LT", 11 }, { "GT", 12 }, { "LE", 13 }, { "AL", 14 }, { "", 14 }
+    };
+    return codes.at(condition);
+}
+
+/*
+ * Imediato de 8 bits girado para a direita por um número par de bits;
+ * como o GNU as, fica com a menor rotação que serve
+ */
+static uint32_t rotated_immediate(uint32_t value, const string& text) {
+    for (int rotation = 0; rotation < 32; rotation += 2) {
+        uint32_t chunk = rotation == 0 ? value : (value << rotation) | (value >> (32 - rotation));
+        if (chunk <= 0xFF)
+            return (1 << 25) | (rotation / 2 << 8) | chunk;
+    }
+    throw generation_exception("Imediato não codificável em uma instrução: '" + text + "'");
+}
+
+// Deslocamento de um registrador por constante: LSL #2, ASR #31, ...
+static uint32_t shift(const string& text) {
+    static const map<string, uint32_t> types = { { "LSL", 0 }, { "LSR", 1 }, { "ASR", 2 }, { "ROR", 3 } };
+
+    string s = trim(text);
+    if (s == "RRX")
+        return 3 << 5;
+
+    size_t space = s.find_first_of(" \t");
+    auto type = types.find(s.substr(0, space));
+    if (space == string::npos || type == types.end() || !is_immediate(trim(s.substr(space))))
+        throw generation_exception("Deslocamento inválido no assembly: '" + text + "'");
+
+    int64_t amount = integer(s.substr(space));
+    if (amount == 0)
+        return 0;
+    if (amount < 0 || amount > 32 || (amount == 32 && type->second != 1 && type->second != 2))
+        throw generation_exception("Deslocamento inválido no assembly: '" + text + "'");
+    return ((amount & 31) << 7) | (type->second << 5);
+}
+
+// Segundo operando de uma instrução de dados: #imediato ou rM[, desloc]
+static uint32_t operand2(const vector<string>& operands, int first) {
+    if (is_immediate(operands[first])) {
+        if (operands.size() != first + 1)
+            throw generation_exception("Operandos a mais no assembly: '" + operands.back() + "'");
+        return rotated_immediate(integer(operands[first]), operands[first]);
+    }
+
+    uint32_t word = register_number(operands[first]);
+    if (operands.size() == first + 2)
+        word |= shift(operands[first + 1]);
+    else if (operands.size() != first + 1)
+        throw generation_exception("Operandos a mais no assembly: '" + operands.back() + "'");
+    return word;
+}
+
+static void put8(string& out, uint8_t value) {
+    out += char(value);
+}
+
+static void put16(string& out, uint16_t value) {
+    put8(out, value & 0xFF);
+    put8(out, value >> 8);
+}
+
+static void put32(string& out, uint32_t value) {
+    put16(out, value & 0xFFFF);
+    put16(out, value >> 16);
+}
+
+static void align(string& out) {
+    while (out.size() % 4)
+        put8(out, 0);
+}
+
+// Nome na tabela de strings, que começa com uma string vazia
+static uint32_t add_string(string& table, const string& name) {
+    if (name.empty())
+        return 0;
+    uint32_t offset = table.size();
+    table += name;
+    table += '\0';
+    return offset;
+}
+
+ObjectWriter::ObjectWriter(vector<AsmLine>& lines):
+    lines(lines)
+{
+    sections.push_back(ObjectSection(".text", SHT_PROGBITS, SHF_ALLOC | SHF_EXECINSTR));
+    sections.push_back(ObjectSection(".data", SHT_PROGBITS, SHF_WRITE | SHF_ALLOC));
+    sections.push_back(ObjectSection(".bss", SHT_NOBITS, SHF_WRITE | SHF_ALLOC));
+
+    symbols.push_back({ "", -1, 0, 0 });
+    for (int s = 0; s < sections.size(); s++)
+        symbols.push_back({ "", s, 0, STB_LOCAL << 4 | STT_SECTION });
+}
+
+void ObjectWriter::write(ostream& out) {
+    layout();
+    encode();
+
+    string buffer = serialize();
+    out.write(buffer.data(), buffer.size());
+}
+
+// Literal de LDR rX, =valor: número, símbolo ou símbolo + número
+static ObjectLiteral parse_literal(const string& text) {
+    int64_t value;
+    if (parse_integer(text, value))
+        return { "", int32_t(value) };
+
+    size_t sign = text.find_first_of("+-");
+    if (sign == string::npos)
+        return { trim(text), 0 };
+
+    int64_t offset = integer(text.substr(sign + 1));
+    return { trim(text.substr(0, sign)), int32_t(text[sign] == '-' ? -offset : offset) };
+}
+
+void ObjectWriter::switch_section(const string& name) {
+    for (int s = 0; s < sections.size(); s++) {
+        if (sections[s].name == name)
+            section = s;
+    }
+}
+
+/*
+ * Primeira passagem: posição dos rótulos e das tabelas de literais. Os
+ * literais repetidos ficam uma vez só em cada tabela, e os que faltam
+ * esvaziar vão para o fim da seção, como faz o GNU as.
+ */
+void ObjectWriter::layout() {
+    section = TEXT;
+    offsets.assign(sections.size(), 0);
+
+    vector<vector<ObjectLiteral>> pending(sections.size());
+    vector<vector<pair<int, int>>> waiting(sections.size());
+
+    auto flush = [&](int s, int key) {
+        if (pending[s].empty())
+            return;
+        offsets[s] = (offsets[s] + 3) & ~3u;
+        for (auto& w : waiting[s])
+            literal_address[w.first] = offsets[s] + 4 * w.second;
+        offsets[s] += 4 * pending[s].size();
+        pools[key] = pending[s];
+        pending[s].clear();
+        waiting[s].clear();
+    };
+
+    for (int i = 0; i < lines.size(); i++) {
+        AsmLine& line = lines[i];
+
+        if (line.kind == AsmLine::LABEL) {
+            if (labels.count(line.label))
+                throw generation_exception("Rótulo repetido no assembly: '" + line.label + "'");
+            labels[line.label] = { section, offsets[section] };
+            continue;
+        }
+
+        if (line.kind == AsmLine::INSTRUCTION) {
+            if (line.opcode == "LDR" && line.operands.size() == 2 && line.operands[1][0] == '=') {
+                ObjectLiteral literal = parse_literal(line.operands[1].substr(1));
+                int entry = 0;
+                while (entry < pending[section].size() && (pending[section][entry] < literal || literal < pending[section][entry]))
+                    entry++;
+                if (entry == pending[section].size())
+                    pending[section].push_back(literal);
+                waiting[section].push_back({ i, entry });
+            }
+            offsets[section] += 4;
+            continue;
+        }
+
+        string directive = line.directive();
+        string arguments = trim(trim(line.raw).substr(directive.size()));
+        if (directive == ".text" || directive == ".data" || directive == ".bss")
+            switch_section(directive);
+        else if (directive == ".global")
+            globals.push_back(arguments);
+        else if (directive == ".word")
+            offsets[section] += 4 * split(arguments).size();
+        else if (directive == ".space")
+            offsets[section] += integer(arguments);
+        else if (directive == ".ltorg")
+            flush(section, i);
+        else if (!directive.empty())
+            throw generation_exception("Diretiva não suportada no objeto: '" + directive + "'");
+    }
+
+    for (int s = 0; s < sections.size(); s++)
+        flush(s, lines.size() + s);
+}
+
+/*
+ * Segunda passagem: bytes de cada seção, símbolos dos rótulos e os de
+ * mapeamento, que marcam onde começam código ($a) e dados ($d)
+ */
+void ObjectWriter::encode() {
+    section = TEXT;
+    offsets.assign(sections.size(), 0);
+    mapping.assign(sections.size(), 0);
+
+    for (int i = 0; i < lines.size(); i++) {
+        AsmLine& line = lines[i];
+
+        if (line.kind == AsmLine::LABEL) {
+            if (find(globals.begin(), globals.end(), line.label) == globals.end())
+                symbols.push_back({ line.label, section, offsets[section], STB_LOCAL << 4 | STT_NOTYPE });
+            continue;
+        }
+
+        if (line.kind == AsmLine::INSTRUCTION) {
+            mapping_symbol('a');
+            emit_word(encode(i, offsets[section]));
+            continue;
+        }
+
+        string directive = line.directive();
+        string arguments = trim(trim(line.raw).substr(directive.size()));
+        if (directive == ".text" || directive == ".data" || directive == ".bss") {
+            switch_section(directive);
+        }
+        else if (directive == ".word") {
+            mapping_symbol('d');
+            for (auto& word : split(arguments))
+                emit_word(integer(word));
+        }
+        else if (directive == ".space") {
+            if (section != BSS)
+                mapping_symbol('d');
+            for (int64_t n = integer(arguments); n > 0; n--) {
+                if (section != BSS)
+                    sections[section].bytes.push_back(0);
+                offsets[section]++;
+            }
+        }
+        else if (directive == ".ltorg" && pools.count(i)) {
+            emit_pool(pools[i]);
+        }
+    }
+
+    for (int s = 0; s < sections.size(); s++) {
+        section = s;
+        if (pools.count(lines.size() + s))
+            emit_pool(pools[lines.size() + s]);
+        sections[s].size = offsets[s];
+    }
+
+    for (auto& name : globals) {
+        auto it = labels.find(name);
+        if (it == labels.end())
+            symbols.push_back({ name, -1, 0, STB_GLOBAL << 4 | STT_NOTYPE });
+        else
+            symbols.push_back({ name, it->second.first, it->second.second, STB_GLOBAL << 4 | STT_NOTYPE });
+    }
+}
+
+void ObjectWriter::emit_word(uint32_t word) {
+    vector<uint8_t>& bytes = sections[section].bytes;
+    for (int i = 0; i < 4; i++)
+        bytes.push_back((word >> (8 * i)) & 0xFF);
+    offsets[section] += 4;
+}
+
+/*
+ * Tabela de literais; um endereço vira uma relocação contra o símbolo
+ * da seção do rótulo, com o deslocamento guardado na própria palavra
+ */
+void ObjectWriter::emit_pool(vector<ObjectLiteral>& literals) {
+    while (offsets[section] % 4) {
+        sections[section].bytes.push_back(0);
+        offsets[section]++;
+    }
+    mapping_symbol('d');
+
+    for (auto& literal : literals) {
+        if (literal.symbol.empty()) {
+            emit_word(literal.value);
+            continue;
+        }
+
+        auto it = labels.find(literal.symbol);
+        if (it == labels.end())
+            throw generation_exception("Símbolo indefinido no assembly: '" + literal.symbol + "'");
+        sections[section].relocations.push_back({ offsets[section], 1 + it->second.first });
+        emit_word(it->second.second + literal.value);
+    }
+}
+
+/*
+ * Como no GNU as, uma seção que começa com dados só ganha $d no início
+ * se depois tiver código; a que só tem dados fica sem símbolos ('D')
+ */
+void ObjectWriter::mapping_symbol(char kind) {
+    char& state = mapping[section];
+    if (state == kind || (state == 'D' && kind == 'd'))
+        return;
+
+    if (state == 0 && kind == 'd') {
+        state = 'D';
+        return;
+    }
+    if (state == 'D')
+        symbols.push_back({ "$d", section, 0, STB_LOCAL << 4 | STT_NOTYPE });
+
+    state = kind;
+    symbols.push_back({ string("$") + kind, section, offsets[section], STB_LOCAL << 4 | STT_NOTYPE });
+}
+
+uint32_t ObjectWriter::encode(int i, uint32_t address) {
+    static const map<string, int> data_processing = {
+        { "AND", 0 }, { "EOR", 1 }, { "SUB", 2 }, { "RSB", 3 }, { "ADD", 4 }, { "ADC", 5 }, { "SBC", 6 }, { "RSC", 7 },
+        { "TST", 8 }, { "TEQ", 9 }, { "CMP", 10 }, { "CMN", 11 }, { "ORR", 12 }, { "MOV", 13 }, { "BIC", 14 }, { "MVN", 15 }
+    };
+
+    AsmLine& line = lines[i];
+    string opcode = line.opcode;
+    bool set_flags = false;
+    if (opcode.size() > 3 && opcode.back() == 'S' && (data_processing.count(opcode.substr(0, 3)) || opcode == "MULS" || opcode == "MLAS")) {
+        opcode.pop_back();
+        set_flags = true;
+    }
+
+    uint32_t word;
+    if (data_processing.count(opcode))
+        word = encode_data_processing(line, data_processing.at(opcode), set_flags);
+    else if (opcode == "MUL" || opcode == "MLA" || opcode == "SMULL" || opcode == "UMULL")
+        word = encode_multiply(line, opcode, set_flags);
+    else if (opcode == "LDR" || opcode == "STR")
+        word = encode_transfer(i, address);
+    else if (opcode == "LDMFD" || opcode == "LDMIA" || opcode == "STMFD" || opcode == "STMDB")
+        word = encode_multiple(line);
+    else if (opcode == "B" || opcode == "BL" || opcode == "BX")
+        word = encode_branch(line, address);
+    else
+        throw generation_exception("Instrução não suportada no objeto: '" + line.text() + "'");
+
+    return condition_code(line.condition) << 28 | word;
+}
+
+uint32_t ObjectWriter::encode_data_processing(AsmLine& line, int opcode, bool set_flags) {
+    vector<string>& operands = line.operands;
+    bool compare = opcode >= 8 && opcode <= 11;
+    bool move = opcode == 13 || opcode == 15;
+
+    if (operands.size() < 2 || (!compare && !move && operands.size() < 3))
+        throw generation_exception("Faltam operandos no assembly: '" + line.text() + "'");
+
+    uint32_t rd = compare ? 0 : register_number(operands[0]);
+    uint32_t rn = move ? 0 : register_number(operands[compare ? 0 : 1]);
+    int first = compare || move ? 1 : 2;
+
+    return opcode << 21 | (set_flags || compare) << 20 | rn << 16 | rd << 12 | operand2(operands, first);
+}
+
+// MUL rD, rM, rS; MLA rD, rM, rS, rN; SMULL e UMULL rLo, rHi, rM, rS
+uint32_t ObjectWriter::encode_multiply(AsmLine& line, const string& opcode, bool set_flags) {
+    vector<string>& operands = line.operands;
+    int count = opcode == "MUL" ? 3 : 4;
+    if (operands.size() != count)
+        throw generation_exception("Operandos inválidos no assembly: '" + line.text() + "'");
+
+    uint32_t word = set_flags << 20 | 0x90;
+    if (opcode == "SMULL" || opcode == "UMULL") {
+        word |= (opcode == "SMULL" ? 0x00C00000 : 0x00800000);
+        word |= register_number(operands[1]) << 16 | register_number(operands[0]) << 12;
+        return word | register_number(operands[3]) << 8 | register_number(operands[2]);
+    }
+
+    word |= register_number(operands[0]) << 16 | register_number(operands[2]) << 8 | register_number(operands[1]);
+    if (opcode == "MLA")
+        word |= 1 << 21 | register_number(operands[3]) << 12;
+    return word;
+}
+
+/*
+ * LDR e STR com endereço [rN], [rN, #d] ou [rN, rM, desloc]; LDR rX,
+ * =valor lê o literal da tabela, relativo a pc
+ */
+uint32_t ObjectWriter::encode_transfer(int i, uint32_t address) {
+    AsmLine& line = lines[i];
+    vector<string>& operands = line.operands;
+    if (operands.size() != 2)
+        throw generation_exception("Operandos inválidos no assembly: '" + line.text() + "'");
+
+    uint32_t word = 0x04000000 | 1 << 24 | (line.opcode == "LDR") << 20 | register_number(operands[0]) << 12;
+
+    string target = operands[1];
+    if (target[0] == '=') {
+        int64_t offset = int64_t(literal_address.at(i)) - (address + 8);
+        if (offset < -MAX_TRANSFER_OFFSET || offset > MAX_TRANSFER_OFFSET)
+            throw generation_exception("Tabela de literais fora de alcance no assembly: '" + line.text() + "'");
+        return word | (offset >= 0) << 23 | 15 << 16 | (offset >= 0 ? offset : -offset);
+    }
+
+    if (target.size() < 2 || target[0] != '[' || target.back() != ']')
+        throw generation_exception("Endereço inválido no assembly: '" + target + "'");
+    vector<string> parts = split(target.substr(1, target.size() - 2));
+    if (parts.empty() || parts.size() > 3)
+        throw generation_exception("Endereço inválido no assembly: '" + target + "'");
+
+    word |= register_number(parts[0]) << 16;
+    if (parts.size() == 1)
+        return word | 1 << 23;
+
+    if (is_immediate(parts[1])) {
+        int64_t offset = integer(parts[1]);
+        if (parts.size() > 2 || offset < -MAX_TRANSFER_OFFSET || offset > MAX_TRANSFER_OFFSET)
+            throw generation_exception("Endereço inválido no assembly: '" + target + "'");
+        return word | (offset >= 0) << 23 | (offset >= 0 ? offset : -offset);
+    }
+
+    bool subtract = parts[1][0] == '-';
+    word |= 1 << 25 | !subtract << 23 | register_number(subtract ? parts[1].substr(1) : parts[1]);
+    if (parts.size() == 3)
+        word |= shift(parts[2]);
+    return word;
+}
+
+// LDMFD rN!, {lista} (LDMIA) e STMFD rN!, {lista} (STMDB)
+uint32_t ObjectWriter::encode_multiple(AsmLine& line) {
+    vector<string>& operands = line.operands;
+    if (operands.size() != 2 || operands[1].size() < 2 || operands[1][0] != '{' || operands[1].back() != '}')
+        throw generation_exception("Operandos inválidos no assembly: '" + line.text() + "'");
+
+    bool load = line.opcode[0] == 'L';
+    string base = operands[0];
+    bool writeback = base.back() == '!';
+    if (writeback)
+        base.pop_back();
+
+    uint32_t list = 0;
+    for (auto& item : split(operands[1].substr(1, operands[1].size() - 2))) {
+        size_t dash = item.find('-');
+        int first = register_number(trim(item.substr(0, dash)));
+        int last = dash == string::npos ? first : register_number(trim(item.substr(dash + 1)));
+        for (int r = first; r <= last; r++)
+            list |= 1 << r;
+    }
+
+    return 0x08000000 | !load << 24 | load << 23 | writeback << 21 | load << 20 | register_number(base) << 16 | list;
+}
+
+uint32_t ObjectWriter::encode_branch(AsmLine& line, uint32_t address) {
+    if (line.operands.size() != 1)
+        throw generation_exception("Operandos inválidos no assembly: '" + line.text() + "'");
+
+    if (line.opcode == "BX")
+        return 0x012FFF10 | register_number(line.operands[0]);
+
+    auto it = labels.find(line.operands[0]);
+    if (it == labels.end() || it->second.first != section)
+        throw generation_exception("Destino de desvio indefinido no assembly: '" + line.operands[0] + "'");
+
+    int64_t offset = (int64_t(it->second.second) - (address + 8)) >> 2;
+    if (offset < -(1 << 23) || offset >= (1 << 23))
+        throw generation_exception("Destino de desvio fora de alcance no assembly: '" + line.operands[0] + "'");
+    return 0x0A000000 | (line.opcode == "BL") << 24 | (offset & 0xFFFFFF);
+}
+
+/*
+ * Objeto ELF32: cabeçalho, conteúdo das seções, das relocações e das
+ * tabelas de símbolos e de strings, e por fim os cabeçalhos das seções
+ */
+string ObjectWriter::serialize() {
+    // Índice de cada seção do programa e da de relocações que a segue
+    vector<int> index(sections.size()), relocation_index(sections.size(), 0);
+    int count = 1;
+    for (int s = 0; s < sections.size(); s++) {
+        index[s] = count++;
+        if (!sections[s].relocations.empty())
+            relocation_index[s] = count++;
+    }
+    int symtab_index = count++;
+    int strtab_index = count++;
+    int shstrtab_index = count++;
+
+    // Locais primeiro, como pede o ELF
+    vector<int> order;
+    for (int pass = 0; pass < 2; pass++) {
+        for (int i = 0; i < symbols.size(); i++) {
+            if ((symbols[i].info >> 4 == STB_LOCAL) == (pass == 0))
+                order.push_back(i);
+        }
+    }
+    vector<int> position(symbols.size());
+    int first_global = symbols.size();
+    for (int i = 0; i < order.size(); i++) {
+        position[order[i]] = i;
+        if (symbols[order[i]].info >> 4 != STB_LOCAL && first_global == symbols.size())
+            first_global = i;
+    }
+
+    string strtab(1, '\0');
+    string symtab;
+    for (int i : order) {
+        ObjectSymbol& symbol = symbols[i];
+        put32(symtab, add_string(strtab, symbol.name));
+        put32(symtab, symbol.value);
+        put32(symtab, 0);
+        put8(symtab, symbol.info);
+        put8(symtab, 0);
+        put16(symtab, symbol.section < 0 ? 0 : index[symbol.section]);
+    }
+
+    string out(ELF_HEADER_SIZE, '\0');
+    vector<uint32_t> offset(sections.size()), relocation_offset(sections.size());
+    for (int s = 0; s < sections.size(); s++) {
+        align(out);
+        offset[s] = out.size();
+        out.append(sections[s].bytes.begin(), sections[s].bytes.end());
+
+        align(out);
+        relocation_offset[s] = out.size();
+        for (auto& relocation : sections[s].relocations) {
+            put32(out, relocation.offset);
+            put32(out, position[relocation.symbol] << 8 | R_ARM_ABS32);
+        }
+    }
+    align(out);
+    uint32_t symtab_offset = out.size();
+    out += symtab;
+    uint32_t strtab_offset = out.size();
+    out += strtab;
+
+    string shstrtab(1, '\0');
+    vector<uint32_t> names(sections.size()), relocation_names(sections.size());
+    for (int s = 0; s < sections.size(); s++) {
+        names[s] = add_string(shstrtab, sections[s].name);
+        if (relocation_index[s])
+            relocation_names[s] = add_string(shstrtab, ".rel" + sections[s].name);
+    }
+    uint32_t symtab_name = add_string(shstrtab, ".symtab");
+    uint32_t strtab_name = add_string(shstrtab, ".strtab");
+    uint32_t shstrtab_name = add_string(shstrtab, ".shstrtab");
+    uint32_t shstrtab_offset = out.size();
+    out += shstrtab;
+    align(out);
+    uint32_t headers_offset = out.size();
+
+    auto header = [&](uint32_t name, uint32_t type, uint32_t flags, uint32_t offset, uint32_t size,
+                      uint32_t link, uint32_t info, uint32_t alignment, uint32_t entry_size) {
+        put32(out, name);
+        put32(out, type);
+        put32(out, flags);
+        put32(out, 0);
+        put32(out, offset);
+        put32(out, size);
+        put32(out, link);
+        put32(out, info);
+        put32(out, alignment);
+        put32(out, entry_size);
+    };
+
+    header(0, 0, 0, 0, 0, 0, 0, 0, 0);
+    for (int s = 0; s < sections.size(); s++) {
+        ObjectSection& section = sections[s];
+        header(names[s], section.type, section.flags, offset[s], section.size, 0, 0, 4, 0);
+        if (relocation_index[s]) {
+            header(relocation_names[s], SHT_REL, SHF_INFO_LINK, relocation_offset[s],
+                   RELOCATION_SIZE * section.relocations.size(), symtab_index, index[s], 4, RELOCATION_SIZE);
+        }
+    }
+    header(symtab_name, SHT_SYMTAB, 0, symtab_offset, symtab.size(), strtab_index, first_global, 4, SYMBOL_SIZE);
+    header(strtab_name, SHT_STRTAB, 0, strtab_offset, strtab.size(), 0, 0, 1, 0);
+    header(shstrtab_name, SHT_STRTAB, 0, shstrtab_offset, shstrtab.size(), 0, 0, 1, 0);
+
+    string elf;
+    elf += "\x7f" "ELF";
+    put8(elf, 1);                   // 32 bits
+    put8(elf, 1);                   // little-endian
+    put8(elf, 1);                   // versão
+    elf.append(9, '\0');
+    put16(elf, 1);                  // relocável
+    put16(elf, EM_ARM);
+    put32(elf, 1);
+    put32(elf, 0);                  // sem ponto de entrada
+    put32(elf, 0);                  // sem cabeçalhos de programa
+    put32(elf, headers_offset);
+    put32(elf, EF_ARM_EABI_VER5);
+    put16(elf, ELF_HEADER_SIZE);
+    put16(elf, 0);
+    put16(elf, 0);
+    put16(elf, SECTION_HEADER_SIZE);
+    put16(elf, count);
+    put16(elf, shstrtab_index);
+
+    out.replace(0, ELF_HEADER_SIZE, elf);
+    return out;
+}
@@ -0,0 +1,315 @@
+#include <iostream>
+#include <string>
+#include <vector>
+#include <cctype>
+
+#include "optimization.hpp"
+
+#include "Peephole.hpp"
+
+using namespace std;
+using namespace generation;
+
+// Registradores gerais, sem sp, lr e pc
+static bool is_register(const string& operand) {
+    if (operand.size() < 2 || operand.size() > 3 || operand[0] != 'r')
+        return false;
+    for (int i = 1; i < operand.size(); i++) {
+        if (!isdigit(operand[i]))
+            return false;
+    }
+    return stoi(operand.substr(1)) <= 12;
+}
+
+static bool is_immediate(const string& operand) {
+    return !operand.empty() && operand[0] == '#';
+}
+
+// Instruções que escrevem o primeiro operando sem outro efeito
+static bool writes_first(AsmLine& line) {
+    static const vector<string> opcodes = {
+        "MOV", "MVN", "ADD", "SUB", "RSB", "MUL", "AND", "ORR", "EOR", "BIC", "LDR"
+    };
+
+    if (line.kind != AsmLine::INSTRUCTION || line.operands.empty() || !is_register(line.operands[0]))
+        return false;
+    for (auto& op : opcodes) {
+        if (line.is(op))
+            return true;
+    }
+    return false;
+}
+
+// O operando menciona o registrador; listas com intervalo contam como sim
+static bool mentions(const string& operand, const string& reg) {
+    if (operand.find('{') != string::npos && operand.find('-') != string::npos)
+        return true;
+
+    string token;
+    for (int i = 0; i <= operand.size(); i++) {
+        if (i < operand.size() && isalnum(operand[i])) {
+            token += operand[i];
+            continue;
+        }
+        if (token == reg)
+            return true;
+        token.clear();
+    }
+    return false;
+}
+
+static bool reads(AsmLine& line, const string& reg) {
+    for (int i = writes_first(line) ? 1 : 0; i < line.operands.size(); i++) {
+        if (mentions(line.operands[i], reg))
+            return true;
+    }
+    return false;
+}
+
+// Desvio simples ou condicional; BL e BLHS são chamadas
+static bool is_branch(AsmLine& line, bool& conditional) {
+    if (line.kind != AsmLine::INSTRUCTION || line.opcode != "B" || line.operands.size() != 1)
+        return false;
+
+    conditional = !line.condition.empty() && line.condition != "AL";
+    return true;
+}
+
+const PeepholeRule Peephole::rules[] = {
+    { "cópia de um registrador nele mesmo",         &Peephole::redundant_move },
+    { "empilhamento desfeito em seguida",           &Peephole::push_pop },
+    { "lr desempilhado e empilhado antes de BL",    &Peephole::pop_push_link },
+    { "leitura do valor recém-escrito",             &Peephole::store_load },
+    { "leitura repetida da mesma posição",          &Peephole::repeated_load },
+    { "cópia usada só pela instrução seguinte",     &Peephole::fold_move },
+    { "escrita sobrescrita sem ser lida",           &Peephole::dead_move },
+    { "desvio para a linha seguinte",               &Peephole::branch_to_next },
+    { "código após desvio incondicional",           &Peephole::unreachable }
+};
+
+Peephole::Peephole(vector<AsmLine>& lines, optimization::Options& options):
+    lines(lines), options(options)
+{}
+
+void Peephole::run() {
+    if (options.report)
+        cout << "Otimização peephole:" << endl;
+
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (int i = 0; i < lines.size(); i++) {
+            if (lines[i].kind != AsmLine::INSTRUCTION)
+                continue;
+            for (auto& rule : rules) {
+                if ((this->*rule.apply)(i)) {
+                    applied[rule.name]++;
+                    changed = true;
+                    break;
+                }
+            }
+        }
+    }
+
+    if (options.report) {
+        for (auto& a : applied)
+            cout << "\t" << a.first << ": " << a.second << endl;
+    }
+}
+
+// Próxima instrução da janela, ou -1 se um rótulo ou diretiva a interrompe
+int Peephole::next(int i) {
+    for (int j = i + 1; j < lines.size(); j++) {
+        if (lines[j].kind == AsmLine::INSTRUCTION)
+            return j;
+        if (!lines[j].is_blank())
+            return -1;
+    }
+    return -1;
+}
+
+void Peephole::remove(int i) {
+    lines.erase(lines.begin() + i);
+}
+
+// MOV rX, rX
+bool Peephole::redundant_move(int i) {
+    AsmLine& line = lines[i];
+    if (!line.is("MOV") || line.operands.size() != 2 || line.operands[0] != line.operands[1])
+        return false;
+
+    remove(i);
+    return true;
+}
+
+// STMFD b!, {rX}; LDMFD b!, {rY} => MOV rY, rX
+bool Peephole::push_pop(int i) {
+    int j = next(i);
+    if (j < 0 || !lines[i].is("STMFD") || !lines[j].is("LDMFD"))
+        return false;
+
+    AsmLine& push = lines[i];
+    AsmLine& pop = lines[j];
+    if (push.operands.size() != 2 || pop.operands.size() != 2 || push.operands[0] != pop.operands[0])
+        return false;
+
+    string pushed = push.operands[1].substr(1, push.operands[1].size() - 2);
+    string popped = pop.operands[1].substr(1, pop.operands[1].size() - 2);
+    if (!is_register(pushed) || !is_register(popped))
+        return false;
+
+    lines[j] = AsmLine("MOV", { popped, pushed });
+    remove(i);
+    return true;
+}
+
+/*
+ * LDMFD r11!, {lr}; STMFD r11!, {lr}; BL f => BL f: o valor salvo
+ * continua na pilha, e o BL sobrescreve lr. No Thumb, lr volta por um
+ * registrador: POP {rX}; MOV lr, rX; PUSH {lr}; BL f => BL f.
+ */
+bool Peephole::pop_push_link(int i) {
+    int j = next(i);
+    int k = j < 0 ? -1 : next(j);
+    if (k >= 0 && lines[i].is("POP") && lines[j].is("MOV") && lines[k].is("PUSH")) {
+        int l = next(k);
+        if (l < 0 || !lines[l].is("BL") || lines[k].operands[0] != "{lr}" || lines[j].operands.size() != 2)
+            return false;
+        if (lines[j].operands[0] != "lr" || lines[i].operands[0] != "{" + lines[j].operands[1] + "}")
+            return false;
+
+        remove(k);
+        remove(j);
+        remove(i);
+        return true;
+    }
+
+    if (k < 0 || !lines[i].is("LDMFD") || !lines[j].is("STMFD") || !lines[k].is("BL"))
+        return false;
+    if (lines[i].operands != lines[j].operands || lines[i].operands.size() != 2 || lines[i].operands[1] != "{lr}")
+        return false;
+
+    remove(j);
+    remove(i);
+    return true;
+}
+
+// STR rX, [m]; LDR rY, [m] => STR rX, [m]; MOV rY, rX (MOVS no Thumb)
+bool Peephole::store_load(int i) {
+    int j = next(i);
+    if (j < 0 || !lines[i].is("STR") || !lines[j].is("LDR"))
+        return false;
+
+    AsmLine& store = lines[i];
+    AsmLine& load = lines[j];
+    if (store.operands.size() != 2 || load.operands.size() != 2 || store.operands[1] != load.operands[1])
+        return false;
+    if (!is_register(load.operands[0]))
+        return false;
+
+    if (load.operands[0] == store.operands[0])
+        remove(j);
+    else
+        lines[j] = AsmLine(options.thumb ? "MOVS" : "MOV", { load.operands[0], store.operands[0] });
+    return true;
+}
+
+// LDR rX, [m]; LDR rY, [m] => LDR rX, [m]; MOV rY, rX, se m não usa rX
+bool Peephole::repeated_load(int i) {
+    int j = next(i);
+    if (j < 0 || !lines[i].is("LDR") || !lines[j].is("LDR"))
+        return false;
+
+    AsmLine& first = lines[i];
+    AsmLine& second = lines[j];
+    if (first.operands.size() != 2 || second.operands.size() != 2 || first.operands[1] != second.operands[1])
+        return false;
+    if (first.operands[1][0] != '[' || mentions(first.operands[1], first.operands[0]) || !is_register(second.operands[0]))
+        return false;
+
+    if (second.operands[0] == first.operands[0])
+        remove(j);
+    else
+        lines[j] = AsmLine(options.thumb ? "MOVS" : "MOV", { second.operands[0], first.operands[0] });
+    return true;
+}
+
+/*
+ * MOV rX, rY; OP rX, a, b => OP rX, a', b', com rY no lugar de rX: a
+ * instrução sobrescreve rX, então a cópia só servia a ela
+ */
+bool Peephole::fold_move(int i) {
+    static const vector<string> opcodes = { "ADD", "SUB", "RSB", "MUL", "AND", "ORR", "EOR", "BIC" };
+
+    int j = next(i);
+    if (j < 0 || !lines[i].is("MOV"))
+        return false;
+
+    AsmLine& move = lines[i];
+    AsmLine& op = lines[j];
+    if (move.operands.size() != 2 || !is_register(move.operands[0]) || !is_register(move.operands[1]))
+        return false;
+
+    bool known = false;
+    for (auto& o : opcodes)
+        known |= op.is(o);
+    if (!known || op.operands.size() != 3 || op.operands[0] != move.operands[0] || !reads(op, move.operands[0]))
+        return false;
+    for (int k = 1; k < 3; k++) {
+        if (!is_register(op.operands[k]) && !is_immediate(op.operands[k]))
+            return false;
+    }
+
+    for (int k = 1; k < 3; k++) {
+        if (op.operands[k] == move.operands[0])
+            op.operands[k] = move.operands[1];
+    }
+    op.modified = true;
+    remove(i);
+    return true;
+}
+
+// OP rX, ...; OP' rX, ... sem ler rX => OP' rX, ...
+bool Peephole::dead_move(int i) {
+    int j = next(i);
+    if (j < 0 || !writes_first(lines[i]) || !writes_first(lines[j]))
+        return false;
+    if (lines[i].operands[0] != lines[j].operands[0] || reads(lines[j], lines[j].operands[0]))
+        return false;
+
+    remove(i);
+    return true;
+}
+
+// B L ou Bcc L seguido do rótulo L
+bool Peephole::branch_to_next(int i) {
+    bool conditional;
+    if (!is_branch(lines[i], conditional))
+        return false;
+
+    for (int j = i + 1; j < lines.size(); j++) {
+        if (lines[j].kind == AsmLine::LABEL && lines[j].label == lines[i].operands[0]) {
+            remove(i);
+            return true;
+        }
+        if (lines[j].kind != AsmLine::LABEL && !lines[j].is_blank())
+            return false;
+    }
+    return false;
+}
+
+// Instruções entre um desvio incondicional e o próximo rótulo
+bool Peephole::unreachable(int i) {
+    bool conditional = true;
+    bool jump = is_branch(lines[i], conditional) && !conditional;
+    bool ret = lines[i].is("MOV") && lines[i].operands.size() == 2 && lines[i].operands[0] == "pc";
+    if (!jump && !ret)
+        return false;
+
+    int j = next(i);
+    if (j < 0)
+        return false;
+
+    remove(j);
+    return true;
+}
@@ -0,0 +1,225 @@
+#include <vector>
+#include <set>
+#include <algorithm>
+
+#include "IR.hpp"
+
+#include "RegisterAllocator.hpp"
+
+using namespace std;
+using namespace generation;
+using namespace optimization;
+
+RegisterAllocator::RegisterAllocator(IRFunction* function, bool thumb):
+    function(function),
+    first_saved(thumb ? THUMB_FIRST_SAVED_REGISTER : FIRST_SAVED_REGISTER),
+    last(thumb ? THUMB_LAST_REGISTER : LAST_REGISTER)
+{}
+
+void RegisterAllocator::run() {
+    number();
+    compute_liveness();
+    build_intervals();
+    scan();
+}
+
+// Registrador do valor; -1 para constantes e valores na memória
+int RegisterAllocator::reg(IRValue* value) {
+    auto it = index.find(value);
+    return it == index.end() ? -1 : intervals[it->second].reg;
+}
+
+// Registradores preservados usados, que a função guarda na entrada
+vector<int> RegisterAllocator::saved_registers() {
+    set<int> used;
+    for (auto& interval : intervals) {
+        if (interval.reg >= first_saved)
+            used.insert(interval.reg);
+    }
+    return vector<int>(used.begin(), used.end());
+}
+
+/*
+ * Instruções que chamam sdiv, pow ou uma função de usuário; a divisão
+ * por constante não nula e a potência de expoente constante pequeno são
+ * feitas no próprio código, só com r0-r2
+ */
+bool RegisterAllocator::calls(IRInstruction* instruction) {
+    switch (instruction->op) {
+        case IRInstruction::DIV: {
+            IRValue* divisor = instruction->operands[1];
+            return !divisor->is_constant() || divisor->id == 0;
+        }
+        case IRInstruction::POW: {
+            IRValue* exponent = instruction->operands[1];
+            return !exponent->is_constant() || exponent->id > MAX_INLINE_EXPONENT;
+        }
+        case IRInstruction::CALL:
+            return true;
+        default:
+            return false;
+    }
+}
+
+/*
+ * Posições na ordem de emissão; o início e o fim de cada bloco têm
+ * posições próprias, para que um valor vivo na entrada ou na saída do
+ * bloco atravesse as chamadas feitas nele
+ */
+void RegisterAllocator::number() {
+    int position = 0;
+    for (auto block : function->blocks) {
+        starts[block] = position++;
+        for (auto instruction : block->instructions) {
+            positions[instruction] = position;
+            if (calls(instruction))
+                call_positions.push_back(position);
+            position++;
+        }
+        ends[block] = position++;
+    }
+}
+
+void RegisterAllocator::compute_liveness() {
+    map<IRBlock*, set<IRValue*>> uses, defs;
+
+    for (auto block : function->blocks) {
+        for (auto instruction : block->instructions) {
+            for (auto value : instruction->operands) {
+                if (!value->is_constant() && !defs[block].count(value))
+                    uses[block].insert(value);
+            }
+            if (instruction->result)
+                defs[block].insert(instruction->result);
+        }
+    }
+
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (auto it = function->blocks.rbegin(); it != function->blocks.rend(); it++) {
+            IRBlock* block = *it;
+
+            set<IRValue*> out;
+            for (auto succ : block->successors)
+                out.insert(live_in[succ].begin(), live_in[succ].end());
+
+            set<IRValue*> in = uses[block];
+            for (auto value : out) {
+                if (!defs[block].count(value))
+                    in.insert(value);
+            }
+
+            if (in != live_in[block] || out != live_out[block]) {
+                live_in[block] = in;
+                live_out[block] = out;
+                changed = true;
+            }
+        }
+    }
+}
+
+LiveInterval& RegisterAllocator::interval(IRValue* value, int position) {
+    auto it = index.find(value);
+    if (it != index.end())
+        return intervals[it->second];
+
+    index[value] = intervals.size();
+    intervals.push_back(LiveInterval(value, position));
+    return intervals.back();
+}
+
+void RegisterAllocator::extend(IRValue* value, int position) {
+    LiveInterval& live = interval(value, position);
+    live.start = min(live.start, position);
+    live.end = max(live.end, position);
+}
+
+/*
+ * Um intervalo por valor, da primeira à última posição em que está vivo;
+ * fora da SSA, as cópias de saída definem o mesmo valor em vários blocos
+ */
+void RegisterAllocator::build_intervals() {
+    for (auto block : function->blocks) {
+        for (auto value : live_in[block])
+            extend(value, starts[block]);
+
+        for (auto instruction : block->instructions) {
+            for (auto value : instruction->operands) {
+                if (!value->is_constant())
+                    extend(value, positions[instruction]);
+            }
+            if (instruction->result)
+                extend(instruction->result, positions[instruction]);
+        }
+
+        for (auto value : live_out[block])
+            extend(value, ends[block]);
+    }
+
+    for (auto& live : intervals) {
+        for (auto position : call_positions) {
+            if (live.start < position && position < live.end)
+                live.crosses_call = true;
+        }
+    }
+}
+
+/*
+ * Varredura pela ordem de início: intervalos terminados liberam o
+ * registrador, e um intervalo que termina onde outro começa pode
+ * cedê-lo, pois a instrução lê os operandos antes de escrever o
+ * resultado
+ */
+void RegisterAllocator::scan() {
+    vector<int> order(intervals.size());
+    for (int i = 0; i < order.size(); i++)
+        order[i] = i;
+    stable_sort(order.begin(), order.end(), [this](int a, int b) {
+        return intervals[a].start < intervals[b].start;
+    });
+
+    bool available[LAST_REGISTER + 1];
+    for (int r = 0; r <= LAST_REGISTER; r++)
+        available[r] = r >= FIRST_REGISTER && r <= last;
+
+    vector<int> active;
+    for (auto i : order) {
+        LiveInterval& current = intervals[i];
+
+        for (auto it = active.begin(); it != active.end();) {
+            if (intervals[*it].end <= current.start) {
+                available[intervals[*it].reg] = true;
+                it = active.erase(it);
+            }
+            else {
+                it++;
+            }
+        }
+
+        int lowest = current.crosses_call ? first_saved : FIRST_REGISTER;
+        for (int r = lowest; r <= last && current.reg < 0; r++) {
+            if (available[r]) {
+                available[r] = false;
+                current.reg = r;
+            }
+        }
+        if (current.reg >= 0) {
+            active.push_back(i);
+            continue;
+        }
+
+        // Sem registrador livre: fica na memória o de fim mais distante
+        auto victim = active.end();
+        for (auto it = active.begin(); it != active.end(); it++) {
+            if (intervals[*it].reg >= lowest && (victim == active.end() || intervals[*it].end > intervals[*victim].end))
+                victim = it;
+        }
+        if (victim != active.end() && intervals[*victim].end > current.end) {
+            current.reg = intervals[*victim].reg;
+            intervals[*victim].reg = -1;
+            active.erase(victim);
+            active.push_back(i);
+        }
+    }
+}
@@ -9,6 +9,8 @@ string ascii2name(lexic::ascii_type t);
 void ascii_test(ifstream& file);
 void lex_test(ifstream& file);
 void stx_test(ifstream& file);
+void cfg_test(ifstream& file);
+void peephole_test(ifstream& file);
 
 void print_var(syntax::Var* var);
 void print_num(syntax::Num* num);
@@ -11,6 +11,9 @@
 #include "LexicalAnalyser.hpp"
 #include "SyntaxAnalyser.hpp"
 #include "SemanticAnalyser.hpp"
+#include "ControlFlowGraph.hpp"
+#include "Optimizer.hpp"
+#include "IRBuilder.hpp"
 #include "CodeGenerator.hpp"
 
 using namespace std;
@@ -20,7 +23,7 @@ int main(int argc, char* argv[]) {
     std::cout << "Bem-Vindo ao Compilador BasicC!" << std::endl;
 
     if (argc < 2) {
-        cerr << "Uso esperado: basicc <entrada.bas> [ <saída.s> ]" << endl;
+        cerr << "Uso esperado: basicc <entrada.bas> [ <saída.s | saída.o> ] [ opções ]" << endl;
         return 1;
     }
 
@@ -43,16 +46,73 @@ int main(int argc, char* argv[]) {
         else if (argc > 2 && 0 == strcmp(argv[2], "-S")) {
             stx_test(input);
         }
+        else if (argc > 2 && 0 == strcmp(argv[2], "-C")) {
+            cfg_test(input);
+        }
+        else if (argc > 2 && 0 == strcmp(argv[2], "-P")) {
+            peephole_test(input);
+        }
         else {
-            if (argc > 2)
-                output_file = argv[2];
+            optimization::Options options;
+
+            for (int i = 2; i < argc; i++) {
+                if (0 == strcmp(argv[i], "-O0"))
+                    options.optimize = false;
+                else if (0 == strcmp(argv[i], "--report"))
+                    options.report = true;
+                else if (0 == strcmp(argv[i], "--bounds-check"))
+                    options.bounds_check = true;
+                else if (0 == strcmp(argv[i], "--dump-ir"))
+                    options.dump_ir = true;
+                else if (0 == strcmp(argv[i], "--partial-eval"))
+                    options.partial_eval = true;
+                else if (0 == strncmp(argv[i], "--partial-eval=", 15)) {
+                    options.partial_eval = true;
+                    options.eval_steps = atoi(argv[i] + 15);
+                }
+                else if (0 == strcmp(argv[i], "--emit-obj"))
+                    options.emit_obj = true;
+                else if (0 == strcmp(argv[i], "-mthumb"))
+                    options.thumb = true;
+                else if (argv[i][0] != '-')
+                    output_file = argv[i];
+                else {
+                    cerr << "\033[1;31mErro: \033[0m" << "Opção desconhecida '" << argv[i] << "'" << endl;
+                    exit(EXIT_FAILURE);
+                }
+            }
+
+            // O ObjectWriter só codifica instruções ARM
+            if (options.emit_obj && options.thumb) {
+                cerr << "\033[1;31mErro: \033[0m" << "--emit-obj não está disponível com -mthumb" << endl;
+                exit(EXIT_FAILURE);
+            }
+
+            if (options.emit_obj && output_file == "out.s")
+                output_file = "out.o";
 
             semantic::SymbolTable symb_table;
+            semantic::Program program;
 
-            generation::CodeGenerator gen(input_file, output_file, symb_table);
-            semantic::SemanticAnalyser smt(input, symb_table, gen);
+            generation::CodeGenerator gen(input_file, output_file, symb_table, options);
+            semantic::SemanticAnalyser smt(input, symb_table, program);
 
             smt.run();
+
+            if (!smt.has_error()) {
+                optimization::Optimizer opt(program, symb_table, options);
+                opt.run();
+
+                optimization::IR ir;
+                optimization::IRBuilder builder(program, symb_table, options, ir);
+                builder.run();
+                opt.run(ir);
+
+                if (options.dump_ir)
+                    ir.print(cout);
+
+                gen.generate(ir);
+            }
         }
     }
     catch (lexic::lexical_exception& e) {
@@ -10,7 +10,9 @@
 #include "LexicalAnalyser.hpp"
 #include "SyntaxAnalyser.hpp"
 #include "SemanticAnalyser.hpp"
+#include "ControlFlowGraph.hpp"
 #include "CodeGenerator.hpp"
+#include "Peephole.hpp"
 
 #include "test.hpp"
 
@@ -275,6 +277,41 @@ void stx_test(ifstream& file) {
     }
 }
 
+void cfg_test(ifstream& file) {
+    semantic::SymbolTable symb_table;
+    semantic::Program program;
+
+    semantic::SemanticAnalyser smt(file, symb_table, program);
+    smt.run();
+
+    if (smt.has_error())
+        return;
+
+    optimization::ControlFlowGraph cfg(program);
+    cfg.print();
+}
+
+// Lê um trecho de assembly e mostra o resultado da otimização peephole
+void peephole_test(ifstream& file) {
+    vector<generation::AsmLine> lines;
+    string line;
+    while (getline(file, line))
+        lines.push_back(generation::AsmLine(line));
+
+    cout << "Antes:" << endl;
+    for (auto& l : lines)
+        cout << l.text() << endl;
+
+    optimization::Options options;
+    options.report = true;
+    generation::Peephole peephole(lines, options);
+    peephole.run();
+
+    cout << "Depois:" << endl;
+    for (auto& l : lines)
+        cout << l.text() << endl;
+}
+
 string ascii2name(lexic::ascii_type t) {
     switch (t) {
         case lexic::ascii_type::UNKNOWN:   return "UNKNOWN";
@@ -0,0 +1,55 @@
+#ifndef CONSTANT_FOLDER_HPP
+#define CONSTANT_FOLDER_HPP
+
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+#include <unordered_map>
+
+#include "syntax.hpp"
+#include "semantic.hpp"
+#include "optimization.hpp"
+#include "ControlFlowGraph.hpp"
+
+namespace optimization {
+
+// Variáveis simples de valor conhecido, pelo identificador
+typedef std::map<std::string, int> Constants;
+
+/*
+ * Avalia em compilação as subexpressões constantes e substitui as
+ * variáveis cujo valor é conhecido em todos os caminhos que chegam
+ * ao comando (propagação de constantes sobre o grafo de fluxo).
+ */
+class ConstantFolder {
+    public:
+        ConstantFolder(semantic::Program& program, semantic::SymbolTable& symb_table, Options& options);
+
+        void run();
+
+        // Resultado de left <op> right com a semântica das rotinas sdiv e pow;
+        // falso se a operação não tem resultado definido
+        static bool evaluate(syntax::Elem::type op, int left, int right, int& result);
+
+    private:
+        void propagate(ControlFlowGraph& cfg);
+        void transfer(semantic::Command* command, Constants& known);
+        bool evaluate(const std::vector<syntax::Elem*>& exp, const Constants& known, int& result);
+
+        bool fold(std::vector<syntax::Elem*>& exp, const Constants& known);
+        void fold(semantic::Command* command, const std::string& what, std::vector<syntax::Elem*>& exp, const Constants& known);
+
+        void report(const std::string& message);
+
+        semantic::Program& program;
+        semantic::SymbolTable& symb_table;
+        Options& options;
+
+        std::unordered_map<semantic::Command*, Constants> in;
+        std::set<semantic::Command*> reached;
+};
+
+} // namespace optimization
+
+#endif // CONSTANT_FOLDER_HPP
@@ -0,0 +1,59 @@
+#ifndef CONTROL_FLOW_GRAPH_HPP
+#define CONTROL_FLOW_GRAPH_HPP
+
+#include <vector>
+#include <unordered_map>
+
+#include "semantic.hpp"
+#include "optimization.hpp"
+
+namespace optimization {
+
+class ControlFlowGraph {
+    public:
+        ControlFlowGraph(semantic::Program& program);
+        ~ControlFlowGraph();
+
+        const std::vector<BasicBlock*>& get_blocks();
+        BasicBlock* get_entry();
+        BasicBlock* block_of(semantic::Command* command);
+
+        // Blocos alcançáveis em pós-ordem reversa
+        const std::vector<BasicBlock*>& reverse_postorder();
+
+        std::vector<semantic::Command*> successors(semantic::Command* command);
+        std::vector<semantic::Command*> predecessors(semantic::Command* command);
+
+        bool dominates(BasicBlock* a, BasicBlock* b);
+
+        // Laços naturais, dos mais internos para os mais externos
+        const std::vector<Loop*>& get_loops();
+        Loop* innermost_loop(BasicBlock* block);
+        // Comando de onde parte a única aresta que entra no laço, se for
+        // seu único sucessor; nullptr se o laço não admite pré-cabeçalho
+        semantic::Command* preheader_edge(Loop* loop);
+        bool is_reducible();
+
+        void print();
+
+    private:
+        void find_return_sites();
+        void build_blocks();
+        void compute_order();
+        void compute_dominators();
+        void find_loops();
+
+        semantic::Program& program;
+
+        std::vector<BasicBlock*> blocks;
+        std::vector<BasicBlock*> rpo;
+        std::vector<Loop*> loops;
+        std::vector<semantic::Command*> return_sites;
+        std::unordered_map<semantic::Command*, BasicBlock*> command_block;
+        std::unordered_map<semantic::Command*, std::vector<semantic::Command*>> command_preds;
+        bool reducible = true;
+};
+
+} // namespace optimization
+
+#endif // CONTROL_FLOW_GRAPH_HPP
@@ -0,0 +1,35 @@
+#ifndef COPY_PROPAGATOR_HPP
+#define COPY_PROPAGATOR_HPP
+
+#include <string>
+
+#include "optimization.hpp"
+#include "IR.hpp"
+
+namespace optimization {
+
+/*
+ * Propagação de cópias na representação intermediária: em SSA, o
+ * destino de uma cópia tem o mesmo valor da origem em todo o programa,
+ * então seus usos passam a ler a origem e a cópia é removida. Atribuições
+ * como LET A = B ou LET A = 0 deixam de mover valores entre posições de
+ * memória.
+ */
+class CopyPropagator {
+    public:
+        CopyPropagator(IR& ir, Options& options);
+
+        void run();
+
+    private:
+        void propagate(IRFunction* function);
+
+        void report(const std::string& message);
+
+        IR& ir;
+        Options& options;
+};
+
+} // namespace optimization
+
+#endif // COPY_PROPAGATOR_HPP
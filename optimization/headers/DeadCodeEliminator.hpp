@@ -0,0 +1,34 @@
+#ifndef DEAD_CODE_ELIMINATOR_HPP
+#define DEAD_CODE_ELIMINATOR_HPP
+
+#include <string>
+#include <vector>
+
+#include "semantic.hpp"
+#include "optimization.hpp"
+#include "Liveness.hpp"
+
+namespace optimization {
+
+class DeadCodeEliminator {
+    public:
+        DeadCodeEliminator(semantic::Program& program, semantic::SymbolTable& symb_table, Options& options);
+
+        void run();
+
+    private:
+        bool remove_unreachable_commands();
+        bool remove_dead_assignments();
+        void remove_unused_functions();
+        void remove_unused_variables();
+
+        void report(const std::string& message);
+
+        semantic::Program& program;
+        semantic::SymbolTable& symb_table;
+        Options& options;
+};
+
+} // namespace optimization
+
+#endif // DEAD_CODE_ELIMINATOR_HPP
@@ -0,0 +1,56 @@
+#ifndef DEAD_STORE_ELIMINATOR_HPP
+#define DEAD_STORE_ELIMINATOR_HPP
+
+#include <map>
+#include <set>
+#include <string>
+
+#include "syntax.hpp"
+#include "optimization.hpp"
+#include "IR.hpp"
+
+namespace optimization {
+
+// Variáveis simples cuja posição na memória ainda será lida
+typedef std::set<syntax::Var*> MemorySet;
+
+/*
+ * Eliminação de escritas mortas na representação intermediária. Uma
+ * escrita (PUT) de variável é morta se, em todos os caminhos, a memória
+ * da variável é sobrescrita antes de ser lida; são leituras os GET das
+ * sub-rotinas e retornos, as funções que leem variáveis globais e o fim
+ * do programa, normal ou por índice fora do vetor, que lê o estado
+ * final. Em seguida, instruções cujo valor
+ * ninguém usa e que não têm efeito são removidas.
+ */
+class DeadStoreEliminator {
+    public:
+        DeadStoreEliminator(IR& ir, Options& options);
+
+        void run();
+
+    private:
+        void compute_liveness(IRFunction* function);
+        void transfer(IRInstruction* instruction, MemorySet& live);
+        void remove_dead_puts(IRFunction* function);
+        void remove_redundant_puts(IRFunction* function);
+        void remove_dead_values(IRFunction* function);
+
+        bool has_side_effects(IRInstruction* instruction);
+        const MemorySet& function_reads(const std::string& name);
+        IRFunction* function_named(const std::string& name);
+
+        void report(const std::string& message);
+
+        IR& ir;
+        Options& options;
+
+        MemorySet variables;
+        std::map<IRBlock*, MemorySet> live_out;
+        std::map<std::string, MemorySet> reads;
+        std::map<std::string, bool> effects;
+};
+
+} // namespace optimization
+
+#endif // DEAD_STORE_ELIMINATOR_HPP
@@ -0,0 +1,177 @@
+#ifndef IR_HPP
+#define IR_HPP
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <map>
+
+#include "syntax.hpp"
+
+namespace optimization {
+
+class IRInstruction;
+class IRBlock;
+
+/*
+ * Valor da representação intermediária, sempre um inteiro de 32 bits:
+ * constante, versão de uma variável simples do programa ou temporário
+ * de uma expressão. Em SSA, cada valor tem uma única definição.
+ */
+class IRValue {
+    public:
+        enum kind {
+            CONSTANT,
+            VARIABLE,
+            TEMPORARY
+        };
+
+        IRValue(IRValue::kind kind, int id):
+            kind(kind), id(id)
+        {}
+
+        bool is_constant() {
+            return kind == CONSTANT;
+        }
+
+        std::string name();
+
+        IRValue::kind kind;
+        int id;                             // Número do valor; valor da constante
+        syntax::Var* variable = nullptr;    // Variável de que o valor é uma versão
+        int version = 0;
+};
+
+/*
+ * Instrução de três endereços. Variáveis simples são valores SSA e só
+ * passam pela memória em GET e PUT; vetores ficam sempre na memória.
+ */
+class IRInstruction {
+    public:
+        enum opcode {
+            ADD,        // result = operands[0] <op> operands[1]
+            SUB,
+            MUL,
+            DIV,
+            POW,
+            COPY,       // result = operands[0]
+            PHI,        // result = operands[i] vindo de blocks[i]
+            GET,        // result = variable na memória
+            PUT,        // variable na memória = operands[0]
+            LOAD,       // result = variable[operands[0]]
+            STORE,      // variable[operands[0]] = operands[1]
+            READ,       // result = posição data da tabela de DATA
+            CALL,       // result = function(operands...)
+            PRINT,      // Sem código: operands são os itens impressos
+            JUMP,       // Desvia para blocks[0]
+            BRANCH,     // Desvia para blocks[0] se operands[0] <condition> operands[1], senão para blocks[1]
+            GOSUB,      // Chama a sub-rotina blocks[0] e retorna para blocks[1]
+            RETURN,     // Retorno de sub-rotina
+            HALT,       // Fim do programa
+            RET         // Retorno de função com o valor operands[0]
+        };
+
+        IRInstruction(IRInstruction::opcode op):
+            op(op)
+        {}
+
+        bool is_terminator() {
+            return op >= JUMP;
+        }
+
+        void print(std::ostream& out);
+
+        IRInstruction::opcode op;
+        IRValue* result = nullptr;
+        std::vector<IRValue*> operands;
+        std::vector<IRBlock*> blocks;
+
+        syntax::Var* variable = nullptr;                // GET, PUT, LOAD e STORE
+        syntax::If::cmp condition = syntax::If::EQL;    // BRANCH
+        std::string function;                           // CALL
+        std::string label;                              // HALT: rótulo do END
+        int data = 0;                                   // READ
+        bool checked = false;                           // LOAD e STORE: verifica os limites do vetor
+};
+
+class IRBlock {
+    public:
+        IRBlock(std::string label):
+            label(label)
+        {}
+
+        ~IRBlock() {
+            for (auto instruction : instructions)
+                delete instruction;
+        }
+
+        IRInstruction* terminator() {
+            return instructions.empty() ? nullptr : instructions.back();
+        }
+
+        std::string label;
+        std::vector<IRInstruction*> instructions;
+        std::vector<IRBlock*> predecessors;
+        std::vector<IRBlock*> successors;
+
+        // Entrada de sub-rotina, retorno de GOSUB ou corpo de função: as
+        // variáveis simples são lidas da memória, e não de outros blocos
+        bool memory = false;
+};
+
+class IRFunction {
+    public:
+        IRFunction(std::string name):
+            name(name)
+        {}
+
+        ~IRFunction() {
+            for (auto block : blocks)
+                delete block;
+        }
+
+        std::string name;
+        std::vector<syntax::Var*> parameters;
+        std::vector<IRBlock*> blocks;           // blocks[0] é a entrada
+};
+
+/*
+ * Representação intermediária do programa: o fluxo principal, as
+ * funções DEF FN e a tabela de DATA. Construída em SSA pelo IRBuilder;
+ * leave_ssa troca as funções phi por cópias antes da geração de código.
+ */
+class IR {
+    public:
+        IR()
+        {}
+
+        ~IR();
+
+        IRValue* constant(int value);
+        IRValue* temporary();
+        IRValue* version(syntax::Var* var);
+
+        void replace_uses(IRFunction* function, IRValue* from, IRValue* to);
+        void remove_trivial_phis(IRFunction* function);
+
+        void leave_ssa();
+        void print(std::ostream& out);
+
+        IRFunction* main = nullptr;
+        std::vector<IRFunction*> functions;
+        std::vector<int> data;
+
+    private:
+        void split_critical_edges(IRFunction* function);
+        void eliminate_phis(IRFunction* function);
+        void sequentialize(std::vector<std::pair<IRValue*, IRValue*>>& copies, std::vector<IRInstruction*>& sequence);
+
+        std::map<int, IRValue*> constants;
+        std::map<std::string, int> versions;
+        std::vector<IRValue*> values;
+        int temporaries = 0;
+};
+
+} // namespace optimization
+
+#endif // IR_HPP
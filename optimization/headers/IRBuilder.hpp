@@ -0,0 +1,85 @@
+#ifndef IR_BUILDER_HPP
+#define IR_BUILDER_HPP
+
+#include <map>
+#include <set>
+#include <vector>
+#include <unordered_map>
+
+#include "syntax.hpp"
+#include "semantic.hpp"
+#include "optimization.hpp"
+#include "ControlFlowGraph.hpp"
+#include "IR.hpp"
+
+namespace optimization {
+
+// Nó da árvore de uma expressão pós-fixa
+class ExpressionNode {
+    public:
+        ExpressionNode(syntax::Elem* elem):
+            elem(elem)
+        {}
+
+        syntax::Elem* elem;
+        std::vector<int> children;
+        int need = 0;           // Registradores para calcular o nó (Sethi-Ullman)
+        bool calls = false;     // Contém chamada de função
+};
+
+/*
+ * Traduz o programa para a representação intermediária em SSA,
+ * construída diretamente durante a tradução pelo algoritmo de Braun et
+ * al. ("Simple and Efficient Construction of Static Single Assignment
+ * Form"). Cada definição de variável simples é também escrita na memória
+ * (PUT), onde a leem as sub-rotinas, os retornos de GOSUB e as funções.
+ */
+class IRBuilder {
+    public:
+        IRBuilder(semantic::Program& program, semantic::SymbolTable& symb_table, Options& options, IR& ir);
+
+        void run();
+
+    private:
+        void build_main();
+        void build_function(semantic::Command* def);
+        void translate(semantic::Command* command, bool last);
+
+        IRValue* expression(const std::vector<syntax::Elem*>& exp);
+        IRValue* expression(std::vector<ExpressionNode>& nodes, int node);
+        IRInstruction* emit(IRInstruction::opcode op, IRValue* result = nullptr);
+        void jump(IRBlock* destination);
+        void define(syntax::Var* var, IRValue* value);
+
+        IRValue* read_variable(syntax::Var* var, IRBlock* block);
+        IRValue* read_variable_recursive(syntax::Var* var, IRBlock* block);
+        void add_phi_operands(syntax::Var* var, IRInstruction* phi, IRBlock* block);
+        void seal(IRBlock* block);
+
+        IRBlock* block_of(semantic::Command* command);
+        syntax::Var* declaration(syntax::Var* var);
+
+        semantic::Program& program;
+        semantic::SymbolTable& symb_table;
+        Options& options;
+        IR& ir;
+
+        ControlFlowGraph* cfg = nullptr;
+        IRFunction* function = nullptr;
+        IRBlock* current = nullptr;
+
+        // Bloco de cada comando alcançável do programa principal
+        std::unordered_map<semantic::Command*, IRBlock*> blocks;
+        std::unordered_map<semantic::Command*, int> data_position;
+        std::vector<syntax::Var*> written;
+
+        // Versão atual de cada variável no fim de cada bloco já traduzido
+        std::map<IRBlock*, std::map<syntax::Var*, IRValue*>> current_def;
+        std::map<IRBlock*, std::map<syntax::Var*, IRInstruction*>> incomplete_phis;
+        std::set<IRBlock*> sealed;
+        std::set<IRBlock*> filled;
+};
+
+} // namespace optimization
+
+#endif // IR_BUILDER_HPP
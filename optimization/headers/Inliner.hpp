@@ -0,0 +1,50 @@
+#ifndef INLINER_HPP
+#define INLINER_HPP
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "syntax.hpp"
+#include "semantic.hpp"
+#include "optimization.hpp"
+
+// Maior corpo expandido, em elementos pós-fixos, que substitui uma chamada
+#define INLINE_LIMIT 32
+// Rodadas de expansão de chamadas que aparecem nos corpos expandidos
+#define INLINE_ROUNDS 4
+
+namespace optimization {
+
+/*
+ * Expansão de funções DEF FN nos pontos de chamada: o corpo da função
+ * substitui a chamada, com cada parâmetro trocado pela expressão do
+ * argumento. Um argumento composto usado mais de uma vez no corpo é
+ * calculado antes do comando, em um temporário. A expansão ocorre se o
+ * corpo expandido for pequeno ou se a chamada for a única da função.
+ */
+class Inliner {
+    public:
+        Inliner(semantic::Program& program, semantic::SymbolTable& symb_table, Options& options);
+
+        void run();
+
+    private:
+        bool expand(std::vector<syntax::Elem*>& exp, semantic::Command* command, const std::string& owner);
+        bool substitute(semantic::Command* def, std::vector<std::vector<syntax::Elem*>>& args,
+                        semantic::Command* command, std::vector<syntax::Elem*>& body);
+
+        void report(const std::string& message);
+
+        semantic::Program& program;
+        semantic::SymbolTable& symb_table;
+        Options& options;
+
+        std::map<std::string, semantic::Command*> functions;
+        std::map<std::string, int> calls;
+        std::vector<semantic::Command*> inserted;
+};
+
+} // namespace optimization
+
+#endif // INLINER_HPP
@@ -0,0 +1,36 @@
+#ifndef JUMP_THREADER_HPP
+#define JUMP_THREADER_HPP
+
+#include <string>
+
+#include "semantic.hpp"
+#include "optimization.hpp"
+
+namespace optimization {
+
+/*
+ * Encadeamento de desvios: sequências e desvios que levam a um GOTO
+ * passam a apontar direto para o destino final da cadeia, e um IF com
+ * os dois destinos iguais vira GOTO. Os GOTOs que deixam de ser
+ * alcançados são removidos pela eliminação de código morto.
+ */
+class JumpThreader {
+    public:
+        JumpThreader(semantic::Program& program, semantic::SymbolTable& symb_table, Options& options);
+
+        void run();
+
+    private:
+        semantic::Command* destination(semantic::Command* command);
+        void thread(semantic::Command* command, semantic::Command*& successor, const std::string& what);
+
+        void report(const std::string& message);
+
+        semantic::Program& program;
+        semantic::SymbolTable& symb_table;
+        Options& options;
+};
+
+} // namespace optimization
+
+#endif // JUMP_THREADER_HPP
@@ -0,0 +1,54 @@
+#ifndef LIVENESS_HPP
+#define LIVENESS_HPP
+
+#include <set>
+#include <string>
+#include <vector>
+#include <unordered_map>
+
+#include "syntax.hpp"
+#include "semantic.hpp"
+#include "ControlFlowGraph.hpp"
+
+namespace optimization {
+
+// Conjunto de variáveis, identificadas pela declaração na tabela de símbolos
+typedef std::set<syntax::Var*> VarSet;
+
+class Liveness {
+    public:
+        Liveness(semantic::Program& program, ControlFlowGraph& cfg, semantic::SymbolTable& symb_table);
+
+        const VarSet& live_in(semantic::Command* command);
+        const VarSet& live_out(semantic::Command* command);
+
+        // Variáveis lidas pelo comando, incluindo as lidas por funções chamadas
+        // e, no END, as de program.observed
+        VarSet uses(semantic::Command* command);
+        // Variáveis lidas por algum comando do programa
+        VarSet reads();
+        // Variáveis simples sobrescritas pelo comando
+        VarSet kills(semantic::Command* command);
+        // Variáveis (simples ou indexadas) escritas pelo comando
+        VarSet writes(semantic::Command* command);
+
+        void expression_uses(const std::vector<syntax::Elem*>& exp, VarSet& uses);
+        syntax::Var* declaration(syntax::Var* v);
+
+    private:
+        void compute();
+        const VarSet& function_uses(const std::string& identifier);
+
+        semantic::Program& program;
+        ControlFlowGraph& cfg;
+        semantic::SymbolTable& symb_table;
+
+        std::unordered_map<semantic::Command*, VarSet> in, out;
+        std::unordered_map<std::string, VarSet> functions;
+        std::unordered_map<syntax::Var*, syntax::Var*> declarations;
+        std::set<std::string> visiting;
+};
+
+} // namespace optimization
+
+#endif // LIVENESS_HPP
@@ -0,0 +1,44 @@
+#ifndef LOOP_INVARIANT_MOTION_HPP
+#define LOOP_INVARIANT_MOTION_HPP
+
+#include <set>
+#include <string>
+#include <vector>
+
+#include "syntax.hpp"
+#include "semantic.hpp"
+#include "optimization.hpp"
+#include "ControlFlowGraph.hpp"
+
+namespace optimization {
+
+/*
+ * Move para o pré-cabeçalho de cada laço as subexpressões cujo valor
+ * não muda durante o laço: limite e passo de FOR e cálculos do corpo
+ * que não dependem de variáveis escritas no laço. O pré-cabeçalho fica
+ * na única aresta que entra no laço, e os laços internos são tratados
+ * primeiro, de modo que um valor pode subir vários níveis.
+ */
+class LoopInvariantMotion {
+    public:
+        LoopInvariantMotion(semantic::Program& program, semantic::SymbolTable& symb_table, Options& options);
+
+        void run();
+
+    private:
+        void hoist(ControlFlowGraph& cfg, Loop* loop);
+        bool is_invariant(const std::vector<syntax::Elem*>& exp);
+        void hoist(std::vector<syntax::Elem*>& exp, std::vector<semantic::Command*>& hoisted, semantic::Command* command);
+
+        void report(const std::string& message);
+
+        semantic::Program& program;
+        semantic::SymbolTable& symb_table;
+        Options& options;
+
+        std::set<std::string> written;     // Variáveis escritas no laço atual
+};
+
+} // namespace optimization
+
+#endif // LOOP_INVARIANT_MOTION_HPP
@@ -0,0 +1,74 @@
+#ifndef MEMOIZER_HPP
+#define MEMOIZER_HPP
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "syntax.hpp"
+#include "semantic.hpp"
+#include "optimization.hpp"
+#include "ControlFlowGraph.hpp"
+#include "RangeAnalysis.hpp"
+
+// Maior tabela, em elementos, que substitui uma função
+#define MEMO_LIMIT 256
+// Operadores a partir dos quais o corpo é caro o bastante para a tabela;
+// com divisão, potência ou chamada, qualquer corpo é
+#define MEMO_OPERATORS 4
+// Chamadas aninhadas admitidas ao calcular a tabela
+#define MEMO_CALL_DEPTH 16
+
+namespace optimization {
+
+// Argumentos possíveis de uma função nas chamadas trocadas pela tabela
+typedef std::vector<Interval> Domain;
+
+/*
+ * Tabelas de funções puras: uma função DEF FN cujo corpo lê apenas os
+ * parâmetros, chamada num laço com argumentos de intervalo pequeno e
+ * conhecido, como iteradores de FOR, é calculada em compilação para
+ * todos os argumentos do intervalo. Os valores vão para um vetor
+ * preenchido por um READ no início do programa, e cada chamada com
+ * argumentos dentro do intervalo vira um acesso ao vetor.
+ */
+class Memoizer {
+    public:
+        Memoizer(semantic::Program& program, semantic::SymbolTable& symb_table, Options& options);
+
+        void run();
+
+    private:
+        bool is_pure(const std::string& name);
+        bool is_expensive(semantic::Command* def);
+
+        void collect(semantic::Command* command, std::vector<syntax::Elem*>& exp);
+        bool tabulate(semantic::Command* def, const Domain& domain);
+        bool evaluate(semantic::Command* def, const std::vector<int>& args, int& result);
+        bool replace(semantic::Command* command, std::vector<syntax::Elem*>& exp);
+
+        void report(const std::string& message);
+
+        semantic::Program& program;
+        semantic::SymbolTable& symb_table;
+        Options& options;
+
+        ControlFlowGraph* cfg = nullptr;
+        RangeAnalysis* ranges = nullptr;
+
+        std::map<std::string, semantic::Command*> functions;
+        std::map<std::string, bool> pure;
+        int depth = 0;
+
+        // Intervalos dos argumentos nas chamadas dentro de laços
+        std::map<std::string, Domain> domains;
+
+        // Vetor e intervalo de cada função tabelada
+        std::map<std::string, syntax::Array*> tables;
+        std::map<std::string, Domain> tabulated;
+        std::vector<std::pair<syntax::Var*, syntax::Num*>> values;
+};
+
+} // namespace optimization
+
+#endif // MEMOIZER_HPP
@@ -0,0 +1,32 @@
+#ifndef OPTIMIZER_HPP
+#define OPTIMIZER_HPP
+
+#include "semantic.hpp"
+#include "optimization.hpp"
+#include "IR.hpp"
+
+namespace optimization {
+
+/*
+ * Executa, em ordem, os passos de otimização sobre o programa produzido
+ * pela análise semântica e, depois, sobre a sua representação
+ * intermediária, antes da geração de código.
+ */
+class Optimizer {
+    public:
+        Optimizer(semantic::Program& program, semantic::SymbolTable& symb_table, Options& options);
+
+        void run();
+        void run(IR& ir);
+
+    private:
+        void observe_variables();
+
+        semantic::Program& program;
+        semantic::SymbolTable& symb_table;
+        Options& options;
+};
+
+} // namespace optimization
+
+#endif // OPTIMIZER_HPP
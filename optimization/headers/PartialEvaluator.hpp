@@ -0,0 +1,70 @@
+#ifndef PARTIAL_EVALUATOR_HPP
+#define PARTIAL_EVALUATOR_HPP
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "syntax.hpp"
+#include "semantic.hpp"
+#include "optimization.hpp"
+
+// Chamadas de função aninhadas admitidas durante a avaliação
+#define EVAL_CALL_DEPTH 64
+// GOSUBs aninhados admitidos, como na pilha exe_stack
+#define EVAL_GOSUB_DEPTH 64
+
+namespace optimization {
+
+// Memória do programa durante a avaliação, pelo identificador
+class Memory {
+    public:
+        std::map<std::string, int> scalars;
+        std::map<std::string, std::vector<int>> arrays;
+};
+
+/*
+ * Avaliação parcial do programa inteiro: sem INPUT e com READ/DATA
+ * resolvidos na análise semântica, a execução não depende de nada
+ * externo. O programa é executado em compilação, a partir da entrada,
+ * até o END ou até o limite de passos; o trecho executado é trocado por
+ * um READ com o estado alcançado e um PRINT com os valores impressos,
+ * seguidos do comando em que a execução parou. A avaliação também para
+ * antes de um comando cujo efeito só se conhece em execução (índice fora
+ * do vetor, divisão por zero); dentro de uma sub-rotina, volta ao GOSUB
+ * mais externo, pois a pilha de retorno não faz parte do estado.
+ */
+class PartialEvaluator {
+    public:
+        PartialEvaluator(semantic::Program& program, semantic::SymbolTable& symb_table, Options& options);
+
+        void run();
+
+    private:
+        bool execute(semantic::Command* command, semantic::Command*& following);
+        bool evaluate(const std::vector<syntax::Elem*>& exp, int& result);
+        bool call(syntax::Call* call, const std::vector<int>& args, int& result);
+        int* element(syntax::Var* array, int index);
+
+        bool has_calls(semantic::Command* command);
+        void replace(semantic::Command* resume);
+
+        void report(const std::string& message);
+
+        semantic::Program& program;
+        semantic::SymbolTable& symb_table;
+        Options& options;
+
+        Memory memory;
+        std::vector<semantic::Command*> returns;
+        std::vector<int> output;
+        std::map<std::string, semantic::Command*> functions;
+        int depth = 0;
+
+        // Motivo da parada antes do fim do programa
+        std::string reason;
+};
+
+} // namespace optimization
+
+#endif // PARTIAL_EVALUATOR_HPP
@@ -0,0 +1,88 @@
+#ifndef RANGE_ANALYSIS_HPP
+#define RANGE_ANALYSIS_HPP
+
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+#include <unordered_map>
+
+#include "syntax.hpp"
+#include "semantic.hpp"
+#include "optimization.hpp"
+#include "ControlFlowGraph.hpp"
+
+// Mudanças do intervalo de uma variável na entrada de um laço antes de alargá-lo
+#define WIDEN_LIMIT 3
+// Saltos de uma constante do programa à seguinte antes de ir ao extremo
+#define WIDEN_JUMPS 10
+// Passadas de estreitamento depois do ponto fixo
+#define NARROW_ROUNDS 3
+
+namespace optimization {
+
+// Intervalo fechado de valores inteiros
+struct Interval {
+    long long low;
+    long long high;
+
+    bool operator==(const Interval& other) const {
+        return low == other.low && high == other.high;
+    }
+};
+
+// Intervalos das variáveis simples, pelo identificador; variável ausente
+// pode ter qualquer valor
+typedef std::map<std::string, Interval> Ranges;
+
+/*
+ * Análise de intervalos para o modo --bounds-check: propaga sobre o grafo
+ * de fluxo os valores possíveis de cada variável simples, estreitados
+ * pelas comparações de FOR e IF, e marca os acessos a vetores cujo índice
+ * linearizado cabe sempre no vetor. Esses acessos dispensam a verificação
+ * em tempo de execução.
+ */
+class RangeAnalysis {
+    public:
+        RangeAnalysis(semantic::Program& program, semantic::SymbolTable& symb_table, Options& options);
+
+        void run();
+
+        // Apenas propaga os intervalos, sem marcar acessos, para consulta
+        // por outros passos com range
+        void analyse();
+        Interval range(semantic::Command* command, const std::vector<syntax::Elem*>& exp);
+
+    private:
+        void propagate(ControlFlowGraph& cfg);
+        bool join(ControlFlowGraph& cfg, semantic::Command* command, Ranges& ranges);
+        long long widen_high(long long high);
+        long long widen_low(long long low);
+        bool incoming(semantic::Command* pred, semantic::Command* command, Ranges& ranges);
+        bool restrict(Ranges& ranges, syntax::Elem* elem, syntax::If::cmp op, Interval bound);
+        void transfer(semantic::Command* command, Ranges& ranges);
+
+        Interval evaluate(const std::vector<syntax::Elem*>& exp, const Ranges& ranges, semantic::Command* command = nullptr);
+        void verify(syntax::ArrayAccess* access, Interval index, semantic::Command* command);
+
+        void report(const std::string& message);
+
+        semantic::Program& program;
+        semantic::SymbolTable& symb_table;
+        Options& options;
+
+        Ranges initial;
+        std::set<long long> thresholds;
+        std::unordered_map<semantic::Command*, Ranges> in;
+        std::unordered_map<semantic::Command*, Ranges> out;
+        std::set<semantic::Command*> reached;
+
+        // Um acesso compartilhado por várias expressões só dispensa a
+        // verificação se estiver dentro dos limites em todas elas
+        std::set<syntax::ArrayAccess*> proven;
+        std::set<syntax::ArrayAccess*> failed;
+};
+
+} // namespace optimization
+
+#endif // RANGE_ANALYSIS_HPP
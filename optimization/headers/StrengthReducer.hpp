@@ -0,0 +1,70 @@
+#ifndef STRENGTH_REDUCER_HPP
+#define STRENGTH_REDUCER_HPP
+
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "syntax.hpp"
+#include "semantic.hpp"
+#include "optimization.hpp"
+#include "ControlFlowGraph.hpp"
+
+namespace optimization {
+
+/*
+ * Redução de força de índices de vetores em laços. Uma variável de
+ * indução básica é escrita uma única vez no laço, somando um valor
+ * invariante (NEXT de FOR ou LET I = I + c em laços com GOTO). Um índice
+ * linearizado da forma c * I + resto, com c constante e resto invariante,
+ * passa a ser um temporário iniciado no pré-cabeçalho e incrementado de
+ * c vezes o passo logo após cada atualização de I, trocando a
+ * multiplicação por uma soma a cada iteração.
+ */
+class StrengthReducer {
+    public:
+        StrengthReducer(semantic::Program& program, semantic::SymbolTable& symb_table, Options& options);
+
+        void run();
+
+    private:
+        // Expressão linear em uma variável de indução: coef * iv + rest
+        struct Linear {
+            bool valid;
+            int start;                          // Início do trecho na expressão
+            syntax::Var* iv;                    // nullptr se invariante
+            int coef;
+            std::vector<syntax::Elem*> rest;    // Parte invariante, vazia se zero
+        };
+
+        // Variável de indução básica e o comando que a incrementa
+        struct Induction {
+            semantic::Command* update;
+            std::vector<syntax::Elem*> step;
+        };
+
+        void reduce(ControlFlowGraph& cfg, Loop* loop);
+        void find_inductions(std::vector<semantic::Command*>& body);
+        bool is_invariant(const std::vector<syntax::Elem*>& exp);
+        void reduce(std::vector<syntax::Elem*>& exp, semantic::Command* command);
+        Linear combine(syntax::Elem* op, Linear& left, Linear& right);
+        std::vector<syntax::Elem*> scale(const std::vector<syntax::Elem*>& exp, int factor);
+
+        void report(const std::string& message);
+
+        semantic::Program& program;
+        semantic::SymbolTable& symb_table;
+        Options& options;
+
+        // Estado do laço atual
+        std::set<std::string> written;
+        std::map<std::string, Induction> inductions;
+        std::map<std::string, syntax::Var*> reduced;    // Temporário de cada índice reduzido
+        std::vector<semantic::Command*> initializations;
+        std::vector<std::pair<semantic::Command*, semantic::Command*>> increments;
+};
+
+} // namespace optimization
+
+#endif // STRENGTH_REDUCER_HPP
@@ -0,0 +1,77 @@
+#ifndef VALUE_NUMBERING_HPP
+#define VALUE_NUMBERING_HPP
+
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+#include <unordered_map>
+
+#include "syntax.hpp"
+#include "semantic.hpp"
+#include "optimization.hpp"
+#include "ControlFlowGraph.hpp"
+
+namespace optimization {
+
+/*
+ * Eliminação de subexpressões comuns por numeração de valores. Cada
+ * subexpressão recebe um número que identifica o valor calculado; o
+ * escopo da numeração segue a árvore de dominadores, de modo que um
+ * valor calculado em um bloco é reaproveitado nos blocos dominados
+ * enquanto nenhum caminho entre eles alterar seus operandos.
+ *
+ * Um cálculo redundante passa a ler a variável que já guarda o valor
+ * ou, se não houver, um temporário atribuído no primeiro cálculo.
+ */
+class ValueNumbering {
+    public:
+        ValueNumbering(semantic::Program& program, semantic::SymbolTable& symb_table, Options& options);
+        ~ValueNumbering();
+
+        void run();
+
+    private:
+        // Subexpressão em forma de árvore
+        struct Node {
+            syntax::Elem* elem;
+            std::vector<Node*> operands;
+            int value = 0;                      // Número do valor calculado
+            bool redundant = false;             // Valor já calculado antes
+            syntax::Var* holder = nullptr;      // Variável que já guarda o valor
+            bool reused = false;                // Primeiro cálculo de um valor redundante
+            syntax::Var* temporary = nullptr;   // Guarda o valor para os cálculos redundantes
+        };
+
+        // Números de valor visíveis em um ponto do programa
+        struct Scope {
+            std::map<std::string, int> variables;   // Valor de variável simples ou versão de vetor
+            std::map<std::string, int> table;       // Valor de cada subexpressão
+        };
+
+        void number(BasicBlock* block, Scope scope, std::unordered_map<BasicBlock*, std::vector<BasicBlock*>>& children);
+        void number(Node* node, Scope& scope);
+        int value_of(const std::string& identifier, Scope& scope);
+        std::set<std::string> region_writes(BasicBlock* block);
+        std::vector<std::string> writes(semantic::Command* command);
+
+        Node* build(const std::vector<syntax::Elem*>& exp);
+        void mark(Node* node);
+        void flatten(Node* node, std::vector<syntax::Elem*>& exp, semantic::Command* command, std::vector<semantic::Command*>& inserted);
+
+        void report(const std::string& message);
+
+        semantic::Program& program;
+        semantic::SymbolTable& symb_table;
+        Options& options;
+
+        int values = 0;
+        std::vector<Node*> nodes;
+        std::unordered_map<semantic::Command*, std::vector<Node*>> trees;
+        std::map<int, Node*> first;             // Primeiro cálculo de cada valor
+        std::unordered_map<std::string, syntax::Var*> variables;
+};
+
+} // namespace optimization
+
+#endif // VALUE_NUMBERING_HPP
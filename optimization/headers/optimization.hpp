@@ -0,0 +1,80 @@
+#ifndef OPTIMIZATION_HPP
+#define OPTIMIZATION_HPP
+
+#include <vector>
+#include <algorithm>
+
+#include "semantic.hpp"
+
+namespace optimization {
+
+class Options {
+    public:
+        bool optimize = true;       // -O0 desliga os passes de otimização e o peephole
+        bool report = false;        // --report lista o que foi otimizado
+        bool bounds_check = false;  // --bounds-check verifica os índices de vetores em execução
+        bool dump_ir = false;       // --dump-ir imprime a representação intermediária
+        bool partial_eval = false;  // --partial-eval executa o programa em compilação
+        int eval_steps = 100000;    // --partial-eval=N limita a execução a N comandos
+        bool emit_obj = false;      // --emit-obj escreve um objeto ELF no lugar do assembly
+        bool thumb = false;         // -mthumb gera código Thumb, de 16 bits
+};
+
+class BasicBlock {
+    public:
+        BasicBlock(int id):
+            id(id)
+        {}
+
+        semantic::Command* first() {
+            return commands.front();
+        }
+
+        semantic::Command* last() {
+            return commands.back();
+        }
+
+        bool is_reachable() {
+            return order >= 0;
+        }
+
+        int id;
+        std::vector<semantic::Command*> commands;
+        std::vector<BasicBlock*> predecessors;
+        std::vector<BasicBlock*> successors;
+
+        BasicBlock* idom = nullptr;     // Dominador imediato
+        int order = -1;                 // Posição em pós-ordem reversa, -1 se inalcançável
+};
+
+/*
+ * Laço natural: cabeçalho que domina as origens de todas as arestas de
+ * retorno (latches) e os blocos que alcançam essas origens sem passar
+ * pelo cabeçalho.
+ */
+class Loop {
+    public:
+        Loop(BasicBlock* header):
+            header(header)
+        {}
+
+        bool contains(BasicBlock* block) {
+            return std::find(blocks.begin(), blocks.end(), block) != blocks.end();
+        }
+
+        int depth() {
+            int d = 1;
+            for (Loop* l = parent; l != nullptr; l = l->parent)
+                d++;
+            return d;
+        }
+
+        BasicBlock* header;
+        std::vector<BasicBlock*> latches;
+        std::vector<BasicBlock*> blocks;
+        Loop* parent = nullptr;
+};
+
+} // namespace optimization
+
+#endif // OPTIMIZATION_HPP
@@ -0,0 +1,335 @@
+#include <iostream>
+#include <vector>
+#include <string>
+#include <climits>
+#include <cstdint>
+
+#include "syntax.hpp"
+#include "semantic.hpp"
+#include "optimization.hpp"
+#include "ControlFlowGraph.hpp"
+
+#include "ConstantFolder.hpp"
+
+using namespace std;
+using namespace semantic;
+using namespace optimization;
+
+ConstantFolder::ConstantFolder(Program& program, SymbolTable& symb_table, Options& options):
+    program(program), symb_table(symb_table), options(options)
+{}
+
+void ConstantFolder::report(const string& message) {
+    if (options.report)
+        cout << "\t" << message << endl;
+}
+
+void ConstantFolder::run() {
+    if (options.report)
+        cout << "Propagação de constantes:" << endl;
+
+    ControlFlowGraph cfg(program);
+    propagate(cfg);
+
+    for (auto command : program.commands) {
+        if (command->kind == Command::DEF) {
+            // Parâmetros variam a cada chamada: apenas dobra o corpo
+            fold(command, "corpo de " + command->label, command->exps[0], Constants());
+            continue;
+        }
+
+        if (!reached.count(command))
+            continue;
+
+        Constants known = in[command];
+
+        if (command->kind == Command::READ) {
+            // Índices de uma leitura podem usar variáveis lidas antes no mesmo comando
+            for (auto pair : command->read_data) {
+                if (pair.first->is_array()) {
+                    syntax::ArrayAccess* access = dynamic_cast<syntax::ArrayAccess*>(pair.first);
+                    vector<syntax::Elem*> index = access->get_processed_access_exps();
+                    if (fold(index, known))
+                        access->set_processed_access_exps(index);
+                }
+                else {
+                    known[pair.first->get_identifier()] = pair.second->get_value();
+                }
+            }
+            continue;
+        }
+
+        for (int i = 0; i < command->exps.size(); i++)
+            fold(command, "expressão " + to_string(i + 1), command->exps[i], known);
+    }
+}
+
+/*
+ * Valores conhecidos na entrada de cada comando. Um comando ainda não
+ * alcançado não restringe seus sucessores, de modo que valores que
+ * entram em um laço e não mudam dentro dele continuam conhecidos.
+ */
+void ConstantFolder::propagate(ControlFlowGraph& cfg) {
+    Command* entry = program.entry();
+    if (entry == nullptr)
+        return;
+
+    // A área de variáveis começa zerada
+    Constants initial;
+    for (auto var : symb_table.get_variables()) {
+        if (!var->is_array())
+            initial[var->get_identifier()] = 0;
+    }
+
+    vector<Command*> commands;
+    for (auto command : program.commands) {
+        if (command->kind != Command::DEF)
+            commands.push_back(command);
+    }
+
+    unordered_map<Command*, Constants> out;
+
+    bool changed = true;
+    while (changed) {
+        changed = false;
+
+        for (auto command : commands) {
+            bool first = true;
+            Constants known;
+
+            auto meet = [&first, &known](const Constants& incoming) {
+                if (first) {
+                    known = incoming;
+                    first = false;
+                    return;
+                }
+                for (auto it = known.begin(); it != known.end(); ) {
+                    auto other = incoming.find(it->first);
+                    if (other == incoming.end() || other->second != it->second)
+                        it = known.erase(it);
+                    else
+                        ++it;
+                }
+            };
+
+            if (command == entry)
+                meet(initial);
+            for (auto pred : cfg.predecessors(command)) {
+                if (reached.count(pred))
+                    meet(out[pred]);
+            }
+
+            if (first)
+                continue;
+
+            if (!reached.count(command) || known != in[command]) {
+                reached.insert(command);
+                in[command] = known;
+                transfer(command, known);
+                out[command] = known;
+                changed = true;
+            }
+        }
+    }
+}
+
+void ConstantFolder::transfer(Command* command, Constants& known) {
+    int value;
+
+    switch (command->kind) {
+        case Command::ASSIGN:
+        case Command::FOR:
+            if (evaluate(command->exps[0], known, value))
+                known[command->variable->get_identifier()] = value;
+            else
+                known.erase(command->variable->get_identifier());
+            break;
+        case Command::NEXT: {
+            auto it = known.find(command->variable->get_identifier());
+            if (it != known.end() && evaluate(command->exps[0], known, value))
+                it->second = (int) ((uint32_t) it->second + (uint32_t) value);
+            else
+                known.erase(command->variable->get_identifier());
+            break;
+        }
+        case Command::READ:
+            for (auto pair : command->read_data) {
+                if (!pair.first->is_array())
+                    known[pair.first->get_identifier()] = pair.second->get_value();
+            }
+            break;
+        default:
+            break;
+    }
+}
+
+bool ConstantFolder::evaluate(syntax::Elem::type op, int left, int right, int& result) {
+    uint32_t l = left, r = right;
+
+    switch (op) {
+        case syntax::Elem::ADD:
+            result = (int) (l + r);
+            return true;
+        case syntax::Elem::SUB:
+            result = (int) (l - r);
+            return true;
+        case syntax::Elem::MUL:
+            result = (int) (l * r);
+            return true;
+        case syntax::Elem::DIV:
+            // sdiv não define o quociente da divisão por zero
+            if (right == 0 || (left == INT_MIN && right == -1))
+                return false;
+            result = left / right;
+            return true;
+        case syntax::Elem::POW: {
+            if (left == 0 || right < 0) {
+                result = 0;
+                return true;
+            }
+            uint32_t power = 1;
+            for (uint32_t e = right; e > 0; e >>= 1) {
+                if (e & 1)
+                    power *= l;
+                l *= l;
+            }
+            result = (int) power;
+            return true;
+        }
+        default:
+            return false;
+    }
+}
+
+bool ConstantFolder::evaluate(const vector<syntax::Elem*>& exp, const Constants& known, int& result) {
+    vector<int> stack;
+
+    for (auto e : exp) {
+        if (e->get_elem_type() == syntax::Elem::NUM) {
+            stack.push_back(dynamic_cast<syntax::Num*>(e)->get_value());
+        }
+        else if (e->get_elem_type() == syntax::Elem::VAR) {
+            syntax::Var* var = dynamic_cast<syntax::Var*>(e);
+            auto it = known.find(var->get_identifier());
+            if (var->is_array() || it == known.end())
+                return false;
+            stack.push_back(it->second);
+        }
+        else if (e->is_operator()) {
+            int right = stack.back();
+            stack.pop_back();
+            if (!evaluate(e->get_elem_type(), stack.back(), right, stack.back()))
+                return false;
+        }
+        else {
+            return false;
+        }
+    }
+
+    if (stack.size() != 1)
+        return false;
+
+    result = stack.back();
+    return true;
+}
+
+/*
+ * Reescreve a expressão pós-fixa: variáveis conhecidas viram constantes,
+ * operações entre constantes são avaliadas e operações com elemento
+ * neutro (x + 0, x * 1, ...) ou absorvente (x * 0) são eliminadas.
+ */
+bool ConstantFolder::fold(vector<syntax::Elem*>& exp, const Constants& known) {
+    // Operando na pilha: início do seu trecho na saída e valor, se constante
+    struct Operand {
+        int start;
+        bool constant;
+        int value;
+    };
+
+    vector<syntax::Elem*> folded;
+    vector<Operand> stack;
+
+    for (auto e : exp) {
+        if (e->get_elem_type() == syntax::Elem::NUM) {
+            stack.push_back({(int) folded.size(), true, dynamic_cast<syntax::Num*>(e)->get_value()});
+            folded.push_back(e);
+        }
+        else if (e->get_elem_type() == syntax::Elem::VAR) {
+            syntax::Var* var = dynamic_cast<syntax::Var*>(e);
+
+            if (var->is_array()) {
+                // Consome o índice linearizado
+                stack.back().constant = false;
+                folded.push_back(e);
+                continue;
+            }
+
+            auto it = known.find(var->get_identifier());
+            if (it != known.end()) {
+                stack.push_back({(int) folded.size(), true, it->second});
+                folded.push_back(program.constant(it->second));
+            }
+            else {
+                stack.push_back({(int) folded.size(), false, 0});
+                folded.push_back(e);
+            }
+        }
+        else if (e->get_elem_type() == syntax::Elem::FUN) {
+            int args = dynamic_cast<syntax::Call*>(e)->get_args().size();
+            int start = args > 0 ? stack[stack.size() - args].start : folded.size();
+            stack.resize(stack.size() - args);
+            stack.push_back({start, false, 0});
+            folded.push_back(e);
+        }
+        else if (e->is_operator()) {
+            Operand right = stack.back();
+            stack.pop_back();
+            Operand left = stack.back();
+            stack.pop_back();
+
+            syntax::Elem::type op = e->get_elem_type();
+            int value;
+
+            if (left.constant && right.constant && evaluate(op, left.value, right.value, value)) {
+                folded.resize(left.start);
+                folded.push_back(program.constant(value));
+                stack.push_back({left.start, true, value});
+            }
+            else if (right.constant && ((right.value == 0 && (op == syntax::Elem::ADD || op == syntax::Elem::SUB))
+                                     || (right.value == 1 && (op == syntax::Elem::MUL || op == syntax::Elem::DIV || op == syntax::Elem::POW)))) {
+                folded.resize(right.start);
+                stack.push_back(left);
+            }
+            else if (left.constant && ((left.value == 0 && op == syntax::Elem::ADD)
+                                    || (left.value == 1 && op == syntax::Elem::MUL))) {
+                folded.erase(folded.begin() + left.start, folded.begin() + right.start);
+                stack.push_back({left.start, right.constant, right.value});
+            }
+            else if (op == syntax::Elem::MUL && ((left.constant && left.value == 0) || (right.constant && right.value == 0))) {
+                folded.resize(left.start);
+                folded.push_back(program.constant(0));
+                stack.push_back({left.start, true, 0});
+            }
+            else {
+                folded.push_back(e);
+                stack.push_back({left.start, false, 0});
+            }
+        }
+    }
+
+    if (folded == exp)
+        return false;
+
+    exp = folded;
+    return true;
+}
+
+void ConstantFolder::fold(Command* command, const string& what, vector<syntax::Elem*>& exp, const Constants& known) {
+    if (!fold(exp, known))
+        return;
+
+    if (exp.size() == 1 && exp[0]->get_elem_type() == syntax::Elem::NUM)
+        report(command->label + ": " + what + " reduzida à constante " + to_string(dynamic_cast<syntax::Num*>(exp[0])->get_value()));
+    else
+        report(command->label + ": " + what + " simplificada");
+}
@@ -0,0 +1,363 @@
+#include <iostream>
+#include <vector>
+#include <algorithm>
+
+#include "semantic.hpp"
+#include "optimization.hpp"
+
+#include "ControlFlowGraph.hpp"
+
+using namespace std;
+using namespace semantic;
+using namespace optimization;
+
+ControlFlowGraph::ControlFlowGraph(Program& program):
+    program(program)
+{
+    find_return_sites();
+    build_blocks();
+    compute_order();
+    compute_dominators();
+    find_loops();
+}
+
+ControlFlowGraph::~ControlFlowGraph() {
+    for (auto block : blocks)
+        delete block;
+    for (auto loop : loops)
+        delete loop;
+}
+
+const vector<BasicBlock*>& ControlFlowGraph::get_blocks() {
+    return blocks;
+}
+
+BasicBlock* ControlFlowGraph::get_entry() {
+    return blocks.empty() ? nullptr : blocks.front();
+}
+
+BasicBlock* ControlFlowGraph::block_of(Command* command) {
+    auto it = command_block.find(command);
+    return it == command_block.end() ? nullptr : it->second;
+}
+
+const vector<BasicBlock*>& ControlFlowGraph::reverse_postorder() {
+    return rpo;
+}
+
+const vector<Loop*>& ControlFlowGraph::get_loops() {
+    return loops;
+}
+
+Command* ControlFlowGraph::preheader_edge(Loop* loop) {
+    Command* edge = nullptr;
+
+    for (auto pred : predecessors(loop->header->first())) {
+        if (loop->contains(block_of(pred)))
+            continue;
+        if (edge != nullptr)
+            return nullptr;
+        edge = pred;
+    }
+
+    if (edge == nullptr)
+        return nullptr;
+
+    switch (edge->kind) {
+        case Command::ASSIGN:
+        case Command::READ:
+        case Command::PRINT:
+        case Command::FOR:
+        case Command::GOTO:
+        case Command::NEXT:
+            return edge;
+        default:
+            return nullptr;
+    }
+}
+
+bool ControlFlowGraph::is_reducible() {
+    return reducible;
+}
+
+/*
+ * GOSUB é tratado como desvio para a subrotina; o retorno é modelado
+ * por arestas de cada RETURN para todos os pontos de retorno, já que a
+ * pilha de chamadas não é conhecida em compilação.
+ */
+void ControlFlowGraph::find_return_sites() {
+    for (auto command : program.commands) {
+        if (command->kind == Command::GOSUB && command->next)
+            return_sites.push_back(command->next);
+    }
+}
+
+vector<Command*> ControlFlowGraph::successors(Command* command) {
+    vector<Command*> succ;
+
+    switch (command->kind) {
+        case Command::ASSIGN:
+        case Command::READ:
+        case Command::PRINT:
+        case Command::FOR:
+            succ.push_back(command->next);
+            break;
+        case Command::GOTO:
+        case Command::NEXT:
+        case Command::GOSUB:
+            succ.push_back(command->target);
+            break;
+        case Command::IF:
+        case Command::COMP:
+            succ.push_back(command->next);
+            if (command->target != command->next)
+                succ.push_back(command->target);
+            break;
+        case Command::RETURN:
+            succ = return_sites;
+            break;
+        case Command::DEF:
+        case Command::END:
+            break;
+    }
+
+    return succ;
+}
+
+vector<Command*> ControlFlowGraph::predecessors(Command* command) {
+    auto it = command_preds.find(command);
+    return it == command_preds.end() ? vector<Command*>() : it->second;
+}
+
+void ControlFlowGraph::build_blocks() {
+    vector<Command*> commands;
+    for (auto command : program.commands) {
+        if (command->kind != Command::DEF)
+            commands.push_back(command);
+    }
+
+    for (auto command : commands) {
+        for (auto succ : successors(command))
+            command_preds[succ].push_back(command);
+    }
+
+    // Um comando continua o bloco anterior somente se for o único
+    // sucessor do anterior e o anterior for seu único predecessor
+    Command* previous = nullptr;
+    BasicBlock* current = nullptr;
+    for (auto command : commands) {
+        bool leader = (current == nullptr);
+
+        if (!leader) {
+            vector<Command*> succ = successors(previous);
+            vector<Command*>& pred = command_preds[command];
+            leader = succ.size() != 1 || succ[0] != command
+                || pred.size() != 1 || pred[0] != previous;
+        }
+
+        if (leader) {
+            current = new BasicBlock(blocks.size());
+            blocks.push_back(current);
+        }
+
+        current->commands.push_back(command);
+        command_block[command] = current;
+        previous = command;
+    }
+
+    for (auto block : blocks) {
+        for (auto succ : successors(block->last())) {
+            BasicBlock* target = command_block[succ];
+            if (find(block->successors.begin(), block->successors.end(), target) == block->successors.end()) {
+                block->successors.push_back(target);
+                target->predecessors.push_back(block);
+            }
+        }
+    }
+}
+
+void ControlFlowGraph::compute_order() {
+    if (blocks.empty())
+        return;
+
+    // Busca em profundidade iterativa a partir da entrada
+    vector<BasicBlock*> postorder;
+    vector<bool> visited(blocks.size(), false);
+    vector<pair<BasicBlock*, int>> stack;
+
+    stack.push_back(make_pair(get_entry(), 0));
+    visited[get_entry()->id] = true;
+
+    while (!stack.empty()) {
+        BasicBlock* block = stack.back().first;
+        int i = stack.back().second;
+
+        if (i < block->successors.size()) {
+            stack.back().second++;
+            BasicBlock* succ = block->successors[i];
+            if (!visited[succ->id]) {
+                visited[succ->id] = true;
+                stack.push_back(make_pair(succ, 0));
+            }
+        }
+        else {
+            postorder.push_back(block);
+            stack.pop_back();
+        }
+    }
+
+    rpo.assign(postorder.rbegin(), postorder.rend());
+    for (int i = 0; i < rpo.size(); i++)
+        rpo[i]->order = i;
+}
+
+/*
+ * Dominadores pelo algoritmo iterativo de Cooper, Harvey e Kennedy
+ * ("A Simple, Fast Dominance Algorithm")
+ */
+void ControlFlowGraph::compute_dominators() {
+    if (rpo.empty())
+        return;
+
+    BasicBlock* entry = get_entry();
+    entry->idom = entry;
+
+    auto intersect = [](BasicBlock* a, BasicBlock* b) {
+        while (a != b) {
+            while (a->order > b->order)
+                a = a->idom;
+            while (b->order > a->order)
+                b = b->idom;
+        }
+        return a;
+    };
+
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (auto block : rpo) {
+            if (block == entry)
+                continue;
+
+            BasicBlock* idom = nullptr;
+            for (auto pred : block->predecessors) {
+                if (pred->idom == nullptr)
+                    continue;
+                idom = (idom == nullptr) ? pred : intersect(pred, idom);
+            }
+
+            if (idom != block->idom) {
+                block->idom = idom;
+                changed = true;
+            }
+        }
+    }
+
+    entry->idom = nullptr;
+}
+
+bool ControlFlowGraph::dominates(BasicBlock* a, BasicBlock* b) {
+    if (!a->is_reachable() || !b->is_reachable())
+        return false;
+
+    for (BasicBlock* block = b; block != nullptr; block = block->idom) {
+        if (block == a)
+            return true;
+    }
+    return false;
+}
+
+/*
+ * Toda aresta cujo destino domina a origem fecha um laço natural, seja
+ * ela o NEXT de um FOR ou um IF/GOTO para uma linha anterior. Arestas
+ * para trás que não são de retorno tornam o grafo irredutível.
+ */
+void ControlFlowGraph::find_loops() {
+    for (auto block : rpo) {
+        for (auto succ : block->successors) {
+            if (dominates(succ, block)) {
+                Loop* loop = nullptr;
+                for (auto l : loops) {
+                    if (l->header == succ)
+                        loop = l;
+                }
+                if (loop == nullptr) {
+                    loop = new Loop(succ);
+                    loop->blocks.push_back(succ);
+                    loops.push_back(loop);
+                }
+                loop->latches.push_back(block);
+
+                vector<BasicBlock*> worklist;
+                worklist.push_back(block);
+                while (!worklist.empty()) {
+                    BasicBlock* b = worklist.back();
+                    worklist.pop_back();
+                    if (loop->contains(b))
+                        continue;
+                    loop->blocks.push_back(b);
+                    for (auto pred : b->predecessors) {
+                        if (pred->is_reachable())
+                            worklist.push_back(pred);
+                    }
+                }
+            }
+            else if (succ->order <= block->order) {
+                reducible = false;
+            }
+        }
+    }
+
+    stable_sort(loops.begin(), loops.end(), [](Loop* a, Loop* b) {
+        return a->blocks.size() < b->blocks.size();
+    });
+
+    for (int i = 0; i < loops.size(); i++) {
+        for (int j = i + 1; j < loops.size(); j++) {
+            if (loops[j]->contains(loops[i]->header) && loops[j]->header != loops[i]->header) {
+                loops[i]->parent = loops[j];
+                break;
+            }
+        }
+    }
+}
+
+Loop* ControlFlowGraph::innermost_loop(BasicBlock* block) {
+    for (auto loop : loops) {
+        if (loop->contains(block))
+            return loop;
+    }
+    return nullptr;
+}
+
+void ControlFlowGraph::print() {
+    auto names = [](const vector<BasicBlock*>& list) {
+        string s;
+        for (auto block : list)
+            s += " B" + to_string(block->id);
+        return s.empty() ? " -" : s;
+    };
+
+    for (auto block : blocks) {
+        cout << "B" << block->id << ":";
+        for (auto command : block->commands)
+            cout << " " << command->label;
+        if (!block->is_reachable())
+            cout << " (inalcançável)";
+        cout << endl;
+
+        cout << "\tpredecessores:" << names(block->predecessors) << endl;
+        cout << "\tsucessores:" << names(block->successors) << endl;
+        if (block->idom)
+            cout << "\tdominador imediato: B" << block->idom->id << endl;
+    }
+
+    for (auto loop : loops) {
+        cout << "Laço em B" << loop->header->id << " (profundidade " << loop->depth() << "):"
+            << names(loop->blocks) << endl;
+        cout << "\tretorno de:" << names(loop->latches) << endl;
+    }
+
+    if (!reducible)
+        cout << "Grafo irredutível: há desvios para dentro de laços" << endl;
+}
@@ -0,0 +1,47 @@
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "optimization.hpp"
+
+#include "CopyPropagator.hpp"
+
+using namespace std;
+using namespace optimization;
+
+CopyPropagator::CopyPropagator(IR& ir, Options& options):
+    ir(ir), options(options)
+{}
+
+void CopyPropagator::report(const string& message) {
+    if (options.report)
+        cout << "\t" << message << endl;
+}
+
+void CopyPropagator::run() {
+    if (options.report)
+        cout << "Propagação de cópias:" << endl;
+
+    propagate(ir.main);
+    for (auto function : ir.functions)
+        propagate(function);
+}
+
+void CopyPropagator::propagate(IRFunction* function) {
+    for (auto block : function->blocks) {
+        for (int i = 0; i < block->instructions.size(); i++) {
+            IRInstruction* copy = block->instructions[i];
+            if (copy->op != IRInstruction::COPY)
+                continue;
+
+            report(block->label + ": " + copy->result->name() + " substituído por " + copy->operands[0]->name());
+            ir.replace_uses(function, copy->result, copy->operands[0]);
+            block->instructions.erase(block->instructions.begin() + i);
+            delete copy;
+            i--;
+        }
+    }
+
+    // Phi cujos operandos passaram a ser a mesma origem
+    ir.remove_trivial_phis(function);
+}
@@ -0,0 +1,184 @@
+#include <iostream>
+#include <vector>
+#include <set>
+
+#include "syntax.hpp"
+#include "semantic.hpp"
+#include "optimization.hpp"
+#include "ControlFlowGraph.hpp"
+#include "Liveness.hpp"
+
+#include "DeadCodeEliminator.hpp"
+
+using namespace std;
+using namespace semantic;
+using namespace optimization;
+
+DeadCodeEliminator::DeadCodeEliminator(Program& program, SymbolTable& symb_table, Options& options):
+    program(program), symb_table(symb_table), options(options)
+{}
+
+void DeadCodeEliminator::report(const string& message) {
+    if (options.report)
+        cout << "\t" << message << endl;
+}
+
+void DeadCodeEliminator::run() {
+    if (options.report)
+        cout << "Eliminação de código morto:" << endl;
+
+    // Remover uma atribuição pode tornar outras inúteis
+    while (remove_unreachable_commands() | remove_dead_assignments())
+        ;
+
+    remove_unused_functions();
+    remove_unused_variables();
+}
+
+bool DeadCodeEliminator::remove_unreachable_commands() {
+    ControlFlowGraph cfg(program);
+
+    vector<Command*> unreachable;
+    for (auto block : cfg.get_blocks()) {
+        if (block->is_reachable())
+            continue;
+        for (auto command : block->commands)
+            unreachable.push_back(command);
+    }
+
+    for (auto command : unreachable) {
+        report(command->label + ": comando inalcançável removido");
+        program.remove(command);
+    }
+
+    return !unreachable.empty();
+}
+
+bool DeadCodeEliminator::remove_dead_assignments() {
+    ControlFlowGraph cfg(program);
+    Liveness liveness(program, cfg, symb_table);
+
+    vector<Command*> dead;
+    for (auto command : program.commands) {
+        const VarSet& live = liveness.live_out(command);
+
+        if (command->kind == Command::ASSIGN) {
+            if (!live.count(liveness.declaration(command->variable))) {
+                report(command->label + ": atribuição a '" + command->variable->get_identifier() + "' sem uso removida");
+                dead.push_back(command);
+            }
+        }
+        else if (command->kind == Command::READ) {
+            auto& read_data = command->read_data;
+            for (int i = read_data.size() - 1; i >= 0; i--) {
+                syntax::Var* decl = liveness.declaration(read_data[i].first);
+                if (live.count(decl))
+                    continue;
+
+                // Índices das leituras seguintes podem depender desta
+                VarSet later;
+                for (int j = i + 1; j < read_data.size(); j++) {
+                    if (read_data[j].first->is_array())
+                        liveness.expression_uses(dynamic_cast<syntax::ArrayAccess*>(read_data[j].first)->get_processed_access_exps(), later);
+                }
+                if (later.count(decl))
+                    continue;
+
+                report(command->label + ": leitura de '" + read_data[i].first->get_identifier() + "' sem uso removida");
+                read_data.erase(read_data.begin() + i);
+            }
+
+            if (read_data.empty())
+                dead.push_back(command);
+        }
+    }
+
+    for (auto command : dead)
+        program.remove(command);
+
+    return !dead.empty();
+}
+
+static void called_functions(const vector<syntax::Elem*>& exp, set<string>& called) {
+    for (auto e : exp) {
+        if (e->get_elem_type() == syntax::Elem::FUN)
+            called.insert(dynamic_cast<syntax::Call*>(e)->get_identifier());
+    }
+}
+
+void DeadCodeEliminator::remove_unused_functions() {
+    set<string> called;
+    for (auto command : program.commands) {
+        if (command->kind == Command::DEF)
+            continue;
+        for (auto& exp : command->exps)
+            called_functions(exp, called);
+        for (auto pair : command->read_data) {
+            if (pair.first->is_array())
+                called_functions(dynamic_cast<syntax::ArrayAccess*>(pair.first)->get_processed_access_exps(), called);
+        }
+    }
+
+    // Funções chamadas apenas por outras funções
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (auto command : program.commands) {
+            if (command->kind == Command::DEF && called.count(command->label)) {
+                int before = called.size();
+                called_functions(command->exps[0], called);
+                changed |= called.size() != before;
+            }
+        }
+    }
+
+    vector<Command*> unused;
+    for (auto command : program.commands) {
+        if (command->kind == Command::DEF && !called.count(command->label))
+            unused.push_back(command);
+    }
+
+    for (auto command : unused) {
+        report("função '" + command->label + "' nunca chamada removida");
+        program.remove(command);
+    }
+}
+
+void DeadCodeEliminator::remove_unused_variables() {
+    set<string> referenced;
+
+    auto reference_exp = [&referenced](const vector<syntax::Elem*>& exp) {
+        for (auto e : exp) {
+            if (e->get_elem_type() == syntax::Elem::VAR)
+                referenced.insert(dynamic_cast<syntax::Var*>(e)->get_identifier());
+        }
+    };
+
+    for (auto command : program.commands) {
+        if (command->variable)
+            referenced.insert(command->variable->get_identifier());
+
+        for (auto& exp : command->exps)
+            reference_exp(exp);
+
+        for (auto pair : command->read_data) {
+            referenced.insert(pair.first->get_identifier());
+            if (pair.first->is_array())
+                reference_exp(dynamic_cast<syntax::ArrayAccess*>(pair.first)->get_processed_access_exps());
+        }
+
+        if (command->kind == Command::DEF) {
+            for (auto param : dynamic_cast<syntax::Def*>(command->statement)->get_parameters())
+                referenced.insert(param->get_identifier());
+        }
+    }
+
+    // As de program.observed ficam, ainda que nenhum comando reste
+    for (auto var : symb_table.get_variables()) {
+        if (referenced.count(var->get_identifier()) || program.observed.count(var))
+            continue;
+
+        report("variável '" + var->get_identifier() + "' sem uso removida");
+        symb_table.remove_variable(var);
+    }
+}
@@ -0,0 +1,263 @@
+#include <iostream>
+#include <string>
+#include <vector>
+#include <map>
+
+#include "syntax.hpp"
+#include "optimization.hpp"
+
+#include "DeadStoreEliminator.hpp"
+
+using namespace std;
+using namespace optimization;
+
+DeadStoreEliminator::DeadStoreEliminator(IR& ir, Options& options):
+    ir(ir), options(options)
+{}
+
+void DeadStoreEliminator::report(const string& message) {
+    if (options.report)
+        cout << "\t" << message << endl;
+}
+
+void DeadStoreEliminator::run() {
+    if (options.report)
+        cout << "Eliminação de escritas mortas:" << endl;
+
+    for (auto block : ir.main->blocks) {
+        for (auto instruction : block->instructions) {
+            if (instruction->op == IRInstruction::PUT || instruction->op == IRInstruction::GET)
+                variables.insert(instruction->variable);
+        }
+    }
+
+    remove_redundant_puts(ir.main);
+    compute_liveness(ir.main);
+    remove_dead_puts(ir.main);
+
+    remove_dead_values(ir.main);
+    for (auto function : ir.functions)
+        remove_dead_values(function);
+}
+
+// Efeito de uma instrução, de trás para frente, sobre as variáveis a ler
+void DeadStoreEliminator::transfer(IRInstruction* instruction, MemorySet& live) {
+    switch (instruction->op) {
+        case IRInstruction::PUT:
+            live.erase(instruction->variable);
+            break;
+        case IRInstruction::GET:
+            live.insert(instruction->variable);
+            break;
+        case IRInstruction::CALL: {
+            const MemorySet& used = function_reads(instruction->function);
+            live.insert(used.begin(), used.end());
+            if (has_side_effects(instruction))
+                live = variables;
+            break;
+        }
+        case IRInstruction::LOAD:
+        case IRInstruction::STORE:
+            // Índice fora do vetor encerra o programa no estado atual
+            if (instruction->checked)
+                live = variables;
+            break;
+        case IRInstruction::HALT:
+            live = variables;
+            break;
+        default:
+            break;
+    }
+}
+
+/*
+ * Análise regressiva até o ponto fixo. GOSUB segue para a sub-rotina e
+ * RETURN para os retornos, como no grafo de fluxo.
+ */
+void DeadStoreEliminator::compute_liveness(IRFunction* function) {
+    map<IRBlock*, MemorySet> live_in;
+
+    bool changed = true;
+    while (changed) {
+        changed = false;
+
+        for (auto it = function->blocks.rbegin(); it != function->blocks.rend(); it++) {
+            IRBlock* block = *it;
+
+            MemorySet live;
+            for (auto succ : block->successors)
+                live.insert(live_in[succ].begin(), live_in[succ].end());
+            live_out[block] = live;
+
+            for (auto i = block->instructions.rbegin(); i != block->instructions.rend(); i++)
+                transfer(*i, live);
+
+            if (live != live_in[block]) {
+                live_in[block] = live;
+                changed = true;
+            }
+        }
+    }
+}
+
+void DeadStoreEliminator::remove_dead_puts(IRFunction* function) {
+    for (auto block : function->blocks) {
+        MemorySet live = live_out[block];
+        auto& instructions = block->instructions;
+
+        for (int i = instructions.size() - 1; i >= 0; i--) {
+            IRInstruction* instruction = instructions[i];
+
+            if (instruction->op == IRInstruction::PUT && !live.count(instruction->variable)) {
+                report(block->label + ": escrita de '" + instruction->variable->get_identifier() + "' sobrescrita antes de ser lida");
+                instructions.erase(instructions.begin() + i);
+                delete instruction;
+                continue;
+            }
+
+            transfer(instruction, live);
+        }
+    }
+}
+
+// Escrita do valor que a memória já contém, lido ou escrito antes no bloco
+void DeadStoreEliminator::remove_redundant_puts(IRFunction* function) {
+    for (auto block : function->blocks) {
+        map<syntax::Var*, IRValue*> memory;
+        auto& instructions = block->instructions;
+
+        for (int i = 0; i < instructions.size(); i++) {
+            IRInstruction* instruction = instructions[i];
+
+            if (instruction->op == IRInstruction::GET) {
+                memory[instruction->variable] = instruction->result;
+            }
+            else if (instruction->op == IRInstruction::PUT) {
+                if (memory[instruction->variable] == instruction->operands[0]) {
+                    report(block->label + ": escrita de '" + instruction->variable->get_identifier() + "' repete o valor da memória");
+                    instructions.erase(instructions.begin() + i);
+                    delete instruction;
+                    i--;
+                    continue;
+                }
+                memory[instruction->variable] = instruction->operands[0];
+            }
+        }
+    }
+}
+
+/*
+ * Instruções sem efeito cujo resultado não é usado; remover uma pode
+ * deixar sem uso os valores que ela lia
+ */
+void DeadStoreEliminator::remove_dead_values(IRFunction* function) {
+    map<IRValue*, int> uses;
+    for (auto block : function->blocks) {
+        for (auto instruction : block->instructions) {
+            for (auto operand : instruction->operands)
+                uses[operand]++;
+        }
+    }
+
+    bool changed = true;
+    while (changed) {
+        changed = false;
+
+        for (auto block : function->blocks) {
+            auto& instructions = block->instructions;
+
+            for (int i = 0; i < instructions.size(); i++) {
+                IRInstruction* instruction = instructions[i];
+                if (instruction->result == nullptr || uses[instruction->result] > 0 || has_side_effects(instruction))
+                    continue;
+
+                report(block->label + ": valor " + instruction->result->name() + " não usado");
+                for (auto operand : instruction->operands)
+                    uses[operand]--;
+                instructions.erase(instructions.begin() + i);
+                delete instruction;
+                i--;
+                changed = true;
+            }
+        }
+    }
+}
+
+/*
+ * Além das escritas e desvios, têm efeito o acesso a vetor verificado,
+ * que pode interromper a execução, e as chamadas de funções que o fazem
+ */
+bool DeadStoreEliminator::has_side_effects(IRInstruction* instruction) {
+    switch (instruction->op) {
+        case IRInstruction::LOAD:
+            return instruction->checked;
+        case IRInstruction::CALL: {
+            auto it = effects.find(instruction->function);
+            if (it != effects.end())
+                return it->second;
+
+            // Funções não são recursivas; a marca evita laço em caso de erro
+            effects[instruction->function] = false;
+            bool effect = false;
+            IRFunction* function = function_named(instruction->function);
+            for (auto block : function ? function->blocks : vector<IRBlock*>()) {
+                for (auto i : block->instructions) {
+                    if (i->op != IRInstruction::RET && has_side_effects(i))
+                        effect = true;
+                }
+            }
+            return effects[instruction->function] = effect;
+        }
+        case IRInstruction::ADD:
+        case IRInstruction::SUB:
+        case IRInstruction::MUL:
+        case IRInstruction::DIV:
+        case IRInstruction::POW:
+        case IRInstruction::COPY:
+        case IRInstruction::PHI:
+        case IRInstruction::GET:
+        case IRInstruction::READ:
+            return false;
+        default:
+            return true;
+    }
+}
+
+// Variáveis globais lidas pela função e pelas que ela chama
+const MemorySet& DeadStoreEliminator::function_reads(const string& name) {
+    auto it = reads.find(name);
+    if (it != reads.end())
+        return it->second;
+
+    reads[name] = MemorySet();
+    MemorySet used;
+
+    IRFunction* function = function_named(name);
+    for (auto block : function ? function->blocks : vector<IRBlock*>()) {
+        for (auto instruction : block->instructions) {
+            if (instruction->op == IRInstruction::GET) {
+                used.insert(instruction->variable);
+            }
+            else if (instruction->op == IRInstruction::CALL) {
+                const MemorySet& called = function_reads(instruction->function);
+                used.insert(called.begin(), called.end());
+            }
+        }
+    }
+
+    // Os parâmetros são escritos pela própria chamada
+    if (function) {
+        for (auto param : function->parameters)
+            used.erase(param);
+    }
+
+    return reads[name] = used;
+}
+
+IRFunction* DeadStoreEliminator::function_named(const string& name) {
+    for (auto function : ir.functions) {
+        if (function->name == name)
+            return function;
+    }
+    return nullptr;
+}
@@ -0,0 +1,358 @@
+#include <iostream>
+#include <string>
+#include <vector>
+#include <algorithm>
+
+#include "syntax.hpp"
+
+#include "IR.hpp"
+
+using namespace std;
+using namespace optimization;
+
+string IRValue::name() {
+    switch (kind) {
+        case CONSTANT:
+            return to_string(id);
+        case VARIABLE:
+            return variable->get_identifier() + "." + to_string(version);
+        case TEMPORARY:
+            return "%" + to_string(id);
+    }
+    return "";
+}
+
+static string condition_name(syntax::If::cmp condition) {
+    switch (condition) {
+        case syntax::If::EQL: return "eq";
+        case syntax::If::NEQ: return "ne";
+        case syntax::If::GTN: return "gt";
+        case syntax::If::LTN: return "lt";
+        case syntax::If::GEQ: return "ge";
+        case syntax::If::LEQ: return "le";
+    }
+    return "";
+}
+
+void IRInstruction::print(ostream& out) {
+    static const char* arithmetic[] = { "add", "sub", "mul", "div", "pow" };
+
+    auto list = [this]() {
+        string s;
+        for (int i = 0; i < operands.size(); i++)
+            s += (i > 0 ? ", " : "") + operands[i]->name();
+        return s;
+    };
+
+    out << "\t";
+    if (result)
+        out << result->name() << " = ";
+
+    switch (op) {
+        case ADD:
+        case SUB:
+        case MUL:
+        case DIV:
+        case POW:
+            out << arithmetic[op] << " i32 " << operands[0]->name() << ", " << operands[1]->name();
+            break;
+        case COPY:
+            out << "copy i32 " << operands[0]->name();
+            break;
+        case PHI:
+            out << "phi i32 ";
+            for (int i = 0; i < operands.size(); i++)
+                out << (i > 0 ? ", " : "") << "[" << operands[i]->name() << ", " << blocks[i]->label << "]";
+            break;
+        case GET:
+            out << "get i32 " << variable->get_identifier();
+            break;
+        case PUT:
+            out << "put " << variable->get_identifier() << ", " << operands[0]->name();
+            break;
+        case LOAD:
+            out << "load i32 " << variable->get_identifier() << "[" << operands[0]->name() << "]";
+            break;
+        case STORE:
+            out << "store " << variable->get_identifier() << "[" << operands[0]->name() << "], " << operands[1]->name();
+            break;
+        case READ:
+            out << "read i32 data[" << data << "]";
+            break;
+        case CALL:
+            out << "call i32 " << function << "(" << list() << ")";
+            break;
+        case PRINT:
+            out << "print " << list();
+            break;
+        case JUMP:
+            out << "jump " << blocks[0]->label;
+            break;
+        case BRANCH:
+            out << "br " << condition_name(condition) << " " << list() << ", " << blocks[0]->label << ", " << blocks[1]->label;
+            break;
+        case GOSUB:
+            out << "gosub " << blocks[0]->label;
+            if (blocks[1])
+                out << ", " << blocks[1]->label;
+            break;
+        case RETURN:
+            out << "return";
+            break;
+        case HALT:
+            out << "halt";
+            break;
+        case RET:
+            out << "ret " << operands[0]->name();
+            break;
+    }
+
+    if (checked)
+        out << " verificado";
+    out << endl;
+}
+
+IR::~IR() {
+    delete main;
+    for (auto function : functions)
+        delete function;
+    for (auto value : values)
+        delete value;
+}
+
+IRValue* IR::constant(int value) {
+    auto it = constants.find(value);
+    if (it != constants.end())
+        return it->second;
+
+    IRValue* constant = new IRValue(IRValue::CONSTANT, value);
+    values.push_back(constant);
+    return constants[value] = constant;
+}
+
+IRValue* IR::temporary() {
+    IRValue* temporary = new IRValue(IRValue::TEMPORARY, ++temporaries);
+    values.push_back(temporary);
+    return temporary;
+}
+
+// Nova versão da variável simples, numerada a partir de 1
+IRValue* IR::version(syntax::Var* var) {
+    IRValue* value = new IRValue(IRValue::VARIABLE, values.size());
+    value->variable = var;
+    value->version = ++versions[var->get_identifier()];
+    values.push_back(value);
+    return value;
+}
+
+void IR::replace_uses(IRFunction* function, IRValue* from, IRValue* to) {
+    for (auto block : function->blocks) {
+        for (auto instruction : block->instructions)
+            replace(instruction->operands.begin(), instruction->operands.end(), from, to);
+    }
+}
+
+/*
+ * Phi cujos operandos são todos um mesmo valor (ou a própria phi) é
+ * substituída por esse valor; a troca pode tornar outras phi triviais.
+ */
+void IR::remove_trivial_phis(IRFunction* function) {
+    bool changed = true;
+
+    while (changed) {
+        changed = false;
+
+        for (auto block : function->blocks) {
+            for (int i = 0; i < block->instructions.size(); i++) {
+                IRInstruction* phi = block->instructions[i];
+                if (phi->op != IRInstruction::PHI)
+                    continue;
+
+                IRValue* same = nullptr;
+                bool trivial = true;
+                for (auto operand : phi->operands) {
+                    if (operand == same || operand == phi->result)
+                        continue;
+                    if (same != nullptr) {
+                        trivial = false;
+                        break;
+                    }
+                    same = operand;
+                }
+                if (!trivial)
+                    continue;
+
+                replace_uses(function, phi->result, same ? same : constant(0));
+                block->instructions.erase(block->instructions.begin() + i);
+                delete phi;
+                i--;
+                changed = true;
+            }
+        }
+    }
+}
+
+/*
+ * Saída da forma SSA: cada função phi vira uma cópia no fim de cada
+ * predecessor. As arestas críticas que chegam a blocos com phi são
+ * divididas antes, para que a cópia não seja executada no outro caminho.
+ */
+void IR::leave_ssa() {
+    vector<IRFunction*> all = functions;
+    all.push_back(main);
+
+    for (auto function : all) {
+        split_critical_edges(function);
+        eliminate_phis(function);
+    }
+}
+
+void IR::split_critical_edges(IRFunction* function) {
+    for (int b = 0; b < function->blocks.size(); b++) {
+        IRBlock* block = function->blocks[b];
+        if (block->instructions.empty() || block->instructions[0]->op != IRInstruction::PHI)
+            continue;
+        if (block->predecessors.size() < 2)
+            continue;
+
+        for (auto& pred : block->predecessors) {
+            if (pred->successors.size() < 2)
+                continue;
+
+            // Bloco novo entre pred e block, emitido logo antes de block
+            IRBlock* edge = new IRBlock(pred->label + "." + block->label);
+            IRInstruction* jump = new IRInstruction(IRInstruction::JUMP);
+            jump->blocks.push_back(block);
+            edge->instructions.push_back(jump);
+            edge->predecessors.push_back(pred);
+            edge->successors.push_back(block);
+
+            replace(pred->terminator()->blocks.begin(), pred->terminator()->blocks.end(), block, edge);
+            replace(pred->successors.begin(), pred->successors.end(), block, edge);
+            for (auto instruction : block->instructions) {
+                if (instruction->op == IRInstruction::PHI)
+                    replace(instruction->blocks.begin(), instruction->blocks.end(), pred, edge);
+            }
+
+            pred = edge;
+            function->blocks.insert(function->blocks.begin() + b, edge);
+            b++;
+        }
+    }
+}
+
+void IR::eliminate_phis(IRFunction* function) {
+    for (auto block : function->blocks) {
+        vector<IRInstruction*> phis;
+        while (!block->instructions.empty() && block->instructions[0]->op == IRInstruction::PHI) {
+            phis.push_back(block->instructions[0]);
+            block->instructions.erase(block->instructions.begin());
+        }
+        if (phis.empty())
+            continue;
+
+        for (auto pred : block->predecessors) {
+            vector<pair<IRValue*, IRValue*>> copies;
+            for (auto phi : phis) {
+                for (int i = 0; i < phi->blocks.size(); i++) {
+                    if (phi->blocks[i] == pred)
+                        copies.push_back(make_pair(phi->result, phi->operands[i]));
+                }
+            }
+
+            vector<IRInstruction*> sequence;
+            sequentialize(copies, sequence);
+            pred->instructions.insert(pred->instructions.end() - 1, sequence.begin(), sequence.end());
+        }
+
+        for (auto phi : phis)
+            delete phi;
+    }
+}
+
+/*
+ * As cópias de um mesmo predecessor acontecem em paralelo: uma cópia só
+ * é emitida quando nenhuma outra pendente ainda lê o seu destino. Num
+ * ciclo (troca de valores entre versões), o destino é salvo antes num
+ * temporário.
+ */
+void IR::sequentialize(vector<pair<IRValue*, IRValue*>>& copies, vector<IRInstruction*>& sequence) {
+    auto emit = [&sequence](IRValue* destination, IRValue* source) {
+        IRInstruction* copy = new IRInstruction(IRInstruction::COPY);
+        copy->result = destination;
+        copy->operands.push_back(source);
+        sequence.push_back(copy);
+    };
+
+    copies.erase(remove_if(copies.begin(), copies.end(), [](const pair<IRValue*, IRValue*>& c) {
+        return c.first == c.second;
+    }), copies.end());
+
+    while (!copies.empty()) {
+        bool emitted = false;
+
+        for (int i = 0; i < copies.size(); i++) {
+            IRValue* destination = copies[i].first;
+            bool read = false;
+            for (int j = 0; j < copies.size(); j++) {
+                if (j != i && copies[j].second == destination)
+                    read = true;
+            }
+
+            if (!read) {
+                emit(destination, copies[i].second);
+                copies.erase(copies.begin() + i);
+                emitted = true;
+                break;
+            }
+        }
+
+        if (!emitted) {
+            IRValue* destination = copies[0].first;
+            IRValue* saved = temporary();
+            emit(saved, destination);
+            for (auto& c : copies) {
+                if (c.second == destination)
+                    c.second = saved;
+            }
+        }
+    }
+}
+
+void IR::print(ostream& out) {
+    auto print_function = [&out](IRFunction* function) {
+        for (auto block : function->blocks) {
+            out << block->label << ":";
+            if (!block->predecessors.empty()) {
+                out << "\t\t; predecessores:";
+                for (auto pred : block->predecessors)
+                    out << " " << pred->label;
+            }
+            if (block->memory)
+                out << " (memória)";
+            out << endl;
+
+            for (auto instruction : block->instructions)
+                instruction->print(out);
+        }
+        out << endl;
+    };
+
+    out << "Programa principal:" << endl;
+    print_function(main);
+
+    for (auto function : functions) {
+        out << "Função " << function->name << "(";
+        for (int i = 0; i < function->parameters.size(); i++)
+            out << (i > 0 ? ", " : "") << function->parameters[i]->get_identifier();
+        out << "):" << endl;
+        print_function(function);
+    }
+
+    if (!data.empty()) {
+        out << "Tabela de DATA:";
+        for (auto value : data)
+            out << " " << value;
+        out << endl;
+    }
+}
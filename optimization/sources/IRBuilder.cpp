@@ -0,0 +1,535 @@
+#include <vector>
+#include <algorithm>
+
+#include "syntax.hpp"
+#include "semantic.hpp"
+#include "optimization.hpp"
+
+#include "IRBuilder.hpp"
+
+using namespace std;
+using namespace semantic;
+using namespace optimization;
+
+IRBuilder::IRBuilder(Program& program, SymbolTable& symb_table, Options& options, IR& ir):
+    program(program), symb_table(symb_table), options(options), ir(ir)
+{}
+
+void IRBuilder::run() {
+    // Cada leitura, resolvida em compilação, tem sua posição na tabela de DATA
+    for (auto command : program.commands) {
+        if (command->kind != Command::READ)
+            continue;
+        data_position[command] = ir.data.size();
+        for (auto pair : command->read_data)
+            ir.data.push_back(pair.second->get_value());
+    }
+
+    // Variáveis simples do programa escritas pelo programa principal; os
+    // temporários das otimizações não fazem parte do estado final
+    set<syntax::Var*> assigned;
+    for (auto command : program.commands) {
+        if (command->kind == Command::ASSIGN || command->kind == Command::FOR || command->kind == Command::NEXT)
+            assigned.insert(declaration(command->variable));
+        for (auto pair : command->read_data) {
+            if (!pair.first->is_array())
+                assigned.insert(declaration(pair.first));
+        }
+    }
+    for (auto var : symb_table.get_variables()) {
+        if (assigned.count(var) && !program.is_temporary(var))
+            written.push_back(var);
+    }
+
+    build_main();
+
+    for (auto command : program.commands) {
+        if (command->kind == Command::DEF)
+            build_function(command);
+    }
+}
+
+/*
+ * Os blocos são traduzidos em pós-ordem reversa; um bloco é selado
+ * quando todos os seus predecessores já foram traduzidos, e só então as
+ * funções phi criadas nele recebem seus operandos. A entrada sintética
+ * "main" define o valor inicial 0 de todas as variáveis.
+ */
+void IRBuilder::build_main() {
+    ControlFlowGraph graph(program);
+    cfg = &graph;
+
+    function = ir.main = new IRFunction("main");
+    IRBlock* entry = new IRBlock("main");
+    function->blocks.push_back(entry);
+    sealed.insert(entry);
+
+    // Sub-rotinas e retornos de GOSUB encontram as variáveis na memória
+    set<Command*> memory;
+    for (auto command : program.commands) {
+        if (command->kind == Command::GOSUB) {
+            memory.insert(command->target);
+            memory.insert(command->next);
+        }
+    }
+
+    auto link = [](IRBlock* from, IRBlock* to) {
+        from->successors.push_back(to);
+        to->predecessors.push_back(from);
+    };
+
+    // O grafo de fluxo junta ao GOSUB a sub-rotina e o retorno quando são
+    // sucessores únicos; aqui eles sempre começam um bloco próprio
+    for (auto block : cfg->get_blocks()) {
+        if (!block->is_reachable())
+            continue;
+
+        IRBlock* piece = nullptr;
+        for (auto command : block->commands) {
+            if (piece == nullptr || memory.count(command)) {
+                IRBlock* previous = piece;
+                piece = new IRBlock(command->label);
+                piece->memory = memory.count(command);
+                function->blocks.push_back(piece);
+                if (previous)
+                    link(previous, piece);
+            }
+            blocks[command] = piece;
+        }
+    }
+
+    for (auto block : cfg->get_blocks()) {
+        if (!block->is_reachable())
+            continue;
+        for (auto succ : block->successors)
+            link(blocks[block->last()], blocks[succ->first()]);
+    }
+
+    current = entry;
+    if (cfg->get_entry() == nullptr) {
+        emit(IRInstruction::HALT)->label = entry->label;
+        cfg = nullptr;
+        return;
+    }
+
+    IRBlock* first = blocks[cfg->get_entry()->first()];
+    entry->successors.push_back(first);
+    first->predecessors.insert(first->predecessors.begin(), entry);
+    jump(first);
+    filled.insert(entry);
+
+    auto ready = [this](IRBlock* block) {
+        for (auto pred : block->predecessors) {
+            if (!filled.count(pred))
+                return false;
+        }
+        return true;
+    };
+
+    auto start = [this, &ready](IRBlock* block) {
+        current = block;
+        if (!sealed.count(current) && ready(current))
+            seal(current);
+    };
+
+    auto finish = [this, &ready]() {
+        filled.insert(current);
+        for (auto succ : current->successors) {
+            if (!sealed.count(succ) && ready(succ))
+                seal(succ);
+        }
+    };
+
+    for (auto block : cfg->reverse_postorder()) {
+        auto& commands = block->commands;
+        start(blocks[commands[0]]);
+
+        for (int i = 0; i < commands.size(); i++) {
+            if (blocks[commands[i]] != current) {
+                finish();
+                start(blocks[commands[i]]);
+            }
+            translate(commands[i], i + 1 == commands.size() || blocks[commands[i + 1]] != current);
+        }
+        finish();
+    }
+
+    ir.remove_trivial_phis(function);
+    cfg = nullptr;
+}
+
+// Corpo de função: um único bloco, com variáveis e parâmetros lidos da memória
+void IRBuilder::build_function(Command* def) {
+    function = new IRFunction(def->label);
+    for (auto param : dynamic_cast<syntax::Def*>(def->statement)->get_parameters())
+        function->parameters.push_back(declaration(param));
+    ir.functions.push_back(function);
+
+    current = new IRBlock(def->label);
+    current->memory = true;
+    function->blocks.push_back(current);
+    sealed.insert(current);
+
+    IRValue* value = expression(def->exps[0]);
+    emit(IRInstruction::RET)->operands.push_back(value);
+    filled.insert(current);
+}
+
+/*
+ * Somente o último comando do bloco emite o desvio para o sucessor; os
+ * demais seguem para o próximo comando, que está no mesmo bloco.
+ */
+void IRBuilder::translate(Command* command, bool last) {
+    switch (command->kind) {
+        case Command::ASSIGN:
+        case Command::FOR: {
+            IRValue* value = expression(command->exps[0]);
+            IRInstruction* definition = current->instructions.empty() ? nullptr : current->instructions.back();
+            syntax::Var* var = declaration(command->variable);
+
+            // Temporário recém-calculado vira a nova versão da variável
+            if (value->kind == IRValue::TEMPORARY && definition && definition->result == value) {
+                definition->result = ir.version(var);
+                value = definition->result;
+            }
+            else {
+                IRInstruction* copy = emit(IRInstruction::COPY, ir.version(var));
+                copy->operands.push_back(value);
+                value = copy->result;
+            }
+
+            define(var, value);
+            if (last)
+                jump(block_of(command->next));
+            break;
+        }
+        case Command::READ: {
+            // Variáveis simples lidas primeiro, em posições seguidas da
+            // tabela; o elemento de vetor é lido junto da sua escrita, para
+            // não ocupar um registrador até lá
+            vector<IRValue*> values;
+            for (int i = 0; i < command->read_data.size(); i++) {
+                syntax::Var* var = command->read_data[i].first;
+                IRValue* result = nullptr;
+                if (!var->is_array()) {
+                    result = ir.version(declaration(var));
+                    emit(IRInstruction::READ, result)->data = data_position[command] + i;
+                }
+                values.push_back(result);
+            }
+
+            for (int i = 0; i < command->read_data.size(); i++) {
+                syntax::Var* var = command->read_data[i].first;
+                if (!var->is_array()) {
+                    define(declaration(var), values[i]);
+                    continue;
+                }
+
+                syntax::ArrayAccess* access = dynamic_cast<syntax::ArrayAccess*>(var);
+                IRValue* index = expression(access->get_processed_access_exps());
+                IRValue* value = ir.temporary();
+                emit(IRInstruction::READ, value)->data = data_position[command] + i;
+                IRInstruction* store = emit(IRInstruction::STORE);
+                store->variable = declaration(access);
+                store->operands.push_back(index);
+                store->operands.push_back(value);
+                store->checked = options.bounds_check && !program.in_bounds.count(access);
+            }
+
+            if (last)
+                jump(block_of(command->next));
+            break;
+        }
+        case Command::PRINT: {
+            vector<IRValue*> items;
+            for (auto& exp : command->exps)
+                items.push_back(expression(exp));
+            emit(IRInstruction::PRINT)->operands = items;
+
+            if (last)
+                jump(block_of(command->next));
+            break;
+        }
+        case Command::GOTO:
+            if (last)
+                jump(block_of(command->target));
+            break;
+        case Command::IF: {
+            // Sem expressões quando os dois destinos já eram iguais
+            if (command->exps.empty() || command->target == command->next) {
+                for (auto& exp : command->exps)
+                    expression(exp);
+                if (last)
+                    jump(block_of(command->next));
+                break;
+            }
+
+            IRValue* left = expression(command->exps[0]);
+            IRValue* right = expression(command->exps[1]);
+            IRInstruction* branch = emit(IRInstruction::BRANCH);
+            branch->operands.push_back(left);
+            branch->operands.push_back(right);
+            branch->condition = dynamic_cast<syntax::If*>(command->statement)->get_op();
+            branch->blocks.push_back(block_of(command->target));
+            branch->blocks.push_back(block_of(command->next));
+            break;
+        }
+        case Command::COMP: {
+            IRValue* left = read_variable(command->variable, current);
+            IRValue* right = expression(command->exps[0]);
+            if (command->target == command->next) {
+                if (last)
+                    jump(block_of(command->next));
+                break;
+            }
+
+            IRInstruction* branch = emit(IRInstruction::BRANCH);
+            branch->operands.push_back(left);
+            branch->operands.push_back(right);
+            branch->condition = syntax::If::GEQ;
+            branch->blocks.push_back(block_of(command->target));
+            branch->blocks.push_back(block_of(command->next));
+            break;
+        }
+        case Command::NEXT: {
+            syntax::Var* var = declaration(command->variable);
+            IRValue* left = read_variable(var, current);
+            IRValue* right = expression(command->exps[0]);
+            IRInstruction* add = emit(IRInstruction::ADD, ir.version(var));
+            add->operands.push_back(left);
+            add->operands.push_back(right);
+            define(var, add->result);
+
+            if (last)
+                jump(block_of(command->target));
+            break;
+        }
+        case Command::GOSUB: {
+            IRInstruction* gosub = emit(IRInstruction::GOSUB);
+            gosub->blocks.push_back(block_of(command->target));
+            gosub->blocks.push_back(block_of(command->next));
+            break;
+        }
+        case Command::RETURN:
+            emit(IRInstruction::RETURN);
+            break;
+        case Command::END:
+            // O estado final das variáveis é o resultado visível do
+            // programa, lido no END também pela eliminação de código
+            // morto; escrito aqui, dispensa as escritas feitas antes que
+            // ninguém lê, removidas pelo DeadStoreEliminator. Exemplo em
+            // test/estado_final.bas
+            if (options.optimize) {
+                for (auto var : written) {
+                    IRInstruction* put = emit(IRInstruction::PUT);
+                    put->variable = var;
+                    put->operands.push_back(read_variable(var, current));
+                }
+            }
+            emit(IRInstruction::HALT)->label = command->label;
+            break;
+        case Command::DEF:
+            break;
+    }
+}
+
+/*
+ * Monta a árvore da expressão pós-fixa e a numera como Sethi e Ullman:
+ * uma folha usa um registrador, e um operador usa o maior dos números
+ * dos operandos, ou um a mais se forem iguais. Uma chamada guarda os
+ * argumentos anteriores enquanto calcula cada um. Constantes não
+ * ocupam registrador.
+ */
+IRValue* IRBuilder::expression(const vector<syntax::Elem*>& exp) {
+    vector<ExpressionNode> nodes;
+    vector<int> stack;
+
+    for (auto e : exp) {
+        ExpressionNode node(e);
+
+        if (e->get_elem_type() == syntax::Elem::NUM) {
+            node.need = 0;
+        }
+        else if (e->get_elem_type() == syntax::Elem::VAR) {
+            node.need = 1;
+            if (dynamic_cast<syntax::Var*>(e)->is_array()) {
+                // Consome o índice linearizado
+                node.children.push_back(stack.back());
+                stack.pop_back();
+            }
+        }
+        else if (e->get_elem_type() == syntax::Elem::FUN) {
+            int args = dynamic_cast<syntax::Call*>(e)->get_args().size();
+            node.children.assign(stack.end() - args, stack.end());
+            stack.resize(stack.size() - args);
+            node.calls = true;
+            node.need = 1;
+            for (int a = 0; a < args; a++)
+                node.need = max(node.need, nodes[node.children[a]].need + a);
+        }
+        else if (e->is_operator()) {
+            node.children.assign(stack.end() - 2, stack.end());
+            stack.resize(stack.size() - 2);
+            int left = nodes[node.children[0]].need;
+            int right = nodes[node.children[1]].need;
+            node.need = (left == right) ? left + 1 : max(left, right);
+        }
+
+        for (auto child : node.children) {
+            node.calls |= nodes[child].calls;
+            node.need = max(node.need, nodes[child].need);
+        }
+
+        stack.push_back(nodes.size());
+        nodes.push_back(node);
+    }
+
+    return expression(nodes, stack.back());
+}
+
+/*
+ * Traduz o nó calculando antes o operando que usa mais registradores,
+ * para que o resultado do outro não fique guardado durante o cálculo.
+ * Com chamadas, a ordem da expressão é mantida: a função escreve os
+ * parâmetros, que podem ser lidos pelo outro operando.
+ */
+IRValue* IRBuilder::expression(vector<ExpressionNode>& nodes, int node) {
+    static const IRInstruction::opcode operators[] = {
+        IRInstruction::ADD, IRInstruction::SUB, IRInstruction::MUL, IRInstruction::DIV, IRInstruction::POW
+    };
+
+    syntax::Elem* e = nodes[node].elem;
+    vector<int>& children = nodes[node].children;
+
+    if (e->get_elem_type() == syntax::Elem::NUM)
+        return ir.constant(dynamic_cast<syntax::Num*>(e)->get_value());
+
+    if (e->get_elem_type() == syntax::Elem::VAR) {
+        syntax::Var* var = dynamic_cast<syntax::Var*>(e);
+        if (!var->is_array())
+            return read_variable(var, current);
+
+        syntax::ArrayAccess* access = dynamic_cast<syntax::ArrayAccess*>(var);
+        IRValue* index = expression(nodes, children[0]);
+        IRInstruction* load = emit(IRInstruction::LOAD, ir.temporary());
+        load->variable = declaration(access);
+        load->operands.push_back(index);
+        load->checked = options.bounds_check && !program.in_bounds.count(access);
+        return load->result;
+    }
+
+    if (e->get_elem_type() == syntax::Elem::FUN) {
+        vector<IRValue*> args;
+        for (auto child : children)
+            args.push_back(expression(nodes, child));
+
+        IRInstruction* call = emit(IRInstruction::CALL, ir.temporary());
+        call->function = dynamic_cast<syntax::Call*>(e)->get_identifier();
+        call->operands = args;
+        return call->result;
+    }
+
+    ExpressionNode& left = nodes[children[0]];
+    ExpressionNode& right = nodes[children[1]];
+    IRValue* operands[2];
+
+    if (right.need > left.need && !left.calls && !right.calls) {
+        operands[1] = expression(nodes, children[1]);
+        operands[0] = expression(nodes, children[0]);
+    }
+    else {
+        operands[0] = expression(nodes, children[0]);
+        operands[1] = expression(nodes, children[1]);
+    }
+
+    IRInstruction* instruction = emit(operators[e->get_elem_type() - syntax::Elem::ADD], ir.temporary());
+    instruction->operands.assign(operands, operands + 2);
+    return instruction->result;
+}
+
+IRInstruction* IRBuilder::emit(IRInstruction::opcode op, IRValue* result) {
+    IRInstruction* instruction = new IRInstruction(op);
+    instruction->result = result;
+    current->instructions.push_back(instruction);
+    return instruction;
+}
+
+void IRBuilder::jump(IRBlock* destination) {
+    emit(IRInstruction::JUMP)->blocks.push_back(destination);
+}
+
+// Nova versão da variável, escrita também na memória
+void IRBuilder::define(syntax::Var* var, IRValue* value) {
+    current_def[current][var] = value;
+
+    IRInstruction* put = emit(IRInstruction::PUT);
+    put->variable = var;
+    put->operands.push_back(value);
+}
+
+IRValue* IRBuilder::read_variable(syntax::Var* var, IRBlock* block) {
+    var = declaration(var);
+
+    auto it = current_def[block].find(var);
+    if (it != current_def[block].end())
+        return it->second;
+
+    return read_variable_recursive(var, block);
+}
+
+IRValue* IRBuilder::read_variable_recursive(syntax::Var* var, IRBlock* block) {
+    IRValue* value;
+
+    if (block->memory) {
+        IRInstruction* get = new IRInstruction(IRInstruction::GET);
+        get->result = value = ir.version(var);
+        get->variable = var;
+        block->instructions.insert(block->instructions.begin(), get);
+    }
+    else if (!sealed.count(block)) {
+        IRInstruction* phi = new IRInstruction(IRInstruction::PHI);
+        phi->result = value = ir.version(var);
+        block->instructions.insert(block->instructions.begin(), phi);
+        incomplete_phis[block][var] = phi;
+    }
+    else if (block->predecessors.size() == 1) {
+        value = read_variable(var, block->predecessors[0]);
+    }
+    else if (block->predecessors.empty()) {
+        value = ir.constant(0);
+    }
+    else {
+        IRInstruction* phi = new IRInstruction(IRInstruction::PHI);
+        phi->result = value = ir.version(var);
+        block->instructions.insert(block->instructions.begin(), phi);
+        // Definida antes dos operandos para interromper ciclos de laços
+        current_def[block][var] = value;
+        add_phi_operands(var, phi, block);
+    }
+
+    current_def[block][var] = value;
+    return value;
+}
+
+void IRBuilder::add_phi_operands(syntax::Var* var, IRInstruction* phi, IRBlock* block) {
+    for (auto pred : block->predecessors) {
+        phi->operands.push_back(read_variable(var, pred));
+        phi->blocks.push_back(pred);
+    }
+}
+
+void IRBuilder::seal(IRBlock* block) {
+    sealed.insert(block);
+    for (auto pair : incomplete_phis[block])
+        add_phi_operands(pair.first, pair.second, block);
+    incomplete_phis.erase(block);
+}
+
+IRBlock* IRBuilder::block_of(Command* command) {
+    auto it = blocks.find(command);
+    return it == blocks.end() ? nullptr : it->second;
+}
+
+syntax::Var* IRBuilder::declaration(syntax::Var* var) {
+    return symb_table.pointer_to_variable(var);
+}
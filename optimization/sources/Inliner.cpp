@@ -0,0 +1,184 @@
+#include <iostream>
+#include <vector>
+#include <string>
+#include <map>
+
+#include "syntax.hpp"
+#include "semantic.hpp"
+#include "optimization.hpp"
+
+#include "Inliner.hpp"
+
+using namespace std;
+using namespace semantic;
+using namespace optimization;
+
+Inliner::Inliner(Program& program, SymbolTable& symb_table, Options& options):
+    program(program), symb_table(symb_table), options(options)
+{}
+
+void Inliner::report(const string& message) {
+    if (options.report)
+        cout << "\t" << message << endl;
+}
+
+void Inliner::run() {
+    if (options.report)
+        cout << "Expansão de funções:" << endl;
+
+    for (auto command : program.commands) {
+        if (command->kind == Command::DEF)
+            functions[command->label] = command;
+    }
+
+    for (int round = 0; round < INLINE_ROUNDS; round++) {
+        calls.clear();
+        for (auto command : program.commands) {
+            for (auto& exp : command->exps) {
+                for (auto e : exp) {
+                    if (e->get_elem_type() == syntax::Elem::FUN)
+                        calls[dynamic_cast<syntax::Call*>(e)->get_identifier()]++;
+                }
+            }
+        }
+
+        bool changed = false;
+        vector<Command*> commands = program.commands;
+        for (auto command : commands) {
+            // Índices de READ dependem das leituras anteriores do mesmo comando
+            if (command->kind == Command::READ)
+                continue;
+
+            bool def = command->kind == Command::DEF;
+            inserted.clear();
+
+            for (auto& exp : command->exps)
+                changed |= expand(exp, def ? nullptr : command, def ? command->label : "");
+
+            for (auto assign : inserted)
+                program.insert_before(command, assign);
+        }
+
+        if (!changed)
+            break;
+    }
+}
+
+/*
+ * Expande as chamadas da expressão. Em corpos de função (command nulo)
+ * não há onde calcular argumentos antes, e a própria função (owner)
+ * nunca é expandida em seu corpo.
+ */
+bool Inliner::expand(vector<syntax::Elem*>& exp, Command* command, const string& owner) {
+    bool changed = false;
+    vector<int> starts;     // Início do trecho de cada operando na pilha
+
+    for (int i = 0; i < exp.size(); i++) {
+        syntax::Elem* e = exp[i];
+
+        if (e->get_elem_type() == syntax::Elem::NUM) {
+            starts.push_back(i);
+        }
+        else if (e->get_elem_type() == syntax::Elem::VAR) {
+            if (!dynamic_cast<syntax::Var*>(e)->is_array())
+                starts.push_back(i);
+        }
+        else if (e->is_operator()) {
+            starts.pop_back();
+        }
+        else if (e->get_elem_type() == syntax::Elem::FUN) {
+            syntax::Call* call = dynamic_cast<syntax::Call*>(e);
+            int n = call->get_args().size();
+            int start = n > 0 ? starts[starts.size() - n] : i;
+
+            vector<vector<syntax::Elem*>> args;
+            for (int a = starts.size() - n; a < starts.size(); a++) {
+                int end = (a + 1 < starts.size()) ? starts[a + 1] : i;
+                args.push_back(vector<syntax::Elem*>(exp.begin() + starts[a], exp.begin() + end));
+            }
+            starts.resize(starts.size() - n);
+            starts.push_back(start);
+
+            auto it = functions.find(call->get_identifier());
+            if (it == functions.end() || call->get_identifier() == owner)
+                continue;
+
+            vector<syntax::Elem*> body;
+            if (!substitute(it->second, args, command, body))
+                continue;
+
+            exp.erase(exp.begin() + start, exp.begin() + i + 1);
+            exp.insert(exp.begin() + start, body.begin(), body.end());
+            i = start + body.size() - 1;
+            changed = true;
+
+            report((command ? command->label : owner) + ": chamada de '" + call->get_identifier() + "' expandida");
+        }
+    }
+
+    return changed;
+}
+
+/*
+ * Corpo da função com os parâmetros trocados pelos argumentos; falso se
+ * o corpo expandido for grande demais ou se um argumento precisaria de
+ * temporário e não há comando onde calculá-lo.
+ */
+bool Inliner::substitute(Command* def, vector<vector<syntax::Elem*>>& args, Command* command, vector<syntax::Elem*>& body) {
+    vector<syntax::Var*> parameters = dynamic_cast<syntax::Def*>(def->statement)->get_parameters();
+    const vector<syntax::Elem*>& exp = def->exps[0];
+
+    // Parâmetro de cada elemento do corpo, -1 se não for parâmetro
+    vector<int> parameter(exp.size(), -1);
+    vector<int> uses(parameters.size(), 0);
+    for (int i = 0; i < exp.size(); i++) {
+        if (exp[i]->get_elem_type() != syntax::Elem::VAR)
+            continue;
+        for (int p = 0; p < parameters.size(); p++) {
+            if (parameters[p]->get_identifier() == dynamic_cast<syntax::Var*>(exp[i])->get_identifier()) {
+                parameter[i] = p;
+                uses[p]++;
+            }
+        }
+    }
+
+    vector<bool> temporary(parameters.size(), false);
+    int size = 0;
+    for (int p = 0; p < parameters.size(); p++) {
+        temporary[p] = args[p].size() > 1 && uses[p] > 1;
+        if (temporary[p] && command == nullptr)
+            return false;
+    }
+    for (int i = 0; i < exp.size(); i++) {
+        int p = parameter[i];
+        size += (p < 0 || temporary[p]) ? 1 : args[p].size();
+    }
+
+    if (size > INLINE_LIMIT && calls[def->label] > 1)
+        return false;
+
+    vector<vector<syntax::Elem*>> values = args;
+    for (int p = 0; p < parameters.size(); p++) {
+        if (!temporary[p])
+            continue;
+
+        syntax::Var* var = program.temporary();
+        symb_table.insert_variable(var);
+
+        Command* assign = new Command(Command::ASSIGN, command->statement, command->label + "." + var->get_identifier());
+        assign->variable = var;
+        assign->exps.push_back(args[p]);
+        inserted.push_back(assign);
+
+        values[p] = vector<syntax::Elem*>(1, var);
+    }
+
+    for (int i = 0; i < exp.size(); i++) {
+        if (parameter[i] >= 0)
+            body.insert(body.end(), values[parameter[i]].begin(), values[parameter[i]].end());
+        else
+            body.push_back(exp[i]);
+    }
+
+    return true;
+}
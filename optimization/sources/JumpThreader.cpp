@@ -0,0 +1,65 @@
+#include <iostream>
+#include <vector>
+#include <string>
+#include <set>
+
+#include "semantic.hpp"
+#include "optimization.hpp"
+
+#include "JumpThreader.hpp"
+
+using namespace std;
+using namespace semantic;
+using namespace optimization;
+
+JumpThreader::JumpThreader(Program& program, SymbolTable& symb_table, Options& options):
+    program(program), symb_table(symb_table), options(options)
+{}
+
+void JumpThreader::report(const string& message) {
+    if (options.report)
+        cout << "\t" << message << endl;
+}
+
+void JumpThreader::run() {
+    if (options.report)
+        cout << "Encadeamento de desvios:" << endl;
+
+    for (auto command : program.commands) {
+        if (command->kind == Command::DEF)
+            continue;
+
+        thread(command, command->next, "fluxo");
+        thread(command, command->target, "desvio");
+
+        // Condição que leva ao mesmo lugar nos dois casos não precisa ser avaliada
+        if (command->kind == Command::IF && command->target == command->next) {
+            command->kind = Command::GOTO;
+            command->exps.clear();
+            report(command->label + ": IF com destinos iguais trocado por GOTO");
+        }
+    }
+}
+
+// Primeiro comando que não é GOTO na cadeia que começa no comando
+Command* JumpThreader::destination(Command* command) {
+    set<Command*> visited;
+
+    while (command != nullptr && command->kind == Command::GOTO) {
+        // GOTOs em ciclo formam um laço infinito, que permanece
+        if (!visited.insert(command).second)
+            break;
+        command = command->target;
+    }
+
+    return command;
+}
+
+void JumpThreader::thread(Command* command, Command*& successor, const string& what) {
+    Command* end = destination(successor);
+    if (end == successor)
+        return;
+
+    report(command->label + ": " + what + " para " + successor->label + " levado direto a " + end->label);
+    successor = end;
+}
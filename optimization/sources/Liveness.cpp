@@ -0,0 +1,181 @@
+#include <vector>
+#include <string>
+
+#include "syntax.hpp"
+#include "semantic.hpp"
+
+#include "Liveness.hpp"
+
+using namespace std;
+using namespace semantic;
+using namespace optimization;
+
+Liveness::Liveness(Program& program, ControlFlowGraph& cfg, SymbolTable& symb_table):
+    program(program), cfg(cfg), symb_table(symb_table)
+{
+    compute();
+}
+
+const VarSet& Liveness::live_in(Command* command) {
+    return in[command];
+}
+
+const VarSet& Liveness::live_out(Command* command) {
+    return out[command];
+}
+
+syntax::Var* Liveness::declaration(syntax::Var* v) {
+    auto it = declarations.find(v);
+    if (it != declarations.end())
+        return it->second;
+
+    syntax::Var* decl = symb_table.pointer_to_variable(v);
+    declarations[v] = decl;
+    return decl;
+}
+
+void Liveness::expression_uses(const vector<syntax::Elem*>& exp, VarSet& uses) {
+    for (auto e : exp) {
+        if (e->get_elem_type() == syntax::Elem::VAR) {
+            uses.insert(declaration(dynamic_cast<syntax::Var*>(e)));
+        }
+        else if (e->get_elem_type() == syntax::Elem::FUN) {
+            const VarSet& fn = function_uses(dynamic_cast<syntax::Call*>(e)->get_identifier());
+            uses.insert(fn.begin(), fn.end());
+        }
+    }
+}
+
+/*
+ * Variáveis globais lidas pelo corpo da função. Os parâmetros são
+ * escritos pela própria chamada e não contam como leitura.
+ */
+const VarSet& Liveness::function_uses(const string& identifier) {
+    auto it = functions.find(identifier);
+    if (it != functions.end())
+        return it->second;
+
+    static VarSet none;
+    if (visiting.count(identifier))
+        return none;
+    visiting.insert(identifier);
+
+    VarSet uses;
+    for (auto command : program.commands) {
+        if (command->kind != Command::DEF || command->label != identifier)
+            continue;
+
+        expression_uses(command->exps[0], uses);
+        for (auto param : dynamic_cast<syntax::Def*>(command->statement)->get_parameters())
+            uses.erase(declaration(param));
+    }
+
+    visiting.erase(identifier);
+    return functions[identifier] = uses;
+}
+
+VarSet Liveness::uses(Command* command) {
+    VarSet uses;
+
+    for (auto& exp : command->exps)
+        expression_uses(exp, uses);
+
+    for (auto pair : command->read_data) {
+        if (pair.first->is_array())
+            expression_uses(dynamic_cast<syntax::ArrayAccess*>(pair.first)->get_processed_access_exps(), uses);
+    }
+
+    if (command->kind == Command::COMP || command->kind == Command::NEXT)
+        uses.insert(declaration(command->variable));
+
+    // O estado final é o resultado visível do programa
+    if (command->kind == Command::END)
+        uses.insert(program.observed.begin(), program.observed.end());
+
+    return uses;
+}
+
+VarSet Liveness::reads() {
+    VarSet reads;
+    for (auto command : program.commands) {
+        if (command->kind == Command::DEF)
+            continue;
+
+        VarSet read = uses(command);
+        reads.insert(read.begin(), read.end());
+    }
+    return reads;
+}
+
+VarSet Liveness::kills(Command* command) {
+    VarSet kills;
+
+    switch (command->kind) {
+        case Command::ASSIGN:
+        case Command::FOR:
+        case Command::NEXT:
+            kills.insert(declaration(command->variable));
+            break;
+        case Command::READ:
+            for (auto pair : command->read_data) {
+                if (!pair.first->is_array())
+                    kills.insert(declaration(pair.first));
+            }
+            break;
+        default:
+            break;
+    }
+
+    return kills;
+}
+
+VarSet Liveness::writes(Command* command) {
+    VarSet writes = kills(command);
+
+    for (auto pair : command->read_data)
+        writes.insert(declaration(pair.first));
+
+    return writes;
+}
+
+void Liveness::compute() {
+    vector<Command*> commands;
+    for (auto command : program.commands) {
+        if (command->kind != Command::DEF)
+            commands.push_back(command);
+    }
+
+    unordered_map<Command*, VarSet> use, kill;
+    for (auto command : commands) {
+        use[command] = uses(command);
+        kill[command] = kills(command);
+    }
+
+    // Análise regressiva até o ponto fixo; a ordem inversa do programa
+    // faz a maioria das informações propagar em uma só passada
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (auto it = commands.rbegin(); it != commands.rend(); ++it) {
+            Command* command = *it;
+
+            VarSet live;
+            for (auto succ : cfg.successors(command)) {
+                const VarSet& succ_in = in[succ];
+                live.insert(succ_in.begin(), succ_in.end());
+            }
+
+            VarSet live_in = use[command];
+            for (auto v : live) {
+                if (!kill[command].count(v))
+                    live_in.insert(v);
+            }
+
+            if (live != out[command] || live_in != in[command]) {
+                out[command] = live;
+                in[command] = live_in;
+                changed = true;
+            }
+        }
+    }
+}
@@ -0,0 +1,222 @@
+#include <iostream>
+#include <vector>
+#include <string>
+#include <set>
+#include <map>
+#include <algorithm>
+
+#include "syntax.hpp"
+#include "semantic.hpp"
+#include "optimization.hpp"
+#include "ControlFlowGraph.hpp"
+
+#include "LoopInvariantMotion.hpp"
+
+using namespace std;
+using namespace semantic;
+using namespace optimization;
+
+LoopInvariantMotion::LoopInvariantMotion(Program& program, SymbolTable& symb_table, Options& options):
+    program(program), symb_table(symb_table), options(options)
+{}
+
+void LoopInvariantMotion::report(const string& message) {
+    if (options.report)
+        cout << "\t" << message << endl;
+}
+
+void LoopInvariantMotion::run() {
+    if (options.report)
+        cout << "Movimentação de código invariante de laços:" << endl;
+
+    // Cada movimentação altera o grafo; os laços são identificados pelo
+    // rótulo do primeiro comando do cabeçalho. Esse comando pode ser uma
+    // das atribuições movidas e removidas: se o cabeçalho passa a começar
+    // por outro rótulo, o laço é revisto, sem nada mais a mover
+    set<string> done;
+    while (true) {
+        ControlFlowGraph cfg(program);
+
+        Loop* loop = nullptr;
+        for (auto l : cfg.get_loops()) {
+            if (!done.count(l->header->first()->label)) {
+                loop = l;
+                break;
+            }
+        }
+
+        if (loop == nullptr)
+            break;
+
+        done.insert(loop->header->first()->label);
+        hoist(cfg, loop);
+    }
+}
+
+void LoopInvariantMotion::hoist(ControlFlowGraph& cfg, Loop* loop) {
+    Command* edge = cfg.preheader_edge(loop);
+    if (edge == nullptr)
+        return;
+
+    // Copiado antes das remoções, que podem liberar o próprio comando
+    string header = loop->header->first()->label;
+
+    vector<Command*> body;
+    for (auto command : program.commands) {
+        if (command->kind != Command::DEF && loop->contains(cfg.block_of(command)))
+            body.push_back(command);
+    }
+
+    written.clear();
+    map<string, int> definitions;
+    for (auto command : body) {
+        switch (command->kind) {
+            case Command::ASSIGN:
+            case Command::FOR:
+            case Command::NEXT:
+                written.insert(command->variable->get_identifier());
+                definitions[command->variable->get_identifier()]++;
+                break;
+            case Command::READ:
+                for (auto pair : command->read_data)
+                    written.insert(pair.first->get_identifier());
+                break;
+            default:
+                break;
+        }
+    }
+
+    vector<Command*> hoisted, moved;
+    for (auto command : body) {
+        if (command->kind == Command::READ)
+            continue;
+
+        // Temporário atribuído uma só vez com valor invariante: o próprio
+        // comando vai para o pré-cabeçalho
+        if (command->kind == Command::ASSIGN && program.is_temporary(command->variable)
+            && definitions[command->variable->get_identifier()] == 1 && is_invariant(command->exps[0])) {
+            Command* assign = new Command(Command::ASSIGN, command->statement, command->label);
+            assign->variable = command->variable;
+            assign->exps = command->exps;
+            hoisted.push_back(assign);
+            moved.push_back(command);
+            continue;
+        }
+
+        for (auto& exp : command->exps)
+            hoist(exp, hoisted, command);
+    }
+
+    for (auto command : moved) {
+        report(command->label + ": atribuição a '" + command->variable->get_identifier() + "' movida para antes do laço em " + header);
+        program.remove(command);
+    }
+
+    for (auto assign : hoisted) {
+        program.insert_after(edge, assign);
+        edge = assign;
+    }
+}
+
+bool LoopInvariantMotion::is_invariant(const vector<syntax::Elem*>& exp) {
+    for (auto e : exp) {
+        if (e->get_elem_type() == syntax::Elem::VAR) {
+            if (written.count(dynamic_cast<syntax::Var*>(e)->get_identifier()))
+                return false;
+        }
+        else if (e->get_elem_type() == syntax::Elem::FUN) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/*
+ * Substitui as maiores subexpressões invariantes (com ao menos uma
+ * operação ou acesso a vetor) por temporários atribuídos no pré-cabeçalho.
+ */
+void LoopInvariantMotion::hoist(vector<syntax::Elem*>& exp, vector<Command*>& hoisted, Command* command) {
+    // Operando na pilha: início do seu trecho na expressão
+    struct Operand {
+        int start;
+        bool invariant;
+        bool leaf;
+    };
+
+    vector<Operand> stack;
+    vector<pair<int, int>> ranges;
+
+    auto select = [&ranges](Operand& operand, int end) {
+        if (operand.invariant && !operand.leaf)
+            ranges.push_back(make_pair(operand.start, end));
+    };
+
+    for (int i = 0; i < exp.size(); i++) {
+        syntax::Elem* e = exp[i];
+
+        if (e->get_elem_type() == syntax::Elem::NUM) {
+            stack.push_back({i, true, true});
+        }
+        else if (e->get_elem_type() == syntax::Elem::VAR) {
+            syntax::Var* var = dynamic_cast<syntax::Var*>(e);
+            bool invariant = !written.count(var->get_identifier());
+
+            if (var->is_array()) {
+                Operand& index = stack.back();
+                if (!invariant)
+                    select(index, i);
+                index.invariant = index.invariant && invariant;
+                index.leaf = false;
+            }
+            else {
+                stack.push_back({i, invariant, true});
+            }
+        }
+        else if (e->get_elem_type() == syntax::Elem::FUN) {
+            int args = dynamic_cast<syntax::Call*>(e)->get_args().size();
+            int start = args > 0 ? stack[stack.size() - args].start : i;
+
+            for (int a = stack.size() - args; a < stack.size(); a++)
+                select(stack[a], (a + 1 < stack.size()) ? stack[a + 1].start : i);
+
+            stack.resize(stack.size() - args);
+            stack.push_back({start, false, false});
+        }
+        else if (e->is_operator()) {
+            Operand right = stack.back();
+            stack.pop_back();
+            Operand left = stack.back();
+            stack.pop_back();
+
+            if (left.invariant && right.invariant) {
+                stack.push_back({left.start, true, false});
+            }
+            else {
+                select(left, right.start);
+                select(right, i);
+                stack.push_back({left.start, false, false});
+            }
+        }
+    }
+
+    select(stack.back(), exp.size());
+
+    // Da direita para a esquerda, para não deslocar os trechos pendentes
+    sort(ranges.begin(), ranges.end());
+    for (int r = ranges.size() - 1; r >= 0; r--) {
+        int start = ranges[r].first, end = ranges[r].second;
+
+        syntax::Var* temporary = program.temporary();
+        symb_table.insert_variable(temporary);
+
+        Command* assign = new Command(Command::ASSIGN, command->statement, command->label + "." + temporary->get_identifier());
+        assign->variable = temporary;
+        assign->exps.push_back(vector<syntax::Elem*>(exp.begin() + start, exp.begin() + end));
+        hoisted.push_back(assign);
+
+        exp.erase(exp.begin() + start, exp.begin() + end);
+        exp.insert(exp.begin() + start, temporary);
+
+        report(command->label + ": subexpressão invariante movida para '" + temporary->get_identifier() + "' antes do laço");
+    }
+}
@@ -0,0 +1,368 @@
+#include <iostream>
+#include <vector>
+#include <string>
+#include <map>
+#include <algorithm>
+
+#include "syntax.hpp"
+#include "semantic.hpp"
+#include "optimization.hpp"
+#include "ControlFlowGraph.hpp"
+#include "RangeAnalysis.hpp"
+#include "ConstantFolder.hpp"
+
+#include "Memoizer.hpp"
+
+using namespace std;
+using namespace semantic;
+using namespace optimization;
+
+/*
+ * Percorre a expressão pós-fixa até o elemento i, mantendo em starts o
+ * início do trecho de cada operando na pilha. Numa chamada, devolve os
+ * trechos dos argumentos e o início da chamada.
+ */
+static void operands(const vector<syntax::Elem*>& exp, int i, vector<int>& starts, vector<vector<syntax::Elem*>>& args, int& start) {
+    syntax::Elem* e = exp[i];
+    args.clear();
+    start = i;
+
+    if (e->get_elem_type() == syntax::Elem::NUM) {
+        starts.push_back(i);
+    }
+    else if (e->get_elem_type() == syntax::Elem::VAR) {
+        if (!dynamic_cast<syntax::Var*>(e)->is_array())
+            starts.push_back(i);
+    }
+    else if (e->is_operator()) {
+        starts.pop_back();
+    }
+    else if (e->get_elem_type() == syntax::Elem::FUN) {
+        int n = dynamic_cast<syntax::Call*>(e)->get_args().size();
+        if (n > 0)
+            start = starts[starts.size() - n];
+
+        for (int a = starts.size() - n; a < starts.size(); a++) {
+            int end = (a + 1 < starts.size()) ? starts[a + 1] : i;
+            args.push_back(vector<syntax::Elem*>(exp.begin() + starts[a], exp.begin() + end));
+        }
+        starts.resize(starts.size() - n);
+        starts.push_back(start);
+    }
+}
+
+// Elementos da tabela para o intervalo, limitado a MEMO_LIMIT + 1
+static long long entries(const Domain& domain) {
+    long long size = 1;
+    for (auto& interval : domain) {
+        size *= interval.high - interval.low + 1;
+        if (size > MEMO_LIMIT)
+            return MEMO_LIMIT + 1;
+    }
+    return size;
+}
+
+Memoizer::Memoizer(Program& program, SymbolTable& symb_table, Options& options):
+    program(program), symb_table(symb_table), options(options)
+{}
+
+void Memoizer::report(const string& message) {
+    if (options.report)
+        cout << "\t" << message << endl;
+}
+
+void Memoizer::run() {
+    if (options.report)
+        cout << "Tabelas de funções puras:" << endl;
+
+    for (auto command : program.commands) {
+        if (command->kind == Command::DEF)
+            functions[command->label] = command;
+    }
+    if (functions.empty() || program.entry() == nullptr)
+        return;
+
+    ControlFlowGraph graph(program);
+    RangeAnalysis analysis(program, symb_table, options);
+    analysis.analyse();
+    cfg = &graph;
+    ranges = &analysis;
+
+    // Índices de READ dependem das leituras anteriores do mesmo comando
+    for (auto command : program.commands) {
+        if (command->kind == Command::DEF || command->kind == Command::READ)
+            continue;
+        for (auto& exp : command->exps)
+            collect(command, exp);
+    }
+
+    for (auto& d : domains) {
+        Command* def = functions[d.first];
+        if (!is_pure(d.first) || !is_expensive(def))
+            continue;
+        if (entries(d.second) > MEMO_LIMIT) {
+            report(d.first + ": argumentos variam demais para uma tabela");
+            continue;
+        }
+        tabulate(def, d.second);
+    }
+
+    if (tables.empty()) {
+        cfg = nullptr;
+        ranges = nullptr;
+        return;
+    }
+
+    for (auto command : program.commands) {
+        if (command->kind == Command::DEF || command->kind == Command::READ)
+            continue;
+        for (auto& exp : command->exps) {
+            if (replace(command, exp))
+                report(command->label + ": chamada trocada por acesso à tabela");
+        }
+    }
+
+    // Tabelas preenchidas no início do programa; a área de variáveis
+    // começa zerada, e só os valores não nulos são lidos
+    if (!values.empty()) {
+        Command* entry = program.entry();
+        Command* fill = new Command(Command::READ, entry->statement, entry->label + ".tabelas");
+        fill->read_data = values;
+        fill->next = entry;
+        program.commands.insert(find(program.commands.begin(), program.commands.end(), entry), fill);
+    }
+
+    cfg = nullptr;
+    ranges = nullptr;
+}
+
+// Corpo que lê só os parâmetros e chama só funções puras
+bool Memoizer::is_pure(const string& name) {
+    auto it = pure.find(name);
+    if (it != pure.end())
+        return it->second;
+
+    auto f = functions.find(name);
+    if (f == functions.end())
+        return false;
+
+    // Marca provisória: uma função que chama a si mesma não é tabelada
+    pure[name] = false;
+
+    Command* def = f->second;
+    vector<syntax::Var*> parameters = dynamic_cast<syntax::Def*>(def->statement)->get_parameters();
+
+    for (auto e : def->exps[0]) {
+        if (e->get_elem_type() == syntax::Elem::VAR) {
+            syntax::Var* var = dynamic_cast<syntax::Var*>(e);
+            bool parameter = false;
+            for (auto p : parameters)
+                parameter |= p->get_identifier() == var->get_identifier();
+            if (var->is_array() || !parameter)
+                return false;
+        }
+        else if (e->get_elem_type() == syntax::Elem::FUN) {
+            string called = dynamic_cast<syntax::Call*>(e)->get_identifier();
+            if (called == name || !is_pure(called))
+                return false;
+        }
+    }
+
+    return pure[name] = true;
+}
+
+bool Memoizer::is_expensive(Command* def) {
+    int operators = 0;
+    for (auto e : def->exps[0]) {
+        syntax::Elem::type type = e->get_elem_type();
+        if (type == syntax::Elem::DIV || type == syntax::Elem::POW || type == syntax::Elem::FUN)
+            return true;
+        if (e->is_operator())
+            operators++;
+    }
+    return operators >= MEMO_OPERATORS;
+}
+
+// Intervalos dos argumentos das chamadas feitas dentro de laços
+void Memoizer::collect(Command* command, vector<syntax::Elem*>& exp) {
+    BasicBlock* block = cfg->block_of(command);
+    if (block == nullptr || cfg->innermost_loop(block) == nullptr)
+        return;
+
+    vector<int> starts;
+    vector<vector<syntax::Elem*>> args;
+    int start;
+
+    for (int i = 0; i < exp.size(); i++) {
+        operands(exp, i, starts, args, start);
+        if (exp[i]->get_elem_type() != syntax::Elem::FUN || args.empty())
+            continue;
+
+        string name = dynamic_cast<syntax::Call*>(exp[i])->get_identifier();
+        Domain domain;
+        for (auto& arg : args)
+            domain.push_back(ranges->range(command, arg));
+        if (entries(domain) > MEMO_LIMIT)
+            continue;
+
+        auto it = domains.find(name);
+        if (it == domains.end()) {
+            domains[name] = domain;
+            continue;
+        }
+        for (int a = 0; a < domain.size(); a++) {
+            it->second[a].low = min(it->second[a].low, domain[a].low);
+            it->second[a].high = max(it->second[a].high, domain[a].high);
+        }
+    }
+}
+
+/*
+ * Valores da função em todo o intervalo, do primeiro argumento para o
+ * último; falso se algum não tem resultado definido
+ */
+bool Memoizer::tabulate(Command* def, const Domain& domain) {
+    int size = entries(domain);
+    vector<int> table(size);
+    vector<int> args(domain.size());
+
+    for (int index = 0; index < size; index++) {
+        int rest = index;
+        for (int a = domain.size() - 1; a >= 0; a--) {
+            int span = domain[a].high - domain[a].low + 1;
+            args[a] = domain[a].low + rest % span;
+            rest /= span;
+        }
+        if (!evaluate(def, args, table[index])) {
+            report(def->label + ": valor sem resultado definido no intervalo dos argumentos");
+            return false;
+        }
+    }
+
+    syntax::Array* array = new syntax::Array(syntax::Elem::VAR, lexic::position(), def->label + ".tabela", vector<int>(1, size));
+    symb_table.insert_array(array);
+    tables[def->label] = array;
+    tabulated[def->label] = domain;
+
+    for (int index = 0; index < size; index++) {
+        if (table[index] == 0)
+            continue;
+
+        syntax::ArrayAccess* access = new syntax::ArrayAccess(syntax::Elem::VAR, lexic::position(), array->get_identifier(), 1, vector<syntax::Exp*>());
+        access->set_array(array);
+        access->set_processed_access_exps(vector<syntax::Elem*>(1, program.constant(index)));
+        values.push_back(make_pair(access, program.constant(table[index])));
+    }
+
+    string intervals;
+    for (auto& interval : domain)
+        intervals += " [" + to_string(interval.low) + ", " + to_string(interval.high) + "]";
+    report(def->label + ": tabela '" + array->get_identifier() + "' de " + to_string(size) + " valores para os argumentos em" + intervals);
+    return true;
+}
+
+bool Memoizer::evaluate(Command* def, const vector<int>& args, int& result) {
+    if (depth == MEMO_CALL_DEPTH)
+        return false;
+
+    vector<syntax::Var*> parameters = dynamic_cast<syntax::Def*>(def->statement)->get_parameters();
+    vector<int> stack;
+
+    for (auto e : def->exps[0]) {
+        if (e->get_elem_type() == syntax::Elem::NUM) {
+            stack.push_back(dynamic_cast<syntax::Num*>(e)->get_value());
+        }
+        else if (e->get_elem_type() == syntax::Elem::VAR) {
+            string identifier = dynamic_cast<syntax::Var*>(e)->get_identifier();
+            for (int p = 0; p < parameters.size(); p++) {
+                if (parameters[p]->get_identifier() == identifier)
+                    stack.push_back(args[p]);
+            }
+        }
+        else if (e->get_elem_type() == syntax::Elem::FUN) {
+            syntax::Call* call = dynamic_cast<syntax::Call*>(e);
+            int n = call->get_args().size();
+            vector<int> values(stack.end() - n, stack.end());
+            stack.resize(stack.size() - n);
+
+            int value;
+            depth++;
+            bool evaluated = evaluate(functions[call->get_identifier()], values, value);
+            depth--;
+            if (!evaluated)
+                return false;
+            stack.push_back(value);
+        }
+        else if (e->is_operator()) {
+            int right = stack.back();
+            stack.pop_back();
+            if (!ConstantFolder::evaluate(e->get_elem_type(), stack.back(), right, stack.back()))
+                return false;
+        }
+    }
+
+    if (stack.size() != 1)
+        return false;
+
+    result = stack.back();
+    return true;
+}
+
+/*
+ * Troca as chamadas com argumentos dentro do intervalo tabelado pelo
+ * acesso ao vetor, com índice linearizado a partir do primeiro valor
+ */
+bool Memoizer::replace(Command* command, vector<syntax::Elem*>& exp) {
+    bool changed = false;
+    vector<int> starts;
+    vector<vector<syntax::Elem*>> args;
+    int start;
+
+    for (int i = 0; i < exp.size(); i++) {
+        operands(exp, i, starts, args, start);
+        if (exp[i]->get_elem_type() != syntax::Elem::FUN)
+            continue;
+
+        string name = dynamic_cast<syntax::Call*>(exp[i])->get_identifier();
+        auto it = tabulated.find(name);
+        if (it == tabulated.end())
+            continue;
+
+        const Domain& domain = it->second;
+        bool inside = true;
+        for (int a = 0; a < args.size(); a++) {
+            Interval interval = ranges->range(command, args[a]);
+            inside &= interval.low >= domain[a].low && interval.high <= domain[a].high;
+        }
+        if (!inside)
+            continue;
+
+        vector<syntax::Elem*> index;
+        for (int a = 0; a < args.size(); a++) {
+            if (a > 0) {
+                index.push_back(program.constant(domain[a].high - domain[a].low + 1));
+                index.push_back(syntax::Elem::shared(syntax::Elem::MUL));
+            }
+            index.insert(index.end(), args[a].begin(), args[a].end());
+            if (domain[a].low != 0) {
+                index.push_back(program.constant(domain[a].low));
+                index.push_back(syntax::Elem::shared(syntax::Elem::SUB));
+            }
+            if (a > 0)
+                index.push_back(syntax::Elem::shared(syntax::Elem::ADD));
+        }
+
+        syntax::Array* array = tables[name];
+        syntax::ArrayAccess* access = new syntax::ArrayAccess(syntax::Elem::VAR, lexic::position(), array->get_identifier(), 1, vector<syntax::Exp*>());
+        access->set_array(array);
+        access->set_processed_access_exps(index);
+        index.push_back(access);
+
+        exp.erase(exp.begin() + start, exp.begin() + i + 1);
+        exp.insert(exp.begin() + start, index.begin(), index.end());
+        i = start + index.size() - 1;
+        changed = true;
+    }
+
+    return changed;
+}
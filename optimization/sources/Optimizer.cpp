@@ -0,0 +1,96 @@
+#include "semantic.hpp"
+#include "optimization.hpp"
+#include "ControlFlowGraph.hpp"
+#include "Liveness.hpp"
+#include "PartialEvaluator.hpp"
+#include "Memoizer.hpp"
+#include "Inliner.hpp"
+#include "ConstantFolder.hpp"
+#include "RangeAnalysis.hpp"
+#include "ValueNumbering.hpp"
+#include "LoopInvariantMotion.hpp"
+#include "StrengthReducer.hpp"
+#include "JumpThreader.hpp"
+#include "DeadCodeEliminator.hpp"
+#include "CopyPropagator.hpp"
+#include "DeadStoreEliminator.hpp"
+
+#include "Optimizer.hpp"
+
+using namespace semantic;
+using namespace optimization;
+
+Optimizer::Optimizer(Program& program, SymbolTable& symb_table, Options& options):
+    program(program), symb_table(symb_table), options(options)
+{}
+
+void Optimizer::run() {
+    if (!options.optimize)
+        return;
+
+    observe_variables();
+
+    // Antes das demais, que só encontram o que resta depois do estado
+    if (options.partial_eval) {
+        PartialEvaluator evaluator(program, symb_table, options);
+        evaluator.run();
+    }
+
+    // Antes da expansão, que desfaria as chamadas a tabelar
+    Memoizer memoizer(program, symb_table, options);
+    memoizer.run();
+
+    Inliner inliner(program, symb_table, options);
+    inliner.run();
+
+    ConstantFolder folder(program, symb_table, options);
+    folder.run();
+
+    // Antes da redução de força, que troca índices por temporários
+    // incrementados a cada iteração, sem intervalo conhecido
+    if (options.bounds_check) {
+        RangeAnalysis ranges(program, symb_table, options);
+        ranges.run();
+    }
+
+    ValueNumbering vn(program, symb_table, options);
+    vn.run();
+
+    LoopInvariantMotion licm(program, symb_table, options);
+    licm.run();
+
+    StrengthReducer sr(program, symb_table, options);
+    sr.run();
+
+    JumpThreader threader(program, symb_table, options);
+    threader.run();
+
+    DeadCodeEliminator dce(program, symb_table, options);
+    dce.run();
+}
+
+/*
+ * O estado final das variáveis que o programa fonte lê é parte do
+ * resultado, mesmo que os passos seguintes eliminem as leituras (por
+ * propagação de constantes ou pela avaliação parcial): a eliminação de
+ * código morto as considera lidas no END e mantém a sua posição na
+ * memória. As variáveis nunca lidas perdem as atribuições e a posição.
+ */
+void Optimizer::observe_variables() {
+    ControlFlowGraph cfg(program);
+    Liveness liveness(program, cfg, symb_table);
+
+    VarSet reads = liveness.reads();
+    program.observed.insert(reads.begin(), reads.end());
+}
+
+void Optimizer::run(IR& ir) {
+    if (!options.optimize)
+        return;
+
+    CopyPropagator propagator(ir, options);
+    propagator.run();
+
+    DeadStoreEliminator dse(ir, options);
+    dse.run();
+}
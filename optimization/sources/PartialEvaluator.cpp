@@ -0,0 +1,367 @@
+#include <iostream>
+#include <vector>
+#include <string>
+#include <map>
+#include <algorithm>
+#include <cstdint>
+
+#include "syntax.hpp"
+#include "semantic.hpp"
+#include "optimization.hpp"
+#include "ConstantFolder.hpp"
+
+#include "PartialEvaluator.hpp"
+
+using namespace std;
+using namespace semantic;
+using namespace optimization;
+
+PartialEvaluator::PartialEvaluator(Program& program, SymbolTable& symb_table, Options& options):
+    program(program), symb_table(symb_table), options(options)
+{}
+
+void PartialEvaluator::report(const string& message) {
+    if (options.report)
+        cout << "\t" << message << endl;
+}
+
+void PartialEvaluator::run() {
+    if (options.report)
+        cout << "Avaliação parcial:" << endl;
+
+    Command* entry = program.entry();
+    if (entry == nullptr)
+        return;
+
+    for (auto command : program.commands) {
+        if (command->kind == Command::DEF)
+            functions[command->label] = command;
+    }
+
+    // A área de variáveis começa zerada
+    for (auto var : symb_table.get_variables()) {
+        if (var->is_array())
+            memory.arrays[var->get_identifier()] = vector<int>(var->get_size() / 4, 0);
+        else
+            memory.scalars[var->get_identifier()] = 0;
+    }
+
+    // Último ponto sem sub-rotina em andamento: o GOSUB mais externo
+    Command* checkpoint = entry;
+    Memory saved = memory;
+    int printed = 0;
+
+    Command* command = entry;
+    int steps = 0;
+
+    while (command->kind != Command::END) {
+        if (steps == options.eval_steps) {
+            reason = "limite de " + to_string(steps) + " passos";
+            break;
+        }
+
+        if (command->kind == Command::GOSUB && returns.empty()) {
+            checkpoint = command;
+            saved = memory;
+            printed = output.size();
+        }
+
+        // Chamadas escrevem os parâmetros antes de uma falha na expressão
+        bool partial = command->kind == Command::READ || has_calls(command);
+        Memory before;
+        if (partial)
+            before = memory;
+
+        Command* following = nullptr;
+        if (!execute(command, following)) {
+            if (partial)
+                memory = before;
+            break;
+        }
+
+        command = following;
+        steps++;
+    }
+
+    if (command->kind == Command::END) {
+        report("programa avaliado por completo em " + to_string(steps) + " passos");
+    }
+    else {
+        report("avaliação interrompida em " + command->label + " após " + to_string(steps) + " passos: " + reason);
+        if (!returns.empty()) {
+            command = checkpoint;
+            memory = saved;
+            output.resize(printed);
+        }
+    }
+
+    replace(command);
+}
+
+/*
+ * Executa o comando sobre a memória e indica o seguinte; falso se o
+ * efeito do comando não pode ser determinado em compilação
+ */
+bool PartialEvaluator::execute(Command* command, Command*& following) {
+    int value;
+    following = command->next;
+
+    switch (command->kind) {
+        case Command::ASSIGN:
+        case Command::FOR:
+            if (!evaluate(command->exps[0], value))
+                return false;
+            memory.scalars[command->variable->get_identifier()] = value;
+            break;
+        case Command::READ:
+            // Os índices podem usar variáveis lidas antes no mesmo comando
+            for (auto pair : command->read_data) {
+                if (!pair.first->is_array()) {
+                    memory.scalars[pair.first->get_identifier()] = pair.second->get_value();
+                    continue;
+                }
+
+                syntax::ArrayAccess* access = dynamic_cast<syntax::ArrayAccess*>(pair.first);
+                int* slot;
+                if (!evaluate(access->get_processed_access_exps(), value) || !(slot = element(access, value)))
+                    return false;
+                *slot = pair.second->get_value();
+            }
+            break;
+        case Command::PRINT: {
+            vector<int> items;
+            for (auto& exp : command->exps) {
+                if (!evaluate(exp, value))
+                    return false;
+                items.push_back(value);
+            }
+            output.insert(output.end(), items.begin(), items.end());
+            break;
+        }
+        case Command::GOTO:
+            following = command->target;
+            break;
+        case Command::IF: {
+            if (command->exps.empty() || command->target == command->next)
+                break;
+
+            int left, right;
+            if (!evaluate(command->exps[0], left) || !evaluate(command->exps[1], right))
+                return false;
+
+            bool taken = false;
+            switch (dynamic_cast<syntax::If*>(command->statement)->get_op()) {
+                case syntax::If::EQL: taken = left == right; break;
+                case syntax::If::NEQ: taken = left != right; break;
+                case syntax::If::GTN: taken = left > right; break;
+                case syntax::If::LTN: taken = left < right; break;
+                case syntax::If::GEQ: taken = left >= right; break;
+                case syntax::If::LEQ: taken = left <= right; break;
+            }
+            if (taken)
+                following = command->target;
+            break;
+        }
+        case Command::COMP:
+            if (!evaluate(command->exps[0], value))
+                return false;
+            if (memory.scalars[command->variable->get_identifier()] >= value)
+                following = command->target;
+            break;
+        case Command::NEXT: {
+            if (!evaluate(command->exps[0], value))
+                return false;
+            int& var = memory.scalars[command->variable->get_identifier()];
+            var = (int) ((uint32_t) var + (uint32_t) value);
+            following = command->target;
+            break;
+        }
+        case Command::GOSUB:
+            if (returns.size() == EVAL_GOSUB_DEPTH) {
+                reason = "GOSUBs aninhados demais";
+                return false;
+            }
+            returns.push_back(command->next);
+            following = command->target;
+            break;
+        case Command::RETURN:
+            if (returns.empty()) {
+                reason = "RETURN sem GOSUB";
+                return false;
+            }
+            following = returns.back();
+            returns.pop_back();
+            break;
+        case Command::DEF:
+        case Command::END:
+            break;
+    }
+
+    if (following == nullptr) {
+        reason = "fim do programa sem END";
+        return false;
+    }
+    return true;
+}
+
+bool PartialEvaluator::evaluate(const vector<syntax::Elem*>& exp, int& result) {
+    vector<int> stack;
+
+    for (auto e : exp) {
+        if (e->get_elem_type() == syntax::Elem::NUM) {
+            stack.push_back(dynamic_cast<syntax::Num*>(e)->get_value());
+        }
+        else if (e->get_elem_type() == syntax::Elem::VAR) {
+            syntax::Var* var = dynamic_cast<syntax::Var*>(e);
+
+            if (var->is_array()) {
+                // Consome o índice linearizado
+                int* slot = element(var, stack.back());
+                if (slot == nullptr)
+                    return false;
+                stack.back() = *slot;
+                continue;
+            }
+
+            auto it = memory.scalars.find(var->get_identifier());
+            if (it == memory.scalars.end()) {
+                reason = "variável '" + var->get_identifier() + "' desconhecida";
+                return false;
+            }
+            stack.push_back(it->second);
+        }
+        else if (e->get_elem_type() == syntax::Elem::FUN) {
+            syntax::Call* fn = dynamic_cast<syntax::Call*>(e);
+            int args = fn->get_args().size();
+
+            vector<int> values(stack.end() - args, stack.end());
+            stack.resize(stack.size() - args);
+            int value;
+            if (!call(fn, values, value))
+                return false;
+            stack.push_back(value);
+        }
+        else if (e->is_operator()) {
+            int right = stack.back();
+            stack.pop_back();
+            if (!ConstantFolder::evaluate(e->get_elem_type(), stack.back(), right, stack.back())) {
+                reason = "operação sem resultado definido";
+                return false;
+            }
+        }
+    }
+
+    if (stack.size() != 1)
+        return false;
+
+    result = stack.back();
+    return true;
+}
+
+// Os parâmetros ocupam posições próprias na memória, escritas na chamada
+bool PartialEvaluator::call(syntax::Call* fn, const vector<int>& args, int& result) {
+    auto it = functions.find(fn->get_identifier());
+    if (it == functions.end()) {
+        reason = "função '" + fn->get_identifier() + "' desconhecida";
+        return false;
+    }
+    if (depth == EVAL_CALL_DEPTH) {
+        reason = "chamadas aninhadas demais";
+        return false;
+    }
+
+    Command* def = it->second;
+    vector<syntax::Var*> parameters = dynamic_cast<syntax::Def*>(def->statement)->get_parameters();
+    for (int p = 0; p < parameters.size(); p++)
+        memory.scalars[parameters[p]->get_identifier()] = args[p];
+
+    depth++;
+    bool evaluated = evaluate(def->exps[0], result);
+    depth--;
+    return evaluated;
+}
+
+// Posição do elemento de índice linearizado, nula fora do vetor
+int* PartialEvaluator::element(syntax::Var* array, int index) {
+    auto it = memory.arrays.find(array->get_identifier());
+    if (it == memory.arrays.end() || index < 0 || index >= it->second.size()) {
+        reason = "índice " + to_string(index) + " fora do vetor '" + array->get_identifier() + "'";
+        return nullptr;
+    }
+    return &it->second[index];
+}
+
+bool PartialEvaluator::has_calls(Command* command) {
+    for (auto& exp : command->exps) {
+        for (auto e : exp) {
+            if (e->get_elem_type() == syntax::Elem::FUN)
+                return true;
+        }
+    }
+    return false;
+}
+
+/*
+ * Novo início do programa: um READ dos valores não nulos da memória, já
+ * que a área de variáveis começa zerada, e um PRINT com as constantes
+ * impressas pelo trecho avaliado, seguidos do comando onde a execução
+ * parou. Os comandos que deixam de ser alcançados são removidos pela
+ * eliminação de código morto.
+ */
+void PartialEvaluator::replace(Command* resume) {
+    Command* entry = program.entry();
+    vector<Command*> inserted;
+
+    Command* state = new Command(Command::READ, entry->statement, entry->label + ".estado");
+
+    for (auto var : symb_table.get_variables()) {
+        if (!var->is_array()) {
+            int value = memory.scalars[var->get_identifier()];
+            if (value != 0)
+                state->read_data.push_back(make_pair(var, program.constant(value)));
+            continue;
+        }
+
+        vector<int>& elements = memory.arrays[var->get_identifier()];
+        for (int i = 0; i < elements.size(); i++) {
+            if (elements[i] == 0)
+                continue;
+
+            syntax::ArrayAccess* access = new syntax::ArrayAccess(syntax::Elem::VAR, var->get_position(), var->get_identifier(), 1, vector<syntax::Exp*>());
+            access->set_array(dynamic_cast<syntax::Array*>(var));
+            access->set_processed_access_exps(vector<syntax::Elem*>(1, program.constant(i)));
+            state->read_data.push_back(make_pair(access, program.constant(elements[i])));
+        }
+    }
+
+    if (!state->read_data.empty()) {
+        inserted.push_back(state);
+        report("estado de " + to_string(state->read_data.size()) + " valores lido da tabela de DATA");
+    }
+    else {
+        delete state;
+    }
+
+    if (!output.empty()) {
+        Command* print = new Command(Command::PRINT, entry->statement, entry->label + ".saida");
+        string items;
+        for (auto value : output) {
+            print->exps.push_back(vector<syntax::Elem*>(1, program.constant(value)));
+            items += " " + to_string(value);
+        }
+        inserted.push_back(print);
+        report("saída pré-calculada:" + items);
+    }
+
+    if (inserted.empty() && resume == entry) {
+        report("nenhum comando avaliado");
+        return;
+    }
+
+    for (int i = 0; i < inserted.size(); i++)
+        inserted[i]->next = (i + 1 < inserted.size()) ? inserted[i + 1] : resume;
+    program.commands.insert(find(program.commands.begin(), program.commands.end(), entry), inserted.begin(), inserted.end());
+
+    if (resume->kind != Command::END)
+        report("execução segue em " + resume->label);
+}
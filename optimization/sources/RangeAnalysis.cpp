@@ -0,0 +1,523 @@
+#include <iostream>
+#include <vector>
+#include <string>
+#include <climits>
+#include <algorithm>
+#include <set>
+
+#include "syntax.hpp"
+#include "semantic.hpp"
+#include "optimization.hpp"
+#include "ControlFlowGraph.hpp"
+#include "ConstantFolder.hpp"
+
+#include "RangeAnalysis.hpp"
+
+using namespace std;
+using namespace semantic;
+using namespace optimization;
+
+// Qualquer valor de 32 bits
+static const Interval FULL = {INT_MIN, INT_MAX};
+
+// Resultado que pode ter estourado 32 bits vira qualquer valor
+static Interval normalize(long long low, long long high) {
+    if (low < INT_MIN || high > INT_MAX)
+        return FULL;
+    return {low, high};
+}
+
+static bool is_full(const Interval& i) {
+    return i.low <= INT_MIN && i.high >= INT_MAX;
+}
+
+static Interval lookup(const Ranges& ranges, const string& identifier) {
+    auto it = ranges.find(identifier);
+    return it != ranges.end() ? it->second : FULL;
+}
+
+// Comparação que vale quando a original é falsa
+static syntax::If::cmp complement(syntax::If::cmp op) {
+    switch (op) {
+        case syntax::If::EQL: return syntax::If::NEQ;
+        case syntax::If::NEQ: return syntax::If::EQL;
+        case syntax::If::GTN: return syntax::If::LEQ;
+        case syntax::If::LTN: return syntax::If::GEQ;
+        case syntax::If::GEQ: return syntax::If::LTN;
+        default:              return syntax::If::GTN;
+    }
+}
+
+// Mesma comparação com os operandos trocados
+static syntax::If::cmp mirror(syntax::If::cmp op) {
+    switch (op) {
+        case syntax::If::GTN: return syntax::If::LTN;
+        case syntax::If::LTN: return syntax::If::GTN;
+        case syntax::If::GEQ: return syntax::If::LEQ;
+        case syntax::If::LEQ: return syntax::If::GEQ;
+        default:              return op;
+    }
+}
+
+RangeAnalysis::RangeAnalysis(Program& program, SymbolTable& symb_table, Options& options):
+    program(program), symb_table(symb_table), options(options)
+{}
+
+void RangeAnalysis::report(const string& message) {
+    if (options.report)
+        cout << "\t" << message << endl;
+}
+
+void RangeAnalysis::run() {
+    if (options.report)
+        cout << "Análise de intervalos de índices:" << endl;
+
+    ControlFlowGraph cfg(program);
+    propagate(cfg);
+
+    for (auto command : program.commands) {
+        if (command->kind == Command::DEF) {
+            // Parâmetros variam a cada chamada
+            evaluate(command->exps[0], Ranges(), command);
+            continue;
+        }
+
+        if (!reached.count(command))
+            continue;
+
+        Ranges ranges = in[command];
+
+        if (command->kind == Command::READ) {
+            // Índices de uma leitura podem usar variáveis lidas antes no mesmo comando
+            for (auto pair : command->read_data) {
+                if (pair.first->is_array()) {
+                    syntax::ArrayAccess* access = dynamic_cast<syntax::ArrayAccess*>(pair.first);
+                    verify(access, evaluate(access->get_processed_access_exps(), ranges, command), command);
+                }
+                else {
+                    int value = pair.second->get_value();
+                    ranges[pair.first->get_identifier()] = {value, value};
+                }
+            }
+            continue;
+        }
+
+        for (auto& exp : command->exps)
+            evaluate(exp, ranges, command);
+    }
+
+    program.in_bounds.clear();
+    for (auto access : proven) {
+        if (!failed.count(access))
+            program.in_bounds.insert(access);
+    }
+}
+
+void RangeAnalysis::analyse() {
+    ControlFlowGraph cfg(program);
+    propagate(cfg);
+}
+
+// Intervalo da expressão na entrada do comando; qualquer valor se ele
+// não é alcançado
+Interval RangeAnalysis::range(Command* command, const vector<syntax::Elem*>& exp) {
+    if (!reached.count(command))
+        return FULL;
+    return evaluate(exp, in[command]);
+}
+
+/*
+ * Intervalos na entrada de cada comando: a união dos que chegam pelas
+ * arestas alcançadas. Na entrada de um cabeçalho de laço, uma variável
+ * escrita no laço cujo intervalo muda mais de WIDEN_LIMIT vezes passa a
+ * só crescer, com saltos nos limites que cresceram, o que garante o fim
+ * da iteração; as comparações do laço voltam a estreitá-la
+ * na aresta que entra no corpo. O alargamento para na constante de
+ * comparação mais próxima, até WIDEN_JUMPS vezes por variável, e por fim
+ * algumas passadas sem alargamento recuperam os limites perdidos.
+ */
+void RangeAnalysis::propagate(ControlFlowGraph& cfg) {
+    if (program.entry() == nullptr)
+        return;
+
+    // A área de variáveis começa zerada
+    for (auto var : symb_table.get_variables()) {
+        if (!var->is_array())
+            initial[var->get_identifier()] = {0, 0};
+    }
+
+    vector<Command*> commands;
+    for (auto command : program.commands) {
+        if (command->kind != Command::DEF)
+            commands.push_back(command);
+    }
+
+    // Constantes das comparações e dos limites de laços, vizinhas, e tamanhos
+    // de vetores limitam o alargamento; as demais constantes só o fariam
+    // avançar mais devagar
+    for (auto command : commands) {
+        if (command->kind != Command::IF && command->kind != Command::FOR && command->kind != Command::COMP)
+            continue;
+        for (auto& exp : command->exps) {
+            for (auto e : exp) {
+                if (e->get_elem_type() != syntax::Elem::NUM)
+                    continue;
+                long long value = dynamic_cast<syntax::Num*>(e)->get_value();
+                thresholds.insert(value - 1);
+                thresholds.insert(value);
+                thresholds.insert(value + 1);
+            }
+        }
+    }
+    for (auto var : symb_table.get_variables()) {
+        if (var->is_array())
+            thresholds.insert(var->get_size() / 4);
+    }
+
+    // Variáveis escritas em cada laço, pelo primeiro comando do cabeçalho;
+    // todo ciclo passa por um cabeçalho, exceto em grafos irredutíveis
+    unordered_map<Command*, set<string>> headers;
+    for (auto loop : cfg.get_loops()) {
+        set<string>& written = headers[loop->header->first()];
+        for (auto block : loop->blocks) {
+            for (auto command : block->commands) {
+                if (command->variable)
+                    written.insert(command->variable->get_identifier());
+                for (auto pair : command->read_data)
+                    written.insert(pair.first->get_identifier());
+            }
+        }
+    }
+
+    unordered_map<Command*, map<string, int>> changes;
+
+    // Só volta a um comando quando muda a saída de um predecessor
+    set<Command*> pending(commands.begin(), commands.end());
+
+    bool changed = true;
+    while (changed) {
+        changed = false;
+
+        for (auto command : commands) {
+            if (!pending.erase(command))
+                continue;
+
+            Ranges ranges;
+            if (!join(cfg, command, ranges))
+                continue;
+
+            auto header = headers.find(command);
+            if (reached.count(command) && (header != headers.end() || !cfg.is_reducible())) {
+                const Ranges& previous = in[command];
+                map<string, int>& count = changes[command];
+
+                for (auto it = ranges.begin(); it != ranges.end(); ) {
+                    auto old = previous.find(it->first);
+                    Interval before = old != previous.end() ? old->second : FULL;
+
+                    // Variável não escrita no laço só muda com os laços externos;
+                    // o limite maior apenas garante o fim da iteração
+                    bool written = header == headers.end() || header->second.count(it->first);
+                    int limit = written ? WIDEN_LIMIT : 4 * WIDEN_LIMIT;
+                    int& n = count[it->first];
+                    if (before == it->second || n++ < limit) {
+                        ++it;
+                        continue;
+                    }
+
+                    // Depois de WIDEN_JUMPS saltos, vai direto ao extremo: com
+                    // muitas constantes, saltar de uma em uma custaria uma
+                    // passada por constante
+                    bool jump = n <= limit + WIDEN_JUMPS;
+                    if (it->second.low < before.low)
+                        it->second.low = jump ? widen_low(it->second.low) : INT_MIN;
+                    else
+                        it->second.low = before.low;
+                    if (it->second.high > before.high)
+                        it->second.high = jump ? widen_high(it->second.high) : INT_MAX;
+                    else
+                        it->second.high = before.high;
+                    if (is_full(it->second))
+                        it = ranges.erase(it);
+                    else
+                        ++it;
+                }
+            }
+
+            if (!reached.count(command) || ranges != in[command]) {
+                reached.insert(command);
+                in[command] = ranges;
+                transfer(command, ranges);
+                out[command] = ranges;
+                changed = true;
+
+                for (auto succ : cfg.successors(command))
+                    pending.insert(succ);
+            }
+        }
+    }
+
+    // Iterações sem alargamento a partir do ponto fixo estreitam de novo
+    // os intervalos alargados, como o de laços testados no fim; partem dos
+    // comandos onde houve alargamento e seguem pelo que mudar
+    for (auto& pair : changes)
+        pending.insert(pair.first);
+
+    for (int round = 0; round < NARROW_ROUNDS; round++) {
+        for (auto command : commands) {
+            if (!pending.erase(command))
+                continue;
+
+            Ranges ranges;
+            if (!reached.count(command) || !join(cfg, command, ranges) || ranges == in[command])
+                continue;
+
+            in[command] = ranges;
+            transfer(command, ranges);
+            out[command] = ranges;
+
+            for (auto succ : cfg.successors(command))
+                pending.insert(succ);
+        }
+    }
+}
+
+// Menor constante do programa acima do limite, ou o extremo
+long long RangeAnalysis::widen_high(long long high) {
+    auto it = thresholds.lower_bound(high);
+    return (it != thresholds.end() && *it <= INT_MAX) ? *it : INT_MAX;
+}
+
+// Maior constante do programa abaixo do limite, ou o extremo
+long long RangeAnalysis::widen_low(long long low) {
+    auto it = thresholds.upper_bound(low);
+    if (it == thresholds.begin())
+        return INT_MIN;
+    --it;
+    return *it >= INT_MIN ? *it : INT_MIN;
+}
+
+// União dos intervalos que chegam ao comando; falso se nenhuma aresta o alcança
+bool RangeAnalysis::join(ControlFlowGraph& cfg, Command* command, Ranges& ranges) {
+    bool first = true;
+
+    auto meet = [&first, &ranges](const Ranges& incoming) {
+        if (first) {
+            ranges = incoming;
+            first = false;
+            return;
+        }
+        for (auto it = ranges.begin(); it != ranges.end(); ) {
+            auto other = incoming.find(it->first);
+            if (other == incoming.end()) {
+                it = ranges.erase(it);
+                continue;
+            }
+            it->second.low = min(it->second.low, other->second.low);
+            it->second.high = max(it->second.high, other->second.high);
+
+            // Qualquer valor é só a ausência da variável, como nas demais
+            // operações: duas formas do mesmo estado nunca seriam iguais
+            if (is_full(it->second))
+                it = ranges.erase(it);
+            else
+                ++it;
+        }
+    };
+
+    if (command == program.entry())
+        meet(initial);
+    for (auto pred : cfg.predecessors(command)) {
+        if (!reached.count(pred))
+            continue;
+        Ranges edge = out[pred];
+        if (incoming(pred, command, edge))
+            meet(edge);
+    }
+
+    return !first;
+}
+
+/*
+ * Estreita os intervalos que saem de pred pela aresta até command com a
+ * condição que leva a ela; falso se a condição nunca é satisfeita.
+ */
+bool RangeAnalysis::incoming(Command* pred, Command* command, Ranges& ranges) {
+    // Aresta que é ao mesmo tempo desvio e sequência não tem condição
+    if (pred->target == pred->next)
+        return true;
+
+    bool taken = pred->target == command;
+
+    if (pred->kind == Command::COMP) {
+        Interval stop = evaluate(pred->exps[0], ranges);
+        return restrict(ranges, pred->variable, taken ? syntax::If::GEQ : syntax::If::LTN, stop);
+    }
+
+    if (pred->kind == Command::IF) {
+        syntax::If::cmp op = dynamic_cast<syntax::If*>(pred->statement)->get_op();
+        if (!taken)
+            op = complement(op);
+
+        Interval left = evaluate(pred->exps[0], ranges);
+        Interval right = evaluate(pred->exps[1], ranges);
+
+        if (pred->exps[0].size() == 1 && !restrict(ranges, pred->exps[0][0], op, right))
+            return false;
+        if (pred->exps[1].size() == 1 && !restrict(ranges, pred->exps[1][0], mirror(op), left))
+            return false;
+    }
+
+    return true;
+}
+
+// Aplica elem <op> bound a uma variável simples; falso se o intervalo fica vazio
+bool RangeAnalysis::restrict(Ranges& ranges, syntax::Elem* elem, syntax::If::cmp op, Interval bound) {
+    if (elem->get_elem_type() != syntax::Elem::VAR)
+        return true;
+
+    syntax::Var* var = dynamic_cast<syntax::Var*>(elem);
+    if (var->is_array())
+        return true;
+
+    Interval range = lookup(ranges, var->get_identifier());
+
+    switch (op) {
+        case syntax::If::LTN: range.high = min(range.high, bound.high - 1); break;
+        case syntax::If::LEQ: range.high = min(range.high, bound.high); break;
+        case syntax::If::GTN: range.low = max(range.low, bound.low + 1); break;
+        case syntax::If::GEQ: range.low = max(range.low, bound.low); break;
+        case syntax::If::EQL:
+            range.low = max(range.low, bound.low);
+            range.high = min(range.high, bound.high);
+            break;
+        default:
+            break;
+    }
+
+    if (range.low > range.high)
+        return false;
+
+    if (!is_full(range))
+        ranges[var->get_identifier()] = range;
+    return true;
+}
+
+void RangeAnalysis::transfer(Command* command, Ranges& ranges) {
+    Interval value;
+
+    switch (command->kind) {
+        case Command::ASSIGN:
+        case Command::FOR:
+            value = evaluate(command->exps[0], ranges);
+            break;
+        case Command::NEXT: {
+            Interval current = lookup(ranges, command->variable->get_identifier());
+            Interval step = evaluate(command->exps[0], ranges);
+            value = normalize(current.low + step.low, current.high + step.high);
+            break;
+        }
+        case Command::READ:
+            for (auto pair : command->read_data) {
+                if (!pair.first->is_array()) {
+                    int value = pair.second->get_value();
+                    ranges[pair.first->get_identifier()] = {value, value};
+                }
+            }
+            return;
+        default:
+            return;
+    }
+
+    if (is_full(value))
+        ranges.erase(command->variable->get_identifier());
+    else
+        ranges[command->variable->get_identifier()] = value;
+}
+
+/*
+ * Intervalo do valor da expressão pós-fixa. Com command, verifica também
+ * os acessos a vetores encontrados.
+ */
+Interval RangeAnalysis::evaluate(const vector<syntax::Elem*>& exp, const Ranges& ranges, Command* command) {
+    vector<Interval> stack;
+
+    for (auto e : exp) {
+        if (e->get_elem_type() == syntax::Elem::NUM) {
+            int value = dynamic_cast<syntax::Num*>(e)->get_value();
+            stack.push_back({value, value});
+        }
+        else if (e->get_elem_type() == syntax::Elem::VAR) {
+            syntax::Var* var = dynamic_cast<syntax::Var*>(e);
+
+            if (var->is_array()) {
+                // Consome o índice linearizado
+                if (command)
+                    verify(dynamic_cast<syntax::ArrayAccess*>(var), stack.back(), command);
+                stack.back() = FULL;
+            }
+            else {
+                stack.push_back(lookup(ranges, var->get_identifier()));
+            }
+        }
+        else if (e->get_elem_type() == syntax::Elem::FUN) {
+            int args = dynamic_cast<syntax::Call*>(e)->get_args().size();
+            stack.resize(stack.size() - args);
+            stack.push_back(FULL);
+        }
+        else if (e->is_operator()) {
+            Interval r = stack.back();
+            stack.pop_back();
+            Interval l = stack.back();
+            Interval& result = stack.back();
+
+            switch (e->get_elem_type()) {
+                case syntax::Elem::ADD:
+                    result = normalize(l.low + r.low, l.high + r.high);
+                    break;
+                case syntax::Elem::SUB:
+                    result = normalize(l.low - r.high, l.high - r.low);
+                    break;
+                case syntax::Elem::MUL: {
+                    long long p[] = { l.low * r.low, l.low * r.high, l.high * r.low, l.high * r.high };
+                    result = normalize(*min_element(p, p + 4), *max_element(p, p + 4));
+                    break;
+                }
+                case syntax::Elem::DIV: {
+                    // Com divisor de sinal fixo o quociente é monótono em cada operando
+                    if (r.low <= 0 && r.high >= 0) {
+                        result = FULL;
+                        break;
+                    }
+                    long long q[] = { l.low / r.low, l.low / r.high, l.high / r.low, l.high / r.high };
+                    result = normalize(*min_element(q, q + 4), *max_element(q, q + 4));
+                    break;
+                }
+                default: {
+                    int value;
+                    if (l.low == l.high && r.low == r.high
+                            && ConstantFolder::evaluate(e->get_elem_type(), l.low, r.low, value))
+                        result = {value, value};
+                    else
+                        result = FULL;
+                    break;
+                }
+            }
+        }
+    }
+
+    return stack.empty() ? FULL : stack.back();
+}
+
+void RangeAnalysis::verify(syntax::ArrayAccess* access, Interval index, Command* command) {
+    int size = symb_table.pointer_to_variable(access)->get_size() / 4;
+
+    if (index.low >= 0 && index.high < size) {
+        proven.insert(access);
+        report(command->label + ": acesso a '" + access->get_identifier() + "' dentro dos limites");
+    }
+    else {
+        failed.insert(access);
+        report(command->label + ": acesso a '" + access->get_identifier() + "' verificado em execução");
+    }
+}
@@ -0,0 +1,380 @@
+#include <iostream>
+#include <vector>
+#include <string>
+#include <map>
+#include <set>
+#include <cstdint>
+
+#include "syntax.hpp"
+#include "semantic.hpp"
+#include "optimization.hpp"
+#include "ControlFlowGraph.hpp"
+
+#include "StrengthReducer.hpp"
+
+using namespace std;
+using namespace semantic;
+using namespace optimization;
+
+StrengthReducer::StrengthReducer(Program& program, SymbolTable& symb_table, Options& options):
+    program(program), symb_table(symb_table), options(options)
+{}
+
+void StrengthReducer::report(const string& message) {
+    if (options.report)
+        cout << "\t" << message << endl;
+}
+
+void StrengthReducer::run() {
+    if (options.report)
+        cout << "Redução de força em índices de vetores:" << endl;
+
+    set<Command*> done;
+    while (true) {
+        ControlFlowGraph cfg(program);
+
+        Loop* loop = nullptr;
+        for (auto l : cfg.get_loops()) {
+            if (!done.count(l->header->first())) {
+                loop = l;
+                break;
+            }
+        }
+
+        if (loop == nullptr)
+            break;
+
+        done.insert(loop->header->first());
+        reduce(cfg, loop);
+    }
+}
+
+void StrengthReducer::reduce(ControlFlowGraph& cfg, Loop* loop) {
+    Command* edge = cfg.preheader_edge(loop);
+    if (edge == nullptr)
+        return;
+
+    vector<Command*> body;
+    for (auto command : program.commands) {
+        if (command->kind != Command::DEF && loop->contains(cfg.block_of(command)))
+            body.push_back(command);
+    }
+
+    find_inductions(body);
+    if (inductions.empty())
+        return;
+
+    reduced.clear();
+    initializations.clear();
+    increments.clear();
+
+    for (auto command : body) {
+        if (command->kind == Command::READ)
+            continue;
+        for (auto& exp : command->exps)
+            reduce(exp, command);
+    }
+
+    for (auto assign : initializations) {
+        program.insert_after(edge, assign);
+        edge = assign;
+    }
+
+    for (auto pair : increments)
+        program.insert_after(pair.first, pair.second);
+}
+
+void StrengthReducer::find_inductions(vector<Command*>& body) {
+    written.clear();
+    inductions.clear();
+
+    map<string, vector<Command*>> definitions;
+    for (auto command : body) {
+        switch (command->kind) {
+            case Command::ASSIGN:
+            case Command::FOR:
+            case Command::NEXT:
+                written.insert(command->variable->get_identifier());
+                definitions[command->variable->get_identifier()].push_back(command);
+                break;
+            case Command::READ:
+                for (auto pair : command->read_data) {
+                    written.insert(pair.first->get_identifier());
+                    definitions[pair.first->get_identifier()].push_back(command);
+                }
+                break;
+            default:
+                break;
+        }
+    }
+
+    for (auto& pair : definitions) {
+        if (pair.second.size() != 1)
+            continue;
+
+        Command* update = pair.second[0];
+        vector<syntax::Elem*> step;
+
+        if (update->kind == Command::NEXT) {
+            step = update->exps[0];
+        }
+        else if (update->kind == Command::ASSIGN) {
+            // I = I + c, I = c + I ou I = I - c
+            const vector<syntax::Elem*>& exp = update->exps[0];
+            int n = exp.size();
+            if (n < 3)
+                continue;
+
+            auto is_self = [&pair](syntax::Elem* e) {
+                return e->get_elem_type() == syntax::Elem::VAR
+                    && !dynamic_cast<syntax::Var*>(e)->is_array()
+                    && dynamic_cast<syntax::Var*>(e)->get_identifier() == pair.first;
+            };
+
+            syntax::Elem::type op = exp.back()->get_elem_type();
+            if (op == syntax::Elem::ADD && is_self(exp[0])) {
+                step.assign(exp.begin() + 1, exp.end() - 1);
+            }
+            else if (op == syntax::Elem::ADD && is_self(exp[n - 2])) {
+                step.assign(exp.begin(), exp.end() - 2);
+            }
+            else if (op == syntax::Elem::SUB && is_self(exp[0])) {
+                step.push_back(program.constant(0));
+                step.insert(step.end(), exp.begin() + 1, exp.end() - 1);
+                step.push_back(exp.back());
+            }
+            else {
+                continue;
+            }
+        }
+        else {
+            continue;
+        }
+
+        if (is_invariant(step))
+            inductions[pair.first] = {update, step};
+    }
+}
+
+bool StrengthReducer::is_invariant(const vector<syntax::Elem*>& exp) {
+    for (auto e : exp) {
+        if (e->get_elem_type() == syntax::Elem::VAR) {
+            if (written.count(dynamic_cast<syntax::Var*>(e)->get_identifier()))
+                return false;
+        }
+        else if (e->get_elem_type() == syntax::Elem::FUN) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Texto que identifica uma expressão invariante
+static string text(const vector<syntax::Elem*>& exp) {
+    string s;
+    for (auto e : exp) {
+        if (e->get_elem_type() == syntax::Elem::NUM)
+            s += to_string(dynamic_cast<syntax::Num*>(e)->get_value());
+        else if (e->get_elem_type() == syntax::Elem::VAR)
+            s += dynamic_cast<syntax::Var*>(e)->get_identifier() + (dynamic_cast<syntax::Var*>(e)->is_array() ? "()" : "");
+        else
+            s += "#" + to_string(e->get_elem_type());
+        s += " ";
+    }
+    return s;
+}
+
+// Expressão multiplicada por uma constante
+vector<syntax::Elem*> StrengthReducer::scale(const vector<syntax::Elem*>& exp, int factor) {
+    if (factor == 1)
+        return exp;
+
+    if (exp.size() == 1 && exp[0]->get_elem_type() == syntax::Elem::NUM) {
+        uint32_t value = (uint32_t) dynamic_cast<syntax::Num*>(exp[0])->get_value() * (uint32_t) factor;
+        return vector<syntax::Elem*>(1, program.constant((int) value));
+    }
+
+    vector<syntax::Elem*> scaled = exp;
+    scaled.push_back(program.constant(factor));
+    scaled.push_back(syntax::Elem::shared(syntax::Elem::MUL));
+    return scaled;
+}
+
+StrengthReducer::Linear StrengthReducer::combine(syntax::Elem* op, Linear& left, Linear& right) {
+    Linear result = {false, left.start, nullptr, 0, {}};
+
+    if (!left.valid || !right.valid)
+        return result;
+    if (left.iv && right.iv && left.iv->get_identifier() != right.iv->get_identifier())
+        return result;
+
+    result.iv = left.iv ? left.iv : right.iv;
+
+    auto constant = [](Linear& l, int& value) {
+        if (l.iv != nullptr || l.rest.size() != 1 || l.rest[0]->get_elem_type() != syntax::Elem::NUM)
+            return false;
+        value = dynamic_cast<syntax::Num*>(l.rest[0])->get_value();
+        return true;
+    };
+
+    auto materialize = [this](vector<syntax::Elem*>& rest) {
+        if (rest.empty())
+            rest.push_back(program.constant(0));
+    };
+
+    int k;
+    switch (op->get_elem_type()) {
+        case syntax::Elem::ADD:
+        case syntax::Elem::SUB: {
+            bool add = op->get_elem_type() == syntax::Elem::ADD;
+            result.coef = (int) (add ? (uint32_t) left.coef + (uint32_t) right.coef
+                                     : (uint32_t) left.coef - (uint32_t) right.coef);
+
+            if (right.rest.empty()) {
+                result.rest = left.rest;
+            }
+            else if (left.rest.empty() && add) {
+                result.rest = right.rest;
+            }
+            else {
+                result.rest = left.rest;
+                materialize(result.rest);
+                result.rest.insert(result.rest.end(), right.rest.begin(), right.rest.end());
+                result.rest.push_back(op);
+            }
+            break;
+        }
+        case syntax::Elem::MUL:
+            if (constant(right, k)) {
+                result.coef = (int) ((uint32_t) left.coef * (uint32_t) k);
+                result.rest = left.rest.empty() ? left.rest : scale(left.rest, k);
+            }
+            else if (constant(left, k)) {
+                result.coef = (int) ((uint32_t) right.coef * (uint32_t) k);
+                result.rest = right.rest.empty() ? right.rest : scale(right.rest, k);
+            }
+            else if (result.iv == nullptr) {
+                if (!left.rest.empty() && !right.rest.empty()) {
+                    result.rest = left.rest;
+                    result.rest.insert(result.rest.end(), right.rest.begin(), right.rest.end());
+                    result.rest.push_back(op);
+                }
+            }
+            else {
+                return result;
+            }
+            break;
+        default:
+            if (result.iv != nullptr)
+                return result;
+
+            result.rest = left.rest;
+            materialize(result.rest);
+            materialize(right.rest);
+            result.rest.insert(result.rest.end(), right.rest.begin(), right.rest.end());
+            result.rest.push_back(op);
+            break;
+    }
+
+    if (result.coef == 0)
+        result.iv = nullptr;
+
+    result.valid = true;
+    return result;
+}
+
+void StrengthReducer::reduce(vector<syntax::Elem*>& exp, Command* command) {
+    vector<Linear> stack;
+    vector<pair<int, int>> ranges;
+    vector<Linear> indices;
+
+    for (int i = 0; i < exp.size(); i++) {
+        syntax::Elem* e = exp[i];
+
+        if (e->get_elem_type() == syntax::Elem::NUM) {
+            stack.push_back({true, i, nullptr, 0, {e}});
+        }
+        else if (e->get_elem_type() == syntax::Elem::VAR) {
+            syntax::Var* var = dynamic_cast<syntax::Var*>(e);
+
+            if (!var->is_array()) {
+                if (inductions.count(var->get_identifier()))
+                    stack.push_back({true, i, var, 1, {}});
+                else if (!written.count(var->get_identifier()))
+                    stack.push_back({true, i, nullptr, 0, {e}});
+                else
+                    stack.push_back({false, i, nullptr, 0, {}});
+                continue;
+            }
+
+            Linear index = stack.back();
+            stack.pop_back();
+
+            // O próprio iterador como índice não tem o que reduzir
+            if (index.valid && index.iv != nullptr && !(index.coef == 1 && index.rest.empty())) {
+                ranges.push_back(make_pair(index.start, i));
+                indices.push_back(index);
+            }
+
+            if (index.valid && index.iv == nullptr && !written.count(var->get_identifier()))
+                stack.push_back({true, index.start, nullptr, 0, vector<syntax::Elem*>(exp.begin() + index.start, exp.begin() + i + 1)});
+            else
+                stack.push_back({false, index.start, nullptr, 0, {}});
+        }
+        else if (e->get_elem_type() == syntax::Elem::FUN) {
+            int args = dynamic_cast<syntax::Call*>(e)->get_args().size();
+            int start = args > 0 ? stack[stack.size() - args].start : i;
+            stack.resize(stack.size() - args);
+            stack.push_back({false, start, nullptr, 0, {}});
+        }
+        else if (e->is_operator()) {
+            Linear right = stack.back();
+            stack.pop_back();
+            Linear left = stack.back();
+            stack.pop_back();
+            stack.push_back(combine(e, left, right));
+        }
+    }
+
+    // Da direita para a esquerda, para não deslocar os trechos pendentes
+    for (int r = ranges.size() - 1; r >= 0; r--) {
+        Linear& index = indices[r];
+        string key = index.iv->get_identifier() + " " + to_string(index.coef) + " " + text(index.rest);
+
+        syntax::Var* temporary;
+        auto it = reduced.find(key);
+        if (it != reduced.end()) {
+            temporary = it->second;
+        }
+        else {
+            temporary = program.temporary();
+            symb_table.insert_variable(temporary);
+            reduced[key] = temporary;
+
+            // Valor inicial no pré-cabeçalho: coef * iv + resto
+            Command* init = new Command(Command::ASSIGN, command->statement, command->label + "." + temporary->get_identifier());
+            init->variable = temporary;
+            init->exps.push_back(scale(vector<syntax::Elem*>(1, index.iv), index.coef));
+            if (!index.rest.empty()) {
+                init->exps[0].insert(init->exps[0].end(), index.rest.begin(), index.rest.end());
+                init->exps[0].push_back(syntax::Elem::shared(syntax::Elem::ADD));
+            }
+            initializations.push_back(init);
+
+            // Incremento logo após a atualização da variável de indução
+            Induction& induction = inductions[index.iv->get_identifier()];
+            Command* inc = new Command(Command::ASSIGN, induction.update->statement, induction.update->label + "." + temporary->get_identifier());
+            inc->variable = temporary;
+            inc->exps.push_back(vector<syntax::Elem*>(1, temporary));
+            vector<syntax::Elem*> step = scale(induction.step, index.coef);
+            inc->exps[0].insert(inc->exps[0].end(), step.begin(), step.end());
+            inc->exps[0].push_back(syntax::Elem::shared(syntax::Elem::ADD));
+            increments.push_back(make_pair(induction.update, inc));
+
+            report(command->label + ": índice linear em '" + index.iv->get_identifier() + "' reduzido a '" + temporary->get_identifier() + "', incrementado em " + induction.update->label);
+        }
+
+        exp.erase(exp.begin() + ranges[r].first, exp.begin() + ranges[r].second);
+        exp.insert(exp.begin() + ranges[r].first, temporary);
+    }
+}
@@ -0,0 +1,294 @@
+#include <iostream>
+#include <vector>
+#include <string>
+#include <set>
+
+#include "syntax.hpp"
+#include "semantic.hpp"
+#include "optimization.hpp"
+#include "ControlFlowGraph.hpp"
+
+#include "ValueNumbering.hpp"
+
+using namespace std;
+using namespace semantic;
+using namespace optimization;
+
+ValueNumbering::ValueNumbering(Program& program, SymbolTable& symb_table, Options& options):
+    program(program), symb_table(symb_table), options(options)
+{}
+
+ValueNumbering::~ValueNumbering() {
+    for (auto node : nodes)
+        delete node;
+}
+
+void ValueNumbering::report(const string& message) {
+    if (options.report)
+        cout << "\t" << message << endl;
+}
+
+void ValueNumbering::run() {
+    if (options.report)
+        cout << "Eliminação de subexpressões comuns:" << endl;
+
+    {
+        ControlFlowGraph cfg(program);
+        if (cfg.get_entry() == nullptr)
+            return;
+
+        unordered_map<BasicBlock*, vector<BasicBlock*>> children;
+        for (auto block : cfg.reverse_postorder()) {
+            if (block->idom != nullptr)
+                children[block->idom].push_back(block);
+        }
+
+        number(cfg.get_entry(), Scope(), children);
+    }
+
+    for (auto& pair : trees) {
+        for (auto root : pair.second)
+            mark(root);
+    }
+
+    // Os temporários existem antes da reescrita, pois a ordem do programa
+    // não precisa seguir a ordem de dominância
+    for (auto& pair : first) {
+        Node* node = pair.second;
+        if (!node->reused)
+            continue;
+
+        node->temporary = program.temporary();
+        symb_table.insert_variable(node->temporary);
+    }
+
+    vector<Command*> commands = program.commands;
+    for (auto command : commands) {
+        auto it = trees.find(command);
+        if (it == trees.end())
+            continue;
+
+        vector<Command*> inserted;
+        for (int i = 0; i < command->exps.size(); i++) {
+            vector<syntax::Elem*> exp;
+            flatten(it->second[i], exp, command, inserted);
+            command->exps[i] = exp;
+        }
+
+        for (auto assign : inserted)
+            program.insert_before(command, assign);
+    }
+}
+
+void ValueNumbering::number(BasicBlock* block, Scope scope, unordered_map<BasicBlock*, vector<BasicBlock*>>& children) {
+    // Valores que podem mudar entre o dominador imediato e o bloco
+    for (auto identifier : region_writes(block))
+        scope.variables.erase(identifier);
+
+    for (auto command : block->commands) {
+        if (command->kind != Command::READ) {
+            vector<Node*>& roots = trees[command];
+            for (auto& exp : command->exps) {
+                roots.push_back(build(exp));
+                number(roots.back(), scope);
+            }
+        }
+
+        switch (command->kind) {
+            case Command::ASSIGN:
+            case Command::FOR:
+                variables[command->variable->get_identifier()] = command->variable;
+                scope.variables[command->variable->get_identifier()] = trees[command][0]->value;
+                break;
+            default:
+                for (auto identifier : writes(command))
+                    scope.variables[identifier] = ++values;
+                break;
+        }
+    }
+
+    for (auto child : children[block])
+        number(child, scope, children);
+}
+
+void ValueNumbering::number(Node* node, Scope& scope) {
+    for (auto operand : node->operands)
+        number(operand, scope);
+
+    syntax::Elem* e = node->elem;
+    string key;
+
+    if (e->get_elem_type() == syntax::Elem::NUM) {
+        key = "#" + to_string(dynamic_cast<syntax::Num*>(e)->get_value());
+    }
+    else if (e->get_elem_type() == syntax::Elem::VAR) {
+        syntax::Var* var = dynamic_cast<syntax::Var*>(e);
+
+        if (!var->is_array()) {
+            variables[var->get_identifier()] = var;
+            node->value = value_of(var->get_identifier(), scope);
+            return;
+        }
+
+        key = var->get_identifier() + "@" + to_string(value_of(var->get_identifier(), scope))
+            + "[" + to_string(node->operands[0]->value) + "]";
+    }
+    else if (e->get_elem_type() == syntax::Elem::FUN) {
+        // Chamadas escrevem os parâmetros da função e não são reaproveitadas
+        node->value = ++values;
+        return;
+    }
+    else {
+        int left = node->operands[0]->value;
+        int right = node->operands[1]->value;
+
+        syntax::Elem::type op = e->get_elem_type();
+        if ((op == syntax::Elem::ADD || op == syntax::Elem::MUL) && right < left)
+            swap(left, right);
+
+        key = to_string(op) + "(" + to_string(left) + "," + to_string(right) + ")";
+    }
+
+    auto it = scope.table.find(key);
+    if (it == scope.table.end()) {
+        node->value = scope.table[key] = ++values;
+        if (!node->operands.empty())
+            first[node->value] = node;
+        return;
+    }
+
+    node->value = it->second;
+    if (node->operands.empty())
+        return;
+
+    node->redundant = true;
+    for (auto& pair : scope.variables) {
+        if (pair.second == node->value) {
+            node->holder = variables[pair.first];
+            break;
+        }
+    }
+}
+
+int ValueNumbering::value_of(const string& identifier, Scope& scope) {
+    auto it = scope.variables.find(identifier);
+    if (it != scope.variables.end())
+        return it->second;
+
+    return scope.variables[identifier] = ++values;
+}
+
+/*
+ * Variáveis escritas nos caminhos do dominador imediato até o bloco, ou
+ * seja, nos blocos que alcançam o bloco sem passar pelo dominador.
+ */
+set<string> ValueNumbering::region_writes(BasicBlock* block) {
+    set<string> written;
+    set<BasicBlock*> visited;
+    vector<BasicBlock*> pending(block->predecessors.begin(), block->predecessors.end());
+
+    while (!pending.empty()) {
+        BasicBlock* current = pending.back();
+        pending.pop_back();
+
+        if (current == block->idom || visited.count(current))
+            continue;
+        visited.insert(current);
+
+        for (auto command : current->commands) {
+            for (auto identifier : writes(command))
+                written.insert(identifier);
+        }
+
+        for (auto pred : current->predecessors)
+            pending.push_back(pred);
+    }
+
+    return written;
+}
+
+vector<string> ValueNumbering::writes(Command* command) {
+    vector<string> written;
+
+    switch (command->kind) {
+        case Command::ASSIGN:
+        case Command::FOR:
+        case Command::NEXT:
+            written.push_back(command->variable->get_identifier());
+            break;
+        case Command::READ:
+            for (auto pair : command->read_data)
+                written.push_back(pair.first->get_identifier());
+            break;
+        default:
+            break;
+    }
+
+    return written;
+}
+
+ValueNumbering::Node* ValueNumbering::build(const vector<syntax::Elem*>& exp) {
+    vector<Node*> stack;
+
+    for (auto e : exp) {
+        Node* node = new Node();
+        node->elem = e;
+        nodes.push_back(node);
+
+        int operands = 0;
+        if (e->is_operator())
+            operands = 2;
+        else if (e->get_elem_type() == syntax::Elem::FUN)
+            operands = dynamic_cast<syntax::Call*>(e)->get_args().size();
+        else if (e->get_elem_type() == syntax::Elem::VAR && dynamic_cast<syntax::Var*>(e)->is_array())
+            operands = 1;
+
+        node->operands.assign(stack.end() - operands, stack.end());
+        stack.resize(stack.size() - operands);
+        stack.push_back(node);
+    }
+
+    return stack.back();
+}
+
+// Decide quais primeiros cálculos precisam guardar o valor em um temporário
+void ValueNumbering::mark(Node* node) {
+    if (node->redundant) {
+        if (node->holder == nullptr)
+            first[node->value]->reused = true;
+        return;
+    }
+
+    for (auto operand : node->operands)
+        mark(operand);
+}
+
+void ValueNumbering::flatten(Node* node, vector<syntax::Elem*>& exp, Command* command, vector<Command*>& inserted) {
+    if (node->redundant) {
+        syntax::Var* var = node->holder ? node->holder : first[node->value]->temporary;
+        report(command->label + ": subexpressão reaproveitada de '" + var->get_identifier() + "'");
+        exp.push_back(var);
+        return;
+    }
+
+    if (node->reused) {
+        // Primeiro cálculo de um valor reaproveitado: atribui ao temporário
+        Command* assign = new Command(Command::ASSIGN, command->statement, command->label + "." + node->temporary->get_identifier());
+        assign->variable = node->temporary;
+        assign->exps.push_back(vector<syntax::Elem*>());
+
+        for (auto operand : node->operands)
+            flatten(operand, assign->exps[0], command, inserted);
+        assign->exps[0].push_back(node->elem);
+
+        inserted.push_back(assign);
+        report(assign->label + ": temporário '" + node->temporary->get_identifier() + "' criado");
+
+        exp.push_back(node->temporary);
+        return;
+    }
+
+    for (auto operand : node->operands)
+        flatten(operand, exp, command, inserted);
+    exp.push_back(node->elem);
+}
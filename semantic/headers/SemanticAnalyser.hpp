@@ -8,21 +8,26 @@
 #include "syntax.hpp"
 #include "semantic.hpp"
 #include "SyntaxAnalyser.hpp"
-#include "CodeGenerator.hpp"
 
 namespace semantic {
 
 class SemanticAnalyser {
     public:
-        SemanticAnalyser(std::ifstream& input, SymbolTable& symb_table, generation::CodeGenerator& gen);
+        SemanticAnalyser(std::ifstream& input, SymbolTable& symb_table, Program& program);
         ~SemanticAnalyser();
         
         void run(void);
 
+        bool has_error();
+
     private:
+        Command* add_command(Command::type type, syntax::BStatement* statement, std::string label);
+        void link_commands();
+
         void process_assign(syntax::Assign* assign);
         void process_read(syntax::Read* read);
         void process_data(syntax::Data* data);
+        void pair_read_data(syntax::BStatement* statement);
         void process_print(syntax::Print* print);
         void process_goto(syntax::Goto* go);
         void process_if(syntax::If* ift);
@@ -37,21 +42,27 @@ class SemanticAnalyser {
         void process_variable(syntax::Var* v);
         std::vector<syntax::Elem*> process_expression(syntax::Exp* e);
         void gen_exp_vector(syntax::Exp* e, std::vector<syntax::Elem*>& exp);
+        void gen_positive_exp_vector(syntax::Exp* e, std::vector<syntax::Elem*>& exp);
         void gen_exp_vector_operand(syntax::Eb* operand, std::vector<syntax::Elem*>& exp);
         void gen_negative_exp_vector(syntax::Exp* e, std::vector<syntax::Elem*>& exp);
+        void gen_array_index_vector(syntax::ArrayAccess* access, syntax::Array* decl, std::vector<syntax::Elem*>& exp);
         std::vector<syntax::Elem*> process_array_access_exp(syntax::ArrayAccess* access);
-        std::vector<syntax::Elem*> convert_to_postfix(std::vector<syntax::Elem*>& exp);
+        void convert_to_postfix(const std::vector<syntax::Elem*>& infix, std::vector<syntax::Elem*>& postfix);
 
         void delete_statement(syntax::BStatement* statement);
 
 
         syntax::SyntaxAnalyser stx;
-        generation::CodeGenerator& gen;
         SymbolTable& symb_table;
+        Program& program;
 
         std::queue<syntax::Var*> read_variables;
         std::queue<syntax::Num*> data_values;
-        std::vector<syntax::For*> for_stack;
+        std::vector<Command*> for_stack;
+
+        // Áreas de trabalho reaproveitadas entre expressões
+        std::vector<syntax::Elem*> infix;
+        std::vector<syntax::Elem*> operator_stack;
 };
 
 } // namespace semantic
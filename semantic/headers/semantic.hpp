@@ -5,6 +5,10 @@
 #include <exception>
 #include <utility>
 #include <vector>
+#include <string>
+#include <algorithm>
+#include <map>
+#include <set>
 
 #include "syntax.hpp"
 
@@ -75,6 +79,35 @@ class SymbolTable {
         return total_size;
     }
 
+    // Remove a variável e recua as posições das declaradas depois dela
+    void remove_variable(syntax::Var* v) {
+        for (int i = 0; i < variables.size(); i++) {
+            syntax::Var* var = std::get<0>(variables.at(i));
+            if (var->get_identifier() != v->get_identifier())
+                continue;
+
+            int var_index = std::get<1>(variables.at(i));
+            int words = var->get_size() / 4;
+            variables.erase(variables.begin() + i);
+
+            for (auto& pair : variables) {
+                if (std::get<1>(pair) > var_index) {
+                    std::get<1>(pair) -= words;
+                    std::get<0>(pair)->set_index(std::get<1>(pair));
+                }
+            }
+            index -= words;
+            return;
+        }
+    }
+
+    std::vector<syntax::Var*> get_variables() {
+        std::vector<syntax::Var*> vars;
+        for (auto pair : variables)
+            vars.push_back(std::get<0>(pair));
+        return vars;
+    }
+
     void print_variables() {
         for (int i = 0; i < variables.size(); i++) {
             std::cout << "[" << std::get<1>(variables.at(i)) << "] " << std::get<0>(variables.at(i))->get_identifier() << std::endl;
@@ -119,6 +152,155 @@ class SymbolTable {
     std::vector<syntax::Def*> functions;
 };
 
+/*
+ * Comando da representação semântica do programa: um sintaxema já
+ * verificado, com as expressões em notação pós-fixa e os desvios
+ * resolvidos para outros comandos.
+ */
+class Command {
+    public:
+        enum type {
+            ASSIGN,     // variable = exps[0]
+            READ,       // Atribuições de READ/DATA resolvidas em compilação
+            PRINT,      // Sem código gerado; exps são os itens impressos
+            GOTO,
+            IF,         // exps[0] <op> exps[1], desvia para target
+            FOR,        // Inicialização do iterador: variable = exps[0]
+            COMP,       // Fim do laço se variable >= exps[0], desvia para target
+            NEXT,       // Incremento do iterador: variable += exps[0]
+            DEF,        // Corpo exps[0] de função de usuário
+            GOSUB,
+            RETURN,
+            END
+        };
+
+        Command(Command::type type, syntax::BStatement* statement, std::string label):
+            kind(type), statement(statement), label(label)
+        {}
+
+        int line() {
+            return statement->get_index();
+        }
+
+        Command::type kind;
+        syntax::BStatement* statement;
+        std::string label;
+
+        syntax::Var* variable = nullptr;
+        std::vector<std::vector<syntax::Elem*>> exps;
+        std::vector<std::pair<syntax::Var*, syntax::Num*>> read_data;
+
+        int destination = -1;       // Linha de destino de GOTO, IF e GOSUB
+        Command* next = nullptr;    // Comando seguinte na ordem do programa
+        Command* target = nullptr;  // Destino do desvio
+};
+
+class Program {
+    public:
+        Program()
+        {}
+
+        ~Program() {
+            for (auto command : commands)
+                delete command;
+            for (auto pair : constants)
+                delete pair.second;
+            for (auto temporary : temporaries)
+                delete temporary;
+        }
+
+        // Primeiro comando executado
+        Command* entry() {
+            for (auto command : commands) {
+                if (command->kind != Command::DEF)
+                    return command;
+            }
+            return nullptr;
+        }
+
+        // Primeiro comando executável a partir da linha indicada
+        Command* at_line(int line) {
+            for (auto command : commands) {
+                if (command->kind != Command::DEF && command->line() >= line)
+                    return command;
+            }
+            return nullptr;
+        }
+
+        // Remove o comando; quem seguia ou desviava para ele passa ao seguinte
+        void remove(Command* command) {
+            for (auto c : commands) {
+                if (c->next == command)
+                    c->next = command->next;
+                if (c->target == command)
+                    c->target = command->next;
+            }
+            commands.erase(std::find(commands.begin(), commands.end(), command));
+            delete command;
+        }
+
+        // Insere o comando antes de outro; quem seguia ou desviava para ele passa ao novo
+        void insert_before(Command* position, Command* command) {
+            for (auto c : commands) {
+                if (c->next == position)
+                    c->next = command;
+                if (c->target == position)
+                    c->target = command;
+            }
+            command->next = position;
+            commands.insert(std::find(commands.begin(), commands.end(), position), command);
+        }
+
+        // Insere o comando entre outro e o seu único sucessor
+        void insert_after(Command* position, Command* command) {
+            bool jump = position->kind == Command::GOTO || position->kind == Command::NEXT;
+            Command*& successor = jump ? position->target : position->next;
+
+            command->next = successor;
+            successor = command;
+            commands.insert(std::find(commands.begin(), commands.end(), position) + 1, command);
+        }
+
+        // Variável temporária criada durante a otimização, com identificador
+        // que não colide com os do programa
+        syntax::Var* temporary() {
+            syntax::Var* temporary = new syntax::Var(syntax::Elem::VAR, lexic::position(), false, "t." + std::to_string(temporaries.size() + 1));
+            temporaries.push_back(temporary);
+            return temporary;
+        }
+
+        bool is_temporary(syntax::Var* var) {
+            for (auto temporary : temporaries) {
+                if (temporary->get_identifier() == var->get_identifier())
+                    return true;
+            }
+            return false;
+        }
+
+        // Constante criada durante a otimização, compartilhada entre as expressões
+        syntax::Num* constant(int value) {
+            auto it = constants.find(value);
+            if (it != constants.end())
+                return it->second;
+
+            return constants[value] = new syntax::Num(syntax::Elem::NUM, value, 0, false, 0);
+        }
+
+        std::vector<Command*> commands;
+
+        // Acessos a vetores com índice provado dentro dos limites, que
+        // dispensam a verificação do modo --bounds-check
+        std::set<syntax::ArrayAccess*> in_bounds;
+
+        // Variáveis (pela declaração) cujo valor final é resultado visível
+        // do programa e que a análise de vivacidade considera lidas no END
+        std::set<syntax::Var*> observed;
+
+    private:
+        std::map<int, syntax::Num*> constants;
+        std::vector<syntax::Var*> temporaries;
+};
+
 class semantic_exception: public std::exception {
     public:
         semantic_exception(lexic::position& loc, const std::string error_message)
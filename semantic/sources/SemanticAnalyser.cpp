@@ -12,7 +12,6 @@
 using namespace std;
 using namespace syntax;
 using namespace semantic;
-using namespace generation;
 
 
 
@@ -24,8 +23,8 @@ auto cmp = [](syntax::BStatement* a, syntax::BStatement* b) {
 };
 set<syntax::BStatement*, decltype(cmp)> statements(cmp);
 
-SemanticAnalyser::SemanticAnalyser(ifstream& input, SymbolTable& symb_table, CodeGenerator& gen):
-    stx(input), symb_table(symb_table), gen(gen)
+SemanticAnalyser::SemanticAnalyser(ifstream& input, SymbolTable& symb_table, Program& program):
+    stx(input), symb_table(symb_table), program(program)
 {}
 
 SemanticAnalyser::~SemanticAnalyser() {
@@ -36,35 +35,20 @@ SemanticAnalyser::~SemanticAnalyser() {
     }
 }
 
-int find_next_index(BStatement* current = nullptr) {
-    int read = false;
-    int data = false;
-    for (auto statement : statements) {
-        if (dynamic_cast<Print*>(statement)
-            || dynamic_cast<Dim*>(statement)
-            || dynamic_cast<Def*>(statement)
-            || dynamic_cast<Rem*>(statement))
-            continue;
-
-        if (dynamic_cast<Read*>(statement)) {
-            read = true;
-            if (!data)
-                continue;
-        }
+bool SemanticAnalyser::has_error() {
+    return stx.has_error();
+}
 
-        if (dynamic_cast<Data*>(statement)) {
-            data = true;
-            if (!read)
-                continue;
-        }
+string label(BStatement* statement, string suffix = "") {
+    return "L" + to_string(statement->get_index()) + suffix;
+}
 
-        if (!current) {
-            return statement->get_index();
-        }
-        else if (statement->get_index() > current->get_index()) {
-            return statement->get_index();
-        }
+bool line_exists(int index) {
+    for (auto statement : statements) {
+        if (statement->get_index() == index)
+            return true;
     }
+    return false;
 }
 
 void SemanticAnalyser::run() {
@@ -96,8 +80,6 @@ void SemanticAnalyser::run() {
     if (!dynamic_cast<End*>(*statements.rbegin()))
         throw semantic_exception((*statements.rbegin())->get_position(), "Programa não termina com comando END");
 
-    gen.generate_header(find_next_index());
-
     bool ended = false;
     for (auto command : statements) {
         if (ended)
@@ -151,21 +133,60 @@ void SemanticAnalyser::run() {
         }
     }
 
-    gen.generate_variables();
+    link_commands();
 
     //symb_table.print_variables();
 }
 
+/*
+ * Resolve a sequência e os desvios dos comandos gerados. Desvios para
+ * linhas sem código (DIM, DEF, READ sem DATA) seguem para o próximo
+ * comando executável.
+ */
+void SemanticAnalyser::link_commands() {
+    Command* previous = nullptr;
+    for (auto command : program.commands) {
+        if (command->kind == Command::DEF)
+            continue;
+
+        if (previous)
+            previous->next = command;
+        previous = command;
+    }
+
+    for (auto command : program.commands) {
+        switch (command->kind) {
+            case Command::GOTO:
+            case Command::IF:
+            case Command::GOSUB:
+                command->target = program.at_line(command->destination);
+                break;
+            case Command::NEXT:
+                // Saída do laço: comando após o NEXT
+                command->target->target = command->next;
+                break;
+            default:
+                break;
+        }
+    }
+}
+
+Command* SemanticAnalyser::add_command(Command::type type, BStatement* statement, string label) {
+    Command* command = new Command(type, statement, label);
+    program.commands.push_back(command);
+    return command;
+}
+
 void SemanticAnalyser::process_assign(syntax::Assign* assign) {
     Var* decl = symb_table.pointer_to_variable(assign->get_variable());
     if (decl != nullptr && decl->is_array())
         throw semantic_exception(assign->get_position(), "Variáveis indexadas não podem ser atribuídas em LET");
 
     process_variable(assign->get_variable());
-    vector<Elem*> exp = process_expression(assign->get_expression());
 
-    int next_index = find_next_index(assign);
-    gen.generate(assign, exp, next_index);
+    Command* command = add_command(Command::ASSIGN, assign, label(assign));
+    command->variable = assign->get_variable();
+    command->exps.push_back(process_expression(assign->get_expression()));
 }
 
 void SemanticAnalyser::process_read(syntax::Read* read) {
@@ -188,22 +209,7 @@ void SemanticAnalyser::process_read(syntax::Read* read) {
         process_variable(var);
     }
 
-    vector<pair<Var*,Num*>> read_data;
-    while (!read_variables.empty() && !data_values.empty()) {
-        Var* var = read_variables.front();
-        Num* val = data_values.front();
-
-        //cout << "\tVAR[" << var->get_index() << "] " << var->get_identifier() << " = " << val->get_value() << endl;
-
-        read_data.push_back(make_pair(var, val));
-
-        read_variables.pop();
-        data_values.pop();
-    }
-
-    int next_index = find_next_index(read);
-    if (!read_data.empty())
-        gen.generate(read, read_data, next_index);
+    pair_read_data(read);
 }
 
 void SemanticAnalyser::process_data(syntax::Data* data) {
@@ -211,6 +217,10 @@ void SemanticAnalyser::process_data(syntax::Data* data) {
         data_values.push(val);
     }
 
+    pair_read_data(data);
+}
+
+void SemanticAnalyser::pair_read_data(syntax::BStatement* statement) {
     vector<pair<Var*,Num*>> read_data;
 
     while (!read_variables.empty() && !data_values.empty()) {
@@ -225,42 +235,48 @@ void SemanticAnalyser::process_data(syntax::Data* data) {
         data_values.pop();
     }
 
-    int next_index = find_next_index(data);
-    if (!read_data.empty())
-        gen.generate(data, read_data, next_index);
+    if (!read_data.empty()) {
+        Command* command = add_command(Command::READ, statement, label(statement));
+        command->read_data = read_data;
+    }
 }
 
 void SemanticAnalyser::process_print(syntax::Print* print) {
+    Command* command = add_command(Command::PRINT, print, label(print));
 
-}
+    // PRINT não gera código: suas expressões só contam como usos. Como no
+    // compilador original, variável ou função não declarada não é erro aqui;
+    // a expressão é apenas descartada (exemplo em test/print_nao_declarada.bas)
+    for (auto pitem : print->get_pitems()) {
+        if (!pitem || !pitem->has_exp())
+            continue;
 
-void SemanticAnalyser::process_goto(Goto* go) {
-    for (set<BStatement*>::iterator it = statements.begin(); it != statements.end(); ++it) {
-        if (go->get_destination() == (*it)->get_index()) {
-            int destination = find_next_index(*(--it));
-            gen.generate(go, destination);
-            return;
+        try {
+            command->exps.push_back(process_expression(pitem->get_exp()));
         }
+        catch (semantic_exception& e) {}
     }
+}
 
-    throw semantic_exception(go->get_position(), string("Comando GOTO com linha de destino inexistente"));
+void SemanticAnalyser::process_goto(Goto* go) {
+    if (!line_exists(go->get_destination()))
+        throw semantic_exception(go->get_position(), string("Comando GOTO com linha de destino inexistente"));
+
+    Command* command = add_command(Command::GOTO, go, label(go));
+    command->destination = go->get_destination();
 }
 
 void SemanticAnalyser::process_if(syntax::If* ift) {
     vector<Elem*> left = process_expression(ift->get_left());
     vector<Elem*> right = process_expression(ift->get_right());
 
-    int next_index = find_next_index(ift);
-
-    for (set<BStatement*>::iterator it = statements.begin(); it != statements.end(); ++it) {
-        if (ift->get_destination() == (*it)->get_index()) {
-            int destination = find_next_index(*(--it));
-            gen.generate(ift, left, right, destination, next_index);
-            return;
-        }
-    }
+    if (!line_exists(ift->get_destination()))
+        throw semantic_exception(ift->get_position(), string("Comando IF com linha de destino inexistente"));
 
-    throw semantic_exception(ift->get_position(), string("Comando IF com linha de destino inexistente"));
+    Command* command = add_command(Command::IF, ift, label(ift));
+    command->exps.push_back(left);
+    command->exps.push_back(right);
+    command->destination = ift->get_destination();
 }
 
 void SemanticAnalyser::process_for(For* loop) {
@@ -269,7 +285,15 @@ void SemanticAnalyser::process_for(For* loop) {
 
     process_variable(loop->get_iterator());
 
-    for_stack.push_back(loop);
+    // Expressões do laço são processadas no NEXT correspondente
+    Command* init = add_command(Command::FOR, loop, label(loop));
+    init->variable = loop->get_iterator();
+
+    Command* comp = add_command(Command::COMP, loop, label(loop, ".COMP"));
+    comp->variable = loop->get_iterator();
+    init->next = comp;
+
+    for_stack.push_back(init);
 }
 
 void SemanticAnalyser::process_next(Next* next) {
@@ -278,23 +302,25 @@ void SemanticAnalyser::process_next(Next* next) {
 
     process_variable(next->get_iterator());
 
-    For* loop = for_stack.back();
+    Command* init = for_stack.back();
+    For* loop = dynamic_cast<For*>(init->statement);
 
     if (symb_table.select_variable(next->get_iterator())
         != symb_table.select_variable(loop->get_iterator()))
         throw semantic_exception(next->get_position(), "NEXT para laço não imediatamente anterior");
 
-    // Geração do FOR correspondente
-    vector<Elem*> init = process_expression(loop->get_init());
-    vector<Elem*> stop = process_expression(loop->get_stop());
-    vector<Elem*> step = process_expression(loop->get_step());
-    int index_inside_loop = find_next_index(loop);
-    int index_outside_loop = find_next_index(next);
-    gen.generate(loop, init, stop, step, index_inside_loop, index_outside_loop);
-    
-    // Geração do NEXT
+    // Expressões do FOR correspondente
+    init->exps.push_back(process_expression(loop->get_init()));
+
+    Command* comp = init->next;
+    comp->exps.push_back(process_expression(loop->get_stop()));
+
+    // O NEXT incrementa o iterador e volta à comparação
     next->set_loop(loop);
-    gen.generate(next);
+    Command* command = add_command(Command::NEXT, next, label(next));
+    command->variable = loop->get_iterator();
+    command->exps.push_back(process_expression(loop->get_step()));
+    command->target = comp;
 
     for_stack.pop_back();
 }
@@ -335,25 +361,20 @@ void SemanticAnalyser::process_def(Def* def) {
         process_variable(parameter);
     }
 
-    vector<Elem*> exp = process_expression(def->get_exp());
-
-    gen.generate(def, exp);
+    Command* command = add_command(Command::DEF, def, def->get_identifier());
+    command->exps.push_back(process_expression(def->get_exp()));
 }
 
 void SemanticAnalyser::process_gosub(syntax::Gosub* gosub) {
-    for (set<BStatement*>::iterator it = statements.begin(); it != statements.end(); ++it) {
-        if (gosub->get_destination() == (*it)->get_index()) {
-            int destination = find_next_index(*(--it));
-            gen.generate(gosub, destination);
-            return;
-        }
-    }
+    if (!line_exists(gosub->get_destination()))
+        throw semantic_exception(gosub->get_position(), string("Comando GOSUB com subrotina de destino inexistente"));
 
-    throw semantic_exception(gosub->get_position(), string("Comando GOSUB com subrotina de destino inexistente"));
+    Command* command = add_command(Command::GOSUB, gosub, label(gosub));
+    command->destination = gosub->get_destination();
 }
 
 void SemanticAnalyser::process_return(syntax::Return* ret) {
-    gen.generate(ret);
+    add_command(Command::RETURN, ret, label(ret));
 }
 
 void SemanticAnalyser::process_end(syntax::End* end) {
@@ -362,7 +383,7 @@ void SemanticAnalyser::process_end(syntax::End* end) {
     else if (!for_stack.empty())
         throw semantic_exception(end->get_position(), "Fim de programa atingido com laço FOR não terminado");
 
-    gen.generate(end);
+    add_command(Command::END, end, label(end));
 }
 
 
@@ -378,11 +399,15 @@ void SemanticAnalyser::process_variable(Var* v) {
 }
 
 vector<Elem*> SemanticAnalyser::process_expression(Exp* e) {
-    vector<syntax::Elem*> exp;
+    infix.clear();
+    gen_exp_vector(e, infix);
 
-    gen_exp_vector(e, exp);
+    // A forma pós-fixa nunca é maior que a infixa: basta uma reserva
+    vector<syntax::Elem*> postfix;
+    postfix.reserve(infix.size());
+    convert_to_postfix(infix, postfix);
 
-    return convert_to_postfix(exp);
+    return postfix;
 }
 
 string read_elem_type(syntax::Elem* e) {
@@ -409,6 +434,9 @@ void print_exp(const vector<syntax::Elem*>& exp) {
     cout << "]" << endl;
 }
 
+// Zero compartilhado usado na expansão do menos unário: -e => 0 - (e)
+static Num zero(Elem::NUM, 0, 0, false, 0);
+
 void SemanticAnalyser::gen_exp_vector(syntax::Exp* e, vector<syntax::Elem*>& exp) {
 
     if (e->is_negative()) {
@@ -416,8 +444,12 @@ void SemanticAnalyser::gen_exp_vector(syntax::Exp* e, vector<syntax::Elem*>& exp
         return;
     }
 
-    vector<Eb*> operands = e->get_operands();
-    vector<Operator*> operators = e->get_operators();
+    gen_positive_exp_vector(e, exp);
+}
+
+void SemanticAnalyser::gen_positive_exp_vector(syntax::Exp* e, vector<syntax::Elem*>& exp) {
+    const vector<Eb*>& operands = e->get_operands();
+    const vector<Operator*>& operators = e->get_operators();
 
     //TODO: Retornar erro se não houver operandos
     Eb* operand = operands.front();
@@ -425,42 +457,42 @@ void SemanticAnalyser::gen_exp_vector(syntax::Exp* e, vector<syntax::Elem*>& exp
 
     int size = operators.size();
     for (int i = 0; i < size; i++) {
-        exp.push_back(operators.at(i));
+        exp.push_back(operators[i]);
 
-        Eb* operand = operands.at(i + 1);
+        Eb* operand = operands[i + 1];
         gen_exp_vector_operand(operand, exp);
     }
 }
 
 void SemanticAnalyser::gen_exp_vector_operand(syntax::Eb* operand, vector<syntax::Elem*>& exp) {
     if (operand->get_eb_type() == Eb::EXP) {
-        exp.push_back(new Elem(Elem::PRO));
+        exp.push_back(Elem::shared(Elem::PRO));
         gen_exp_vector(dynamic_cast<Exp*>(operand), exp);
-        exp.push_back(new Elem(Elem::PRC));
+        exp.push_back(Elem::shared(Elem::PRC));
     }
     else if (operand->get_eb_type() == Eb::CALL) {
         Call* c = dynamic_cast<Call*>(operand);
-        if (!symb_table.select_function(c))
+        Def* decl = symb_table.select_function(c);
+        if (!decl)
             throw semantic_exception(c->get_position(), "Função '" + c->get_identifier() + "' não declarada");
 
-        Def* decl = symb_table.select_function(c);
         if (decl->get_parameters().size() != c->get_args().size())
             throw semantic_exception(c->get_position(), "Lista de parâmetros incompatível com a declaração de '" + decl->get_identifier() + "'");
 
         exp.push_back(operand);
-        exp.push_back(new Elem(Elem::PRO));
+        exp.push_back(Elem::shared(Elem::PRO));
 
-        vector<Exp*> args = dynamic_cast<Call*>(operand)->get_args();
+        const vector<Exp*>& args = c->get_args();
 
         if (!args.empty()) {
-            gen_exp_vector(args.at(0), exp);
+            gen_exp_vector(args[0], exp);
             for (int i = 1; i < args.size(); i++) {
-                exp.push_back(new Elem(Elem::COM));
-                gen_exp_vector(args.at(i), exp);
+                exp.push_back(Elem::shared(Elem::COM));
+                gen_exp_vector(args[i], exp);
             }
         }
 
-        exp.push_back(new Elem(Elem::PRC));
+        exp.push_back(Elem::shared(Elem::PRC));
     }
     else if (operand->get_eb_type() == Eb::VAR) {
         Var* v = dynamic_cast<Var*>(operand);
@@ -477,25 +509,10 @@ void SemanticAnalyser::gen_exp_vector_operand(syntax::Eb* operand, vector<syntax
                 throw semantic_exception(v->get_position(), "Lista de acesso a variável indexada incompatível com a declaração de '" + v->get_identifier() + "'");
 
             access->set_array(decl);
-            int dimensions = access->get_access_exps().size();
-
-            exp.push_back(new Elem(Elem::PRO));
-
-            for (int i = 0; i < dimensions; i++) {
-                if (i != 0)
-                    exp.push_back(new Elem(Elem::ADD));
-
-                exp.push_back(new Elem(Elem::PRO));
-                gen_exp_vector(access->get_access_exps().at(i), exp);
-                exp.push_back(new Elem(Elem::PRC));
-
-                for ( int j = i + 1; j < dimensions; j++) {
-                    exp.push_back(new Elem(Elem::MUL));
-                    exp.push_back(new Num(Elem::NUM, decl->get_dimensions().at(j), 0, false, 0));
-                }
-            }
 
-            exp.push_back(new Elem(Elem::PRC));
+            exp.push_back(Elem::shared(Elem::PRO));
+            gen_array_index_vector(access, decl, exp);
+            exp.push_back(Elem::shared(Elem::PRC));
         }
         else {
             exp.push_back(operand);
@@ -507,42 +524,44 @@ void SemanticAnalyser::gen_exp_vector_operand(syntax::Eb* operand, vector<syntax
 }
 
 void SemanticAnalyser::gen_negative_exp_vector(syntax::Exp* e, std::vector<syntax::Elem*>& exp) {
-    vector<Operator*> operators;
-    Operator* sub = new Operator(Elem::SUB, Operator::SUB, "-");
-    operators.push_back(sub);
-
-    vector<Eb*> operands;
-    Eb* zero = new Num(Elem::NUM, 0, 0, false, 0);
-    operands.push_back(zero);
-    e->make_positive();
-    operands.push_back(e);
-
-    Exp* neg_exp = new Exp(Elem::EXP, false, operands, operators);
-
-    gen_exp_vector(neg_exp, exp);
+    exp.push_back(&zero);
+    exp.push_back(Elem::shared(Elem::SUB));
+    exp.push_back(Elem::shared(Elem::PRO));
+    gen_positive_exp_vector(e, exp);
+    exp.push_back(Elem::shared(Elem::PRC));
 }
 
-vector<Elem*> SemanticAnalyser::process_array_access_exp(ArrayAccess* access) {
-    vector<Elem*> processed_access_exps;
-
-    int dimensions = access->get_access_exps().size();
-    Array* decl = access->get_array();
+/*
+ * Índice linear de um acesso a variável indexada:
+ * (i0) * passo0 + (i1) * passo1 + ... + (in)
+ */
+void SemanticAnalyser::gen_array_index_vector(ArrayAccess* access, Array* decl, vector<Elem*>& exp) {
+    const vector<Exp*>& access_exps = access->get_access_exps();
+    const vector<Num*>& strides = decl->get_strides();
 
+    int dimensions = access_exps.size();
     for (int i = 0; i < dimensions; i++) {
-        vector<Elem*> ae = process_expression(access->get_access_exps().at(i));
-        for (auto elem : ae) {
-            processed_access_exps.push_back(elem);
-        }
+        if (i != 0)
+            exp.push_back(Elem::shared(Elem::ADD));
 
-        for ( int j = i + 1; j < dimensions; j++) {
-            processed_access_exps.push_back(new Num(Elem::NUM, decl->get_dimensions().at(j), 0, false, 0));
-            processed_access_exps.push_back(new Elem(Elem::MUL));
+        exp.push_back(Elem::shared(Elem::PRO));
+        gen_exp_vector(access_exps[i], exp);
+        exp.push_back(Elem::shared(Elem::PRC));
+
+        if (i < dimensions - 1) {
+            exp.push_back(Elem::shared(Elem::MUL));
+            exp.push_back(strides[i]);
         }
+    }
+}
 
-        if (i != 0)
-            processed_access_exps.push_back(new Elem(Elem::ADD));
+vector<Elem*> SemanticAnalyser::process_array_access_exp(ArrayAccess* access) {
+    infix.clear();
+    gen_array_index_vector(access, access->get_array(), infix);
 
-    }
+    vector<Elem*> processed_access_exps;
+    processed_access_exps.reserve(infix.size());
+    convert_to_postfix(infix, processed_access_exps);
 
     return processed_access_exps;
 }
@@ -587,23 +606,13 @@ int associativity(syntax::Elem* e) {
 }
 
 
-vector<syntax::Elem*> SemanticAnalyser::convert_to_postfix(vector<syntax::Elem*>& infix) {
+void SemanticAnalyser::convert_to_postfix(const vector<syntax::Elem*>& infix, vector<syntax::Elem*>& postfix) {
     // Based on shunting yard algorithm by Edsger Dijkstra
 
-    vector<syntax::Elem*> postfix, stack;
-
-    //cout << "infix: ";
-    //print_exp(infix);
-    //cout << "stack: ";
-    //print_exp(stack);
-    //cout << "postfix: ";
-    //print_exp(postfix);
-    //cout << endl;
-
-    while (!infix.empty()) {
-        syntax::Elem* e = infix.front();
-        infix.erase(infix.begin());
+    vector<syntax::Elem*>& stack = operator_stack;
+    stack.clear();
 
+    for (auto e : infix) {
         if (e->get_elem_type() == syntax::Elem::NUM) {
             postfix.push_back(e);
         }
@@ -654,30 +663,11 @@ vector<syntax::Elem*> SemanticAnalyser::convert_to_postfix(vector<syntax::Elem*>
                 stack.pop_back();
             }
         }
-
-        //cout << "infix: ";
-        //print_exp(infix);
-        //cout << "stack: ";
-        //print_exp(stack);
-        //cout << "postfix: ";
-        //print_exp(postfix);
-        //cout << endl;
     }
     while (!stack.empty()) {
         postfix.push_back(stack.back());
         stack.pop_back();
-
-        //cout << "infix: ";
-        //print_exp(infix);
-        //cout << "stack: ";
-        //print_exp(stack);
-        //cout << "postfix: ";
-        //print_exp(postfix);
-        //cout << endl;
     }
-    //cout << "postfix: ";
-    //print_exp(postfix);
-    return postfix;
 }
 
 void SemanticAnalyser::delete_statement(BStatement* statement){
@@ -51,6 +51,18 @@ class Elem {
                 || (type_ == Elem::POW);
         }
 
+        // Instância única e imutável de um elemento sem conteúdo
+        // (parênteses, vírgula e operadores), compartilhada por todas as expressões
+        static Elem* shared(Elem::type type) {
+            static Elem elems[] = {
+                Elem(Elem::NUM), Elem(Elem::VAR), Elem(Elem::FUN),
+                Elem(Elem::ADD), Elem(Elem::SUB), Elem(Elem::MUL),
+                Elem(Elem::DIV), Elem(Elem::POW), Elem(Elem::PRO),
+                Elem(Elem::PRC), Elem(Elem::EXP), Elem(Elem::COM)
+            };
+            return &elems[type];
+        }
+
     private:
         Elem::type type_;
 
@@ -197,14 +209,32 @@ class Array : public Var {
             size_ = 4;
             for (auto dimension : dimensions)
                 size_ *= dimension;
+
+            // Passo de cada índice: produto das dimensões seguintes
+            int stride = 1;
+            strides_.resize(dimensions.size());
+            for (int i = dimensions.size() - 1; i >= 0; i--) {
+                strides_[i] = new Num(Elem::NUM, stride, 0, false, 0);
+                stride *= dimensions[i];
+            }
         }
 
-        std::vector<int> get_dimensions() {
+        ~Array() {
+            for (auto stride : strides_)
+                delete stride;
+        }
+
+        const std::vector<int>& get_dimensions() {
             return dimensions_;
         }
 
+        const std::vector<Num*>& get_strides() {
+            return strides_;
+        }
+
     private:
         std::vector<int> dimensions_;
+        std::vector<Num*> strides_;
 };
 
 class Exp : public Eb {
@@ -221,11 +251,11 @@ class Exp : public Eb {
         return negative_;
     }
 
-    std::vector<Eb*> get_operands() {
+    const std::vector<Eb*>& get_operands() {
         return operands_;
     }
 
-    std::vector<Operator*> get_operators() {
+    const std::vector<Operator*>& get_operators() {
         return operators_;
     }
 
@@ -249,7 +279,7 @@ class ArrayAccess : public Var {
             return dimension_;
         }
 
-        std::vector<Exp*> get_access_exps() {
+        const std::vector<Exp*>& get_access_exps() {
             return access_exps_;
         }
 
@@ -286,7 +316,7 @@ class Call : public Eb {
             return identifier_;
         }
 
-        std::vector<Exp*> get_args() {
+        const std::vector<Exp*>& get_args() {
             return args_;
         }
 
@@ -0,0 +1,11 @@
+1 REM estado final igual com e sem -O0: a = -14, i = 5
+5 DATA -50,-22
+10 DIM x(8)
+30 LET a=0
+80 READ x(0),x(1)
+110 FOR i=3 TO 4 STEP 2
+120 LET a=a+x(0)
+160 NEXT i
+190 LET a=-14-0
+315 PRINT a,i
+320 END
@@ -0,0 +1,17 @@
+10 REM a união de intervalos que chegam ao comando pode cobrir qualquer valor
+50 LET E = 3
+150 FOR I2 = 0 TO 6 STEP 2
+180 GOSUB 330
+190 NEXT I2
+220 LET C = -1000
+250 GOSUB 360
+320 GOTO 410
+330 GOTO 340
+340 IF (C * E) < 256 - 65536 THEN 350
+350 RETURN
+360 IF (4 ^ 4) < E THEN 400
+370 FOR I1 = 2 TO 5
+380 GOSUB 330
+390 NEXT I1
+400 RETURN
+410 END
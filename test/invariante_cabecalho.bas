@@ -0,0 +1,12 @@
+5 REM a atribuição movida para fora do laço era o primeiro comando do cabeçalho
+10 LET A = 3
+40 LET D = 100
+50 LET E = 0
+100 DEF FN F0(P, Q) = ((D + Q) + Q / (E * E + 1))
+110 FOR I1 = 0 TO 5 STEP 1
+130 NEXT I1
+180 LET N1 = 0
+190 LET B = FN F0(1 + A, A * FN F0((100000 + FN F0((E ^ 11), (4096 / 25))), 2 + 4))
+200 LET N1 = N1 + 1
+210 IF N1 < 4 THEN 190
+230 END
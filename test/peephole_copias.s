@@ -0,0 +1,22 @@
+/* cópia de um registrador nele mesmo: sai */
+main:
+	MOV      r3, r3
+/* cópia usada só pela instrução seguinte: ADD r3, r6, r0 */
+	MOV      r3, r0
+	ADD      r3, r6, r3
+/* MUL com destino igual ao primeiro operando: MUL r4, r0, r6 */
+	MOV      r4, r0
+	MUL      r4, r4, r6
+/* a instrução seguinte não sobrescreve a cópia: mantidas */
+	MOV      r5, r0
+	ADD      r6, r5, r5
+/* operando deslocado: mantidas */
+	MOV      r1, r3
+	ADD      r1, r1, r1, LSL #2
+/* escrita sobrescrita sem ser lida: sai MOV r2, #1 */
+	MOV      r2, #1
+	MOV      r2, #3
+/* condicional: mantidas */
+	MOV      r2, #1
+	MOVLT    r2, #3
+	B        main
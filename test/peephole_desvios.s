@@ -0,0 +1,25 @@
+/* desvio para a linha seguinte: sai */
+main:
+	CMP      r3, r4
+	BGE      L20
+
+L20:
+	B        L40
+L30:
+L40:
+/* BLS L50 tem outro desvio antes do rótulo; BLHS é chamada: mantidos */
+	BLS      L50
+	B        L60
+L50:
+	BLHS     bounds_error
+/* código após desvio incondicional: sai até o próximo rótulo */
+L60:
+	B        L60
+	MOV      r1, r2
+	ADD      r1, r1, r2
+L70:
+	MOV      pc, lr
+	LDMFD    r11!, {r6}
+
+sdiv:
+	MOV      pc, lr
@@ -0,0 +1,19 @@
+/* leitura do valor recém-escrito: vira MOV r3, r1 */
+F:
+	LDMFD    sp!, {r1}
+	STR      r1, [r12, #4]
+	LDR      r3, [r12, #4]
+/* mesmo registrador: sai a leitura */
+	STR      r3, [r12, #8]
+	LDR      r3, [r12, #8]
+/* leitura repetida: a segunda vira MOV r5, r4 */
+	LDR      r4, [r12, #12]
+	LDR      r5, [r12, #12]
+/* o endereço usa o registrador lido: mantidas */
+	LDR      r1, [r12, r1]
+	LDR      r2, [r12, r1]
+/* rótulo entre as duas: mantidas */
+	STR      r3, [r12, #16]
+L10:
+	LDR      r4, [r12, #16]
+	MOV      pc, lr
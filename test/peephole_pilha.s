@@ -0,0 +1,21 @@
+/* empilhamento desfeito em seguida: vira MOV r3, r1 */
+f:
+	STMFD    sp!, {r1}
+	LDMFD    sp!, {r3}
+	STMFD    sp!, {r4}
+
+	LDMFD    sp!, {r4}
+/* pilhas diferentes: mantidos */
+	STMFD    sp!, {r1}
+	LDMFD    r11!, {r1}
+/* lr desempilhado e empilhado antes de BL: sai o par */
+	STMFD    r11!, {lr}
+	BL       sdiv
+	LDMFD    r11!, {lr}
+	STMFD    r11!, {lr}
+	BL       pow
+	LDMFD    r11!, {lr}
+/* sem BL em seguida: mantidos */
+	LDMFD    r11!, {lr}
+	STMFD    r11!, {lr}
+	MOV      pc, lr
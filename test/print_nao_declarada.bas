@@ -0,0 +1,5 @@
+00 REM compila: b ainda não foi declarada e sai das expressões do PRINT
+10 LET a = 2
+20 PRINT "Valor: ", a, b
+30 LET b = a + 1
+40 END
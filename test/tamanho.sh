@@ -0,0 +1,30 @@
+#!/bin/sh
+# Tamanho do código gerado em ARM e em Thumb para os programas
+# test/tamanho_*.bas, com e sem otimização, como informado por --report.
+# Uso, a partir da raiz do projeto: sh test/tamanho.sh [ <basicc> ]
+
+BASICC=${1:-./basicc}
+SAIDA=${TMPDIR:-/tmp}/tamanho.$$.s
+
+tamanho() {
+    "$BASICC" "$1" "$SAIDA" --report $2 | sed -n 's/^Tamanho do código: \([0-9]*\) bytes$/\1/p'
+}
+
+for opcoes in "" "-O0"; do
+    echo "Opções: ${opcoes:-padrão}"
+    printf "%-28s %8s %8s\n" "Programa" "ARM" "Thumb"
+
+    total_arm=0
+    total_thumb=0
+    for programa in test/tamanho_*.bas; do
+        arm=$(tamanho "$programa" "$opcoes")
+        thumb=$(tamanho "$programa" "$opcoes -mthumb")
+        printf "%-28s %8d %8d\n" "$(basename "$programa")" "$arm" "$thumb"
+        total_arm=$((total_arm + arm))
+        total_thumb=$((total_thumb + thumb))
+    done
+
+    printf "%-28s %8d %8d (%d%%)\n\n" "Total" "$total_arm" "$total_thumb" $((100 * total_thumb / total_arm))
+done
+
+rm -f "$SAIDA"
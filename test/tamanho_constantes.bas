@@ -0,0 +1,16 @@
+10 LET A = 100000
+20 LET B = -1
+30 LET C = 16711935
+40 LET D = -256
+50 LET E = 1000 + A
+60 LET F = 123456789
+70 DIM Z(2000)
+80 READ Z(1999), Z(3)
+90 DATA 77, 5
+100 LET I = 1999
+110 LET G = Z(I) + 65535
+120 LET H = 123456789 + Z(3)
+125 LET K = 1
+127 LET Y = K
+128 PRINT A, B, C, D, E, F, G, H, Y
+130 END
@@ -0,0 +1,8 @@
+10 FOR N = -50 TO 50 STEP 7
+20 LET A = A + N / 2 + N / 3 + N / 5
+30 LET B = B + N / 7 + N / 10 + N / (0 - 3)
+40 LET C = C + N / 16 + N / 100 + N / 641
+50 LET D = D + N / 1000 + N / (0 - 7) + N / 65536
+60 NEXT N
+70 PRINT A, B, C, D
+80 END
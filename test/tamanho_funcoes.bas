@@ -0,0 +1,12 @@
+10 DEF FN F(X) = X * X + 1
+20 DEF FN G(A, B) = A * 10 - B
+30 LET S = 0
+40 FOR I = 1 TO 10
+50 LET S = S + FN F(I)
+60 NEXT I
+70 LET T = FN G(S, 3) / 7
+80 LET U = -T / 4
+90 LET V = 2 ^ 10 - 3 ^ 3
+100 LET W = (S - 400) / (0 - 3)
+105 PRINT S, T, U, V, W, I
+110 END
@@ -0,0 +1,55 @@
+10 DEF FN F(X, Y, Z) = X * 7 - Y / 3 + Z * Z
+20 DEF FN G(W) = FN F(3, 4, 5) / (W * W + 1) + W ^ 0 - W / 10
+30 DIM P(41), Q(31, 6)
+40 READ N, A, B, C, D
+50 DATA 13, -100, 37, 5, 0
+60 DATA -257, 106, 57, -367, -122, 437, 118, -15, 140, 94
+70 DATA -433, 120, -487, 430, 357, -20, -235, 64, -261, -304
+80 DATA 234, -19, 53, 356, 62, -13, -94, 154, 381, -346
+90 DATA -263, 150, -345, 388, 448, 35, -101, 259, -485, 187
+100 DATA 295, -435, -337, 276, 480, 105, -457, -192, 298, -469
+110 DATA 343, 386, -225, -16, 109, 236, 442, 399, -104, 231
+120 DATA 307, 443, -63, -96, 245, 320, 90, -45, 487, 458
+130 DATA -363, 399, -126, -401, -464, -361, 6, -278, -236, 488
+140 DATA 188, -54, 297, 141, 375, -192, -69, 19, 353, -105
+150 DATA 87, -141, 46, 99, -83, 98, -263, 425, -156, 198
+160 DATA 437, 451, -471, 376, -214, 120, 187, 212, -333, 215
+170 DATA 381, -166, 487, 54, 426, 85, 82, -394, 230, 171
+180 DATA -284, 148, 351, 87, -227, -209, -373, -436, -7, 374
+190 DATA 154, -5, -410, -148, 319, -432, -80, 418, -346, -480
+200 DATA -200, -63, 287, -75, 393, -379, -455, 119, 129, 279
+210 DATA -454, -114, 235, 100, -162, 64, 402, 444, -215, 17
+220 DATA -259, -464, -183, -493, -422, -390, 114, 48, -468, 471
+230 DATA -298, 494, -83, -202, 125, -231, -341, 206, -457, 388
+240 DATA -153, -179, -132, 481, -359, 418, 382, -114, -115, -29
+250 DATA 390, 32, -105, 159, 387, 109, 197, 72, -395, 135
+260 DATA 496, 463, 330, 19, -223, -59, 149, 237, 232, -257
+270 DATA 458, -192, -53, -236, 33, -190, 61, -153, -489, 307
+280 DATA -75, 93, -178, -480, -115, 130, 103
+290 FOR I = 0 TO 40
+300 READ P(I)
+310 LET T = T + P(I) * 3 - 7 + FN F(I, A, B) / 9
+320 NEXT I
+330 FOR L = 0 TO 30
+340 FOR J = 0 TO 5
+350 READ Q(L, J)
+360 LET U = U + P(L) / (J + 1) - L * J * 255 + Q(L, J) * 5
+370 NEXT J
+380 NEXT L
+390 LET E = A * 9 + B * 15 - C * 31 + D * (0 - 8) + A * 96 + B * 255 + C * 1000 + A * (0 - 1)
+400 LET F = A / 7 + B / (0 - 3) + C / 16 + A / 2 + B / (0 - 64) + A / 1000 + B / 5 + A / (0 - 1)
+410 LET G = A ^ 0 + D ^ 0 + B ^ 3 + C ^ 5 + A ^ 4 - C ^ 11
+420 LET H = FN G(C) + FN G(B) * 2 - FN F(A, B, C)
+430 LET K = A - 300 + B + 1000 - C - 7 + 250 - 256 + D + 65536 - (0 - 70000)
+440 IF A < (0 - 99) THEN 460
+450 LET K = K + 1
+460 IF B > 300 THEN 480
+470 LET K = K + 2
+480 IF C = (0 - 5) THEN 500
+490 LET K = K * 2
+500 LET M = 1000 - A
+510 LET R = 0 - B
+520 LET S = Q(N, 3) + P(N * 2) + Q(30, 5) + P(40)
+530 LET V = A / B + B / C + T / (C - 1) + U / (B - 40)
+540 PRINT E, F, G, H, K, M, R, S, T, U, V
+550 END
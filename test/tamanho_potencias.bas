@@ -0,0 +1,8 @@
+10 FOR N = -4 TO 4
+20 LET A = A + N ^ 2 + N ^ 3 + N ^ 0
+30 LET B = B + N ^ 5 + N ^ 7 + N ^ 10
+40 LET E = N + 5
+50 LET C = C + 2 ^ E + N ^ (E - N)
+60 NEXT N
+70 PRINT A, B, C
+80 END
@@ -0,0 +1,17 @@
+10 LET N = 0
+20 LET X = 1
+30 LET X = X * 3
+40 LET N = N + 1
+50 IF N < 7 THEN 30
+60 LET C = 0
+70 GOSUB 200
+80 GOSUB 200
+90 LET D = C * 2
+100 GOTO 300
+200 LET C = C + 5
+210 RETURN
+300 LET Y = 100
+310 IF Y <= 10 THEN 400
+320 LET Y = Y - 13
+330 GOTO 310
+400 END
@@ -0,0 +1,18 @@
+10 DIM V(20)
+20 READ V(0), V(1), V(2), V(3), V(19)
+30 DATA 4, 9, 16, 25, 99
+40 FOR I = -6 TO 6
+50 LET A = A + I * 3 + I * (0 - 7) + I * 8 + 10 * I
+60 LET B = B + I * (0 - 8) + I * 15 + I * (0 - 15) + I * 255 + I * 96 + I * 1000
+70 LET C = C + I * I + A
+80 LET D = D - 5 + (0 - 100000) + 7 - I
+90 IF I > (0 - 3) THEN 110
+100 LET E = E + 1
+110 IF 2 < I THEN 130
+120 LET F = F + V(3) + V(I + 6) * 2
+130 IF I = (0 - 1) THEN 150
+140 LET G = G + 1
+150 NEXT I
+160 LET H = V(19) - 1
+170 PRINT A, B, C, D, E, F, G, H
+180 END
@@ -8,3 +8,4 @@
 07 LET fib = ant1 + ant2
 08 PRINT fib
 09 NEXT i
+10 END